@@ -0,0 +1,135 @@
+/** \file
+ *
+ *  Analog joystick axes for the ANALOG_AXES build. The ADC free-runs from its own interrupt,
+ *  cycling through the axis channels; each axis value is the sum of \ref ANALOG_OVERSAMPLE
+ *  conversions decimated to \ref ANALOG_BITS bits. The interrupt fills one of two blocks while
+ *  the other holds the last complete round, which the frame's input snapshot copies, so the report
+ *  builders never wait for a conversion and never see X and Y from different rounds.
+ */
+
+#if defined(ANALOG_AXES)
+
+#include "Analog.h"
+#include "Input.h"
+
+/* ADC clock of at most 200kHz for the full 10-bit accuracy, one conversion every 13 ADC clocks */
+#if (F_CPU > 12800000)
+	#define ANALOG_PRESCALER_MASK  ((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))
+#else
+	#define ANALOG_PRESCALER_MASK  ((1 << ADPS2) | (1 << ADPS1))
+#endif
+
+/** AVcc reference with the external capacitor on AREF. */
+#define ANALOG_ADMUX             (1 << REFS0)
+
+/** Axis blocks, Analog_ReadyBlock is the last complete one. */
+AnalogAxes_t     Analog_Blocks[2];
+volatile uint8_t Analog_ReadyBlock;
+
+/** Longest run of the ADC interrupt seen so far, in Timer1 ticks. */
+volatile uint8_t Analog_TicksMax;
+
+/** Time spent in the ADC interrupt during the last measurement window, and the window's length,
+ *  both in Timer1 ticks.
+ */
+volatile uint16_t Analog_BusyTicks;
+volatile uint16_t Analog_WindowTicks;
+
+/** Position in the round of the conversion that completes next. The first conversion runs on the
+ *  channel selected by Analog_Init() before the interrupt can steer the multiplexer, so it only
+ *  primes the pipeline and is dropped.
+ */
+static int8_t Conversion = -1;
+
+/** Sum of the conversions of the current axis so far. */
+static uint16_t Sum;
+
+/** Block being filled by the interrupt. */
+static uint8_t FillingBlock = 1;
+
+/** Conversions and busy ticks of the load measurement window in progress. */
+static uint16_t WindowConversions;
+static uint16_t WindowBusyTicks;
+static uint16_t WindowStart;
+
+/** Starts the free-running conversions on the axis channels, from the start of a round. Port F0 and
+ *  F1 are left without pull-ups, their digital input buffers are disabled.
+ */
+void Analog_Init(void)
+{
+	DDRF  &= ~((1 << PF0) | (1 << PF1));
+	PORTF &= ~((1 << PF0) | (1 << PF1));
+	DIDR0  = (1 << ADC0D) | (1 << ADC1D);
+
+	Conversion  = -1;
+	Sum         = 0;
+	WindowStart = Input_GetTimestamp();
+
+	ADMUX  = ANALOG_ADMUX;
+	ADCSRB = 0;
+	ADCSRA = (1 << ADEN) | (1 << ADSC) | (1 << ADATE) | (1 << ADIF) | (1 << ADIE) | ANALOG_PRESCALER_MASK;
+}
+
+/** Stops the conversions, the last complete round stays in \ref Analog_ReadyBlock until
+ *  \ref Analog_Init() starts them again.
+ */
+void Analog_Stop(void)
+{
+	ADCSRA = (1 << ADIF);
+}
+
+ISR(ADC_vect)
+{
+	uint16_t Now;
+	uint16_t Sample;
+	uint8_t  Ticks;
+
+	PROFILE_ENTER(PROFILE_Analog);
+
+	Now    = Input_GetTimestamp();
+	Sample = ADC;
+
+	/* Free running, the next conversion has already started: the multiplexer now selects the
+	 * channel of the one after it */
+	ADMUX = ANALOG_ADMUX | (((uint8_t)(Conversion + 2) & (ANALOG_ROUND - 1)) / ANALOG_OVERSAMPLE);
+
+	if (Conversion >= 0) {
+		Sum += Sample;
+
+		if ((Conversion & (ANALOG_OVERSAMPLE - 1)) == (ANALOG_OVERSAMPLE - 1)) {
+			int16_t Axis = ((int16_t)(Sum >> (ANALOG_BITS - 10)) + ANALOG_AXIS_MIN);
+
+			Sum = 0;
+
+			if (Conversion < ANALOG_OVERSAMPLE) {
+				Analog_Blocks[FillingBlock].X = Axis;
+			} else {
+				Analog_Blocks[FillingBlock].Y = Axis;
+
+				Analog_ReadyBlock = FillingBlock;
+				FillingBlock     ^= 1;
+			}
+		}
+	}
+
+	Conversion = ((Conversion + 1) & (ANALOG_ROUND - 1));
+
+	/* The measured run excludes the interrupt entry and exit, about 40 cycles */
+	Ticks = (Input_GetTimestamp() - Now);
+	if (Ticks > Analog_TicksMax)
+		Analog_TicksMax = Ticks;
+
+	WindowBusyTicks += Ticks;
+
+	if (++WindowConversions == ANALOG_LOAD_WINDOW) {
+		Analog_BusyTicks   = WindowBusyTicks;
+		Analog_WindowTicks = (Now - WindowStart);
+		WindowStart        = Now;
+		WindowBusyTicks    = 0;
+		WindowConversions  = 0;
+	}
+
+	PROFILE_LEAVE(PROFILE_Analog);
+}
+
+#endif
@@ -0,0 +1,71 @@
+/** \file
+ *
+ *  Header file for Analog.c.
+ */
+
+#ifndef _ANALOG_H_
+#define _ANALOG_H_
+
+/* Includes: */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+
+#include <LUFA/Common/Common.h>
+
+/* Macros: */
+/** Resolution of the reported analog axes in bits, 10 to 12. Each extra bit over the ADC's own 10
+ *  takes four times as many conversions per axis.
+ */
+#if !defined(ANALOG_BITS)
+#define ANALOG_BITS              11
+#endif
+
+#if (ANALOG_BITS < 10) || (ANALOG_BITS > 12)
+	#error ANALOG_BITS must be between 10 and 12.
+#endif
+
+/** Number of analog axes, sampled on ADC0 (Port F0, X) and ADC1 (Port F1, Y). */
+#define ANALOG_CHANNELS          2
+
+/** Number of conversions summed into each axis value, four per extra bit of resolution. */
+#define ANALOG_OVERSAMPLE        (1 << (2 * (ANALOG_BITS - 10)))
+
+/** Number of conversions in one round over all channels, the axes are published once per round. */
+#define ANALOG_ROUND             (ANALOG_CHANNELS * ANALOG_OVERSAMPLE)
+
+/** Range of the axes, centered on the middle of the ADC range. */
+#define ANALOG_AXIS_MIN          (-(1 << (ANALOG_BITS - 1)))
+#define ANALOG_AXIS_MAX          ((1 << (ANALOG_BITS - 1)) - 1)
+
+/** Number of conversions over which the ADC interrupt load is measured. */
+#define ANALOG_LOAD_WINDOW       256
+
+/* Type Defines: */
+/** Axis values of one complete round of conversions. */
+typedef struct {
+	int16_t X;
+	int16_t Y;
+} AnalogAxes_t;
+
+/* External Variables: */
+extern AnalogAxes_t      Analog_Blocks[2];
+extern volatile uint8_t  Analog_ReadyBlock;
+extern volatile uint8_t  Analog_TicksMax;
+extern volatile uint16_t Analog_BusyTicks;
+extern volatile uint16_t Analog_WindowTicks;
+
+/* Inline Functions: */
+/** Returns the axes of the last complete round. The ADC interrupt fills the other block, so this
+ *  never waits for a conversion; it must be called with interrupts disabled, as the snapshot is.
+ */
+static inline void Analog_GetAxes(AnalogAxes_t* const Axes)
+{
+	*Axes = Analog_Blocks[Analog_ReadyBlock];
+}
+
+/* Function Prototypes: */
+void Analog_Init(void);
+void Analog_Stop(void);
+
+#endif
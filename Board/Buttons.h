@@ -51,16 +51,52 @@ extern "C" {
 #define BUTTONS_MASK  (BUTTONS_BUTTON1|BUTTONS_BUTTON2|BUTTONS_BUTTON3)
 
 #if !defined(__DOXYGEN__)
+/* Pins of the buttons of each player, one entry per button in BUTTONS_BUTTON* order:
+ * Pin(Player, Port, Mask, Shift) is the pin of Mask on Port, moved Shift bits to the left to its
+ * BUTTONS_BUTTON* bit. Player 1 is on Port F5-F7, player 2 of an INPUT_PLAYERS=2 build on Port F0,
+ * F1 and F4. */
+#if (INPUT_PLAYERS > 1)
+#define BUTTONS_PLAYER2_PINS(Pin)                                             \
+	Pin(1, F, (1 << 0), 5) Pin(1, F, (1 << 1), 5) Pin(1, F, (1 << 4), 3)
+#else
+#define BUTTONS_PLAYER2_PINS(Pin)
+#endif
+
+#define BUTTONS_PINS(Pin)                                                     \
+	Pin(0, F, (1 << 5), 0) Pin(0, F, (1 << 6), 0) Pin(0, F, (1 << 7), 0) \
+	BUTTONS_PLAYER2_PINS(Pin)
+
+#define BUTTONS_PIN_INIT(Player, Port, Mask, Shift)     \
+	DDR##Port  &= ~(Mask);                              \
+	PORT##Port |=  (Mask);
+
+#define BUTTONS_PIN_READ(PinPlayer, Port, Mask, Shift)  \
+	if ((PinPlayer) == Player)                          \
+		Status |= (uint8_t)((Pin##Port & (Mask)) << (Shift));
+
 	static inline void Buttons_Init(void)
 	{
-		DDRF  &= ~BUTTONS_MASK;
-		PORTF |=  BUTTONS_MASK;
+		BUTTONS_PINS(BUTTONS_PIN_INIT)
+	}
+
+	/** Returns the pressed buttons of the given player, 0 for player 1, in the BUTTONS_BUTTON*
+	 *  bits whatever pins they are on, as mapped by \ref BUTTONS_PINS.
+	 */
+	static inline uint8_t Buttons_GetPlayerStatus(const uint8_t Player) ATTR_WARN_UNUSED_RESULT;
+	static inline uint8_t Buttons_GetPlayerStatus(const uint8_t Player)
+	{
+		uint8_t PinF   = ~PINF;
+		uint8_t Status = 0;
+
+		BUTTONS_PINS(BUTTONS_PIN_READ)
+
+		return Status;
 	}
 
 	static inline uint8_t Buttons_GetStatus(void) ATTR_WARN_UNUSED_RESULT;
 	static inline uint8_t Buttons_GetStatus(void)
 	{
-		return ((PINF & BUTTONS_MASK) ^ BUTTONS_MASK);
+		return Buttons_GetPlayerStatus(0);
 	}
 #endif
 
@@ -44,6 +44,34 @@ extern "C" {
 #if !defined(__DOXYGEN__)
 #define JOY_MASK                 ((1 << 0) | (1 << 1) | (1 << 2) | (1 << 3))
 #define DIAL_MASK	(0x7f)
+
+/* Pins of the joystick directions of each player, one entry per direction in JOY_* bit order:
+ * Pin(Player, Port, Mask, Shift) is the pin of Mask on Port, moved Shift bits to the right to its
+ * JOY_* bit. Player 1 is on Port D0-D3; player 2 of an INPUT_PLAYERS=2 build has up and down on
+ * Port D4-D5, left on Port D7 and right on Port B7, as Port D6 drives the LED and Port B0-B6 is
+ * player 1's dial. JOY_PORTS lists the ports the entries are on. */
+#if (INPUT_PLAYERS > 1)
+#define JOY_PLAYER2_PINS(Pin)                                                            \
+	Pin(1, D, (1 << 4), 4) Pin(1, D, (1 << 5), 4) Pin(1, D, (1 << 7), 5) Pin(1, B, (1 << 7), 4)
+#define JOY_PORTS(Port)          Port(D) Port(B)
+#else
+#define JOY_PLAYER2_PINS(Pin)
+#define JOY_PORTS(Port)          Port(D)
+#endif
+
+#define JOY_PINS(Pin)                                                                   \
+	Pin(0, D, (1 << 0), 0) Pin(0, D, (1 << 1), 0) Pin(0, D, (1 << 2), 0) Pin(0, D, (1 << 3), 0) \
+	JOY_PLAYER2_PINS(Pin)
+
+#define JOY_PIN_INIT(Player, Port, Mask, Shift)         \
+	DDR##Port  &= ~(Mask);                              \
+	PORT##Port |= (Mask);
+
+#define JOY_PORT_READ(Port)      const uint8_t Pin##Port = ~PIN##Port;
+
+#define JOY_PIN_READ(PinPlayer, Port, Mask, Shift)      \
+	if ((PinPlayer) == Player)                          \
+		Status |= (uint8_t)((Pin##Port & (Mask)) >> (Shift));
 #endif
 
 	/* Public Interface - May be used in end-application: */
@@ -57,17 +85,31 @@ extern "C" {
 #if !defined(__DOXYGEN__)
 	static inline void Joystick_Init(void)
 	{
-		DDRD  &= ~JOY_MASK;
-		PORTD |= JOY_MASK;
+		JOY_PINS(JOY_PIN_INIT)
 
 		DDRB  &= ~DIAL_MASK;
 		PORTB |= DIAL_MASK;
 	}
 
+	/** Returns the joystick directions of the given player, 0 for player 1, in the JOY_* bits, as
+	 *  mapped by \ref JOY_PINS. The player is a constant in every caller, so the entries of the
+	 *  other players fold away and the pins of a player sharing a shift are moved together.
+	 */
+	static inline uint8_t Joystick_GetPlayerStatus(const uint8_t Player) ATTR_WARN_UNUSED_RESULT;
+	static inline uint8_t Joystick_GetPlayerStatus(const uint8_t Player)
+	{
+		uint8_t Status = 0;
+
+		JOY_PORTS(JOY_PORT_READ)
+		JOY_PINS(JOY_PIN_READ)
+
+		return Status;
+	}
+
 	static inline uint8_t Joystick_GetStatus(void) ATTR_WARN_UNUSED_RESULT;
 	static inline uint8_t Joystick_GetStatus(void)
 	{
-		return (uint8_t)(~PIND & JOY_MASK);
+		return Joystick_GetPlayerStatus(0);
 	}
 
 	static inline uint8_t Joystick_GetDial(void) ATTR_WARN_UNUSED_RESULT;
@@ -0,0 +1,113 @@
+/** \file
+ *
+ *  Boot timing. Timer1, the input time base, is started first thing in main() and extended to 32
+ *  bits by its overflow interrupt, so that the startup stages, from the clock setup through
+ *  enumeration to the first IN report, can be timestamped over the hundreds of milliseconds they
+ *  take. The extended count stays running after the boot as the time base of the main loop
+ *  scheduler, see \ref Boot_GetTimerTicks().
+ */
+
+#include "Boot.h"
+
+/** MCUSR and the system clock prescaler found at the start of main(). */
+static uint8_t ResetCause;
+static uint8_t ResetPrescaler;
+
+/** Timer1 overflows since the start of main(), the upper half of the extended time base. */
+static volatile uint16_t Overflows;
+
+/** Ticks added to the Timer1 count to make up for the ticks counted at the reset clock. */
+static uint32_t TicksOffset;
+
+static uint8_t  StagesReached;
+static uint32_t StageTicks[BOOT_STAGES];
+
+/** Returns the Timer1 count extended to 32 bits by its overflows, in Timer1 ticks since the start
+ *  of main(), wrapping after about 35 minutes. Unlike the 16-bit timestamps it does not lose whole
+ *  Timer1 periods however long the caller went without reading it. Timer1 stops in power-down, so
+ *  the time does not advance while the device sleeps in USB suspend.
+ */
+uint32_t Boot_GetTimerTicks(void)
+{
+	uint16_t Count;
+	uint16_t High;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Count = Input_GetTimestamp();
+		High  = Overflows;
+
+		/* An overflow whose interrupt is still pending belongs to the count read */
+		if ((TIFR1 & (1 << TOV1)) && !(Count & 0x8000))
+			High++;
+	}
+
+	return (((uint32_t)High << 16) | Count);
+}
+
+/** Returns the boot time base in Timer1 ticks at F_CPU. */
+static uint32_t GetTicks(void)
+{
+	return (Boot_GetTimerTicks() + TicksOffset);
+}
+
+/** Records the reset cause and starts the Timer1 time base, must be called first in main(). */
+void Boot_Init(void)
+{
+	ResetCause     = MCUSR;
+	ResetPrescaler = (CLKPR & ((1 << CLKPS3) | (1 << CLKPS2) | (1 << CLKPS1) | (1 << CLKPS0)));
+
+	/* A bootloader may have left Timer1 running */
+	TCNT1   = 0;
+	Input_InitTimer();
+
+	TIFR1   = (1 << TOV1);
+	TIMSK1 |= (1 << TOIE1);
+}
+
+/** Records the time the given stage is reached, unless it was reached before. The clock stage must
+ *  be recorded right after the system clock prescaler is set.
+ *
+ *  \param[in] Stage  Stage reached, a value from \ref Boot_Stages_t
+ */
+void Boot_Record(const uint8_t Stage)
+{
+	uint32_t Ticks;
+
+	if (StagesReached & (1 << Stage))
+		return;
+
+	/* Timer1 ran at the reset clock until now, so each tick so far stands for several at F_CPU */
+	if (Stage == BOOT_STAGE_Clock) {
+		uint16_t Count = Input_GetTimestamp();
+
+		TicksOffset = (((uint32_t)Count << ResetPrescaler) - Count);
+	}
+
+	Ticks = GetTicks();
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		StageTicks[Stage] = Ticks;
+		StagesReached    |= (1 << Stage);
+	}
+}
+
+/** Fills in the boot timing feature report. */
+void Boot_GetReport(Boot_Report_t* const Report)
+{
+	Report->ResetCause = ResetCause;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Report->StagesReached = StagesReached;
+
+		for (uint8_t i = 0; i < BOOT_STAGES; i++)
+			Report->Stage[i] = (StageTicks[i] / INPUT_TICKS_PER_US);
+	}
+}
+
+ISR(TIMER1_OVF_vect)
+{
+	Overflows++;
+}
@@ -0,0 +1,51 @@
+/** \file
+ *
+ *  Header file for Boot.c.
+ */
+
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+/* Includes: */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Input.h"
+
+/* Macros: */
+/** Number of stages in \ref Boot_Report_t. */
+#define BOOT_STAGES              7
+
+/* Type Defines: */
+/** Startup stages whose time is recorded, in the order they are normally reached. */
+enum Boot_Stages_t
+{
+	BOOT_STAGE_Clock       = 0, /**< System clock prescaler set to F_CPU */
+	BOOT_STAGE_USBInit     = 1, /**< USB_Init() returned, the PLL is locked and the device attached */
+	BOOT_STAGE_InputInit   = 2, /**< Board drivers, settings and input interrupts initialized */
+	BOOT_STAGE_Connect     = 3, /**< VBUS seen, EVENT_USB_Device_Connect() */
+	BOOT_STAGE_BusReset    = 4, /**< First bus reset from the host, EVENT_USB_Device_Reset() */
+	BOOT_STAGE_Configured  = 5, /**< SET_CONFIGURATION, EVENT_USB_Device_ConfigurationChanged() */
+	BOOT_STAGE_FirstReport = 6, /**< First IN report committed to an endpoint */
+};
+
+/** Boot timing feature report, all fields little endian. The times count from the start of main(),
+ *  the time from the power-on reset to main() is set by the start-up time fuses and the bootloader
+ *  and cannot be measured by the firmware.
+ */
+typedef struct {
+	uint8_t  ResetCause;          /**< MCUSR at the start of main(): PORF, EXTRF, BORF, WDRF and JTRF */
+	uint8_t  StagesReached;       /**< Bit n is set once stage n of \ref Boot_Stages_t is reached */
+	uint32_t Stage[BOOT_STAGES];  /**< Time each stage was first reached, in microseconds */
+} Boot_Report_t;
+
+/* Function Prototypes: */
+void Boot_Init(void);
+uint32_t Boot_GetTimerTicks(void);
+void Boot_Record(const uint8_t Stage);
+void Boot_GetReport(Boot_Report_t* const Report);
+
+#endif
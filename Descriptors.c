@@ -30,20 +30,218 @@
 
 #include "Descriptors.h"
 
+/** Vendor defined collection holding the statistics, settings, boot timing and task load feature
+ *  reports, see \ref Stats_Report_t, \ref Settings_t, \ref Boot_Report_t and \ref Scheduler_Report_t. The
+ *  reports are read with GET_REPORT and start with their report ID like the input reports do, the
+ *  settings are written with SET_REPORT.
+ */
+#define HID_DESCRIPTOR_VENDOR                                                \
+	HID_RI_USAGE_PAGE(16, 0xFF00),                                           \
+	HID_RI_USAGE(8, 0x01),                                                   \
+	HID_RI_COLLECTION(8, 0x01),                                              \
+		HID_RI_LOGICAL_MINIMUM(8, 0x00),                                     \
+		HID_RI_LOGICAL_MAXIMUM(16, 0xFF),                                    \
+		HID_RI_REPORT_SIZE(8, 0x08),                                         \
+		HID_RI_REPORT_ID(8, HID_REPORTID_Stats),                             \
+		HID_RI_USAGE(8, 0x02),                                               \
+		HID_RI_REPORT_COUNT(8, sizeof(Stats_Report_t)),                      \
+		HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE), \
+		HID_RI_REPORT_ID(8, HID_REPORTID_Settings),                          \
+		HID_RI_USAGE(8, 0x03),                                               \
+		HID_RI_REPORT_COUNT(8, sizeof(Settings_t)),                          \
+		HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE), \
+		HID_RI_REPORT_ID(8, HID_REPORTID_Boot),                              \
+		HID_RI_USAGE(8, 0x04),                                               \
+		HID_RI_REPORT_COUNT(8, sizeof(Boot_Report_t)),                       \
+		HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE), \
+		HID_RI_REPORT_ID(8, HID_REPORTID_Tasks),                             \
+		HID_RI_USAGE(8, 0x05),                                               \
+		HID_RI_REPORT_COUNT(8, sizeof(Scheduler_Report_t)),                  \
+		HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE), \
+	HID_RI_END_COLLECTION(0)
+
+/** Time from the earliest input edge of the report to its Start Of Frame, in microseconds, appended
+ *  to the joystick or combined report of an EDGE_TIMESTAMP build in a vendor defined collection.
+ */
+#define HID_DESCRIPTOR_EDGE_TIME                                             \
+	HID_RI_USAGE_PAGE(16, 0xFF00),                                           \
+	HID_RI_USAGE(8, 0x06),                                                   \
+	HID_RI_COLLECTION(8, 0x01),                                              \
+		HID_RI_USAGE(8, 0x06),                                               \
+		HID_RI_LOGICAL_MINIMUM(8, 0x00),                                     \
+		HID_RI_LOGICAL_MAXIMUM(32, 0xFFFF),                                  \
+		HID_RI_REPORT_SIZE(8, 16),                                           \
+		HID_RI_REPORT_COUNT(8, 1),                                           \
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE), \
+	HID_RI_END_COLLECTION(0)
+
+/** Digital joystick and three buttons of one player, as a physical collection in the joystick
+ *  application collection. Each player has its own pair of axes and buttons: player 1 X/Y and
+ *  buttons 1-3, player 2 Z/Rz and buttons 4-6.
+ */
+#define HID_DESCRIPTOR_PLAYER(UsageX, UsageY, FirstButton)                   \
+	HID_RI_USAGE_PAGE(8, 0x01),                                              \
+	HID_RI_USAGE(8, 0x01),                                                   \
+	HID_RI_COLLECTION(8, 0x00),                                              \
+		HID_RI_USAGE(8, UsageX),                                             \
+		HID_RI_USAGE(8, UsageY),                                             \
+		HID_RI_LOGICAL_MINIMUM(8, -1),                                       \
+		HID_RI_LOGICAL_MAXIMUM(8, 1),                                        \
+		HID_RI_REPORT_COUNT(8, 2),                                           \
+		HID_RI_REPORT_SIZE(8, 8),                                            \
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE), \
+	HID_RI_END_COLLECTION(0),                                                \
+	HID_RI_USAGE_PAGE(8, 0x09),                                              \
+	HID_RI_USAGE_MINIMUM(8, FirstButton),                                    \
+	HID_RI_USAGE_MAXIMUM(8, (FirstButton + 2)),                              \
+	HID_RI_LOGICAL_MINIMUM(8, 0),                                            \
+	HID_RI_LOGICAL_MAXIMUM(8, 1),                                            \
+	HID_RI_REPORT_SIZE(8, 1),                                                \
+	HID_RI_REPORT_COUNT(8, 3),                                               \
+	HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),     \
+	HID_RI_REPORT_SIZE(8, 5),                                                \
+	HID_RI_REPORT_COUNT(8, 1),                                               \
+	HID_RI_INPUT(8, HID_IOF_CONSTANT)
+
+#if defined(COMBINED_REPORT)
+const USB_Descriptor_HIDReport_Datatype_t PROGMEM ControllerReport[] = {
+	/* Digital Joystick with three buttons and the dial, in a single report:
+	 *   Report ID: HID_REPORTID_Controller
+	 *   X/Y Axis values: -1 to 1, or ANALOG_AXIS_MIN to ANALOG_AXIS_MAX in 16 bits (ANALOG_AXES)
+	 *   Buttons: 3
+	 *   Player 2 (INPUT_PLAYERS=2): Z/Rz Axis values -1 to 1, buttons 4-6
+	 *   Dial: relative, -127 to 127
+	 *   Edge time (EDGE_TIMESTAMP): 0 to 65535us
+	 */
+	HID_RI_USAGE_PAGE(8, 0x01),
+	HID_RI_USAGE(8, 0x04),
+	HID_RI_COLLECTION(8, 0x01),
+		HID_RI_REPORT_ID(8, HID_REPORTID_Controller),
+		HID_RI_USAGE(8, 0x01),
+		HID_RI_COLLECTION(8, 0x00),
+			HID_RI_USAGE(8, 0x30),
+			HID_RI_USAGE(8, 0x31),
+#if defined(ANALOG_AXES)
+			HID_RI_LOGICAL_MINIMUM(16, ANALOG_AXIS_MIN),
+			HID_RI_LOGICAL_MAXIMUM(16, ANALOG_AXIS_MAX),
+			HID_RI_REPORT_COUNT(8, 2),
+			HID_RI_REPORT_SIZE(8, 16),
+#else
+			HID_RI_LOGICAL_MINIMUM(8, -1),
+			HID_RI_LOGICAL_MAXIMUM(8, 1),
+			HID_RI_REPORT_COUNT(8, 2),
+			HID_RI_REPORT_SIZE(8, 8),
+#endif
+			HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_END_COLLECTION(0),
+		HID_RI_USAGE_PAGE(8, 0x09),
+		HID_RI_USAGE_MINIMUM(8, 0x01),
+		HID_RI_USAGE_MAXIMUM(8, 3),
+		HID_RI_LOGICAL_MINIMUM(8, 0),
+		HID_RI_LOGICAL_MAXIMUM(8, 1),
+		HID_RI_REPORT_SIZE(8, 1),
+		HID_RI_REPORT_COUNT(8, 3),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_REPORT_SIZE(8, 5),
+		HID_RI_REPORT_COUNT(8, 1),
+		HID_RI_INPUT(8, HID_IOF_CONSTANT),
+#if (INPUT_PLAYERS > 1)
+		HID_DESCRIPTOR_PLAYER(0x32, 0x35, 4),
+#endif
+		HID_RI_USAGE_PAGE(8, 0x01),
+		HID_RI_USAGE(8, 0x37),
+		HID_RI_LOGICAL_MINIMUM(8, -127),
+		HID_RI_LOGICAL_MAXIMUM(8, 127),
+		HID_RI_REPORT_SIZE(8, 8),
+		HID_RI_REPORT_COUNT(8, 1),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
+	HID_RI_END_COLLECTION(0),
+#if defined(EDGE_TIMESTAMP)
+	HID_DESCRIPTOR_EDGE_TIME,
+#endif
+	HID_DESCRIPTOR_VENDOR
+};
+#else
 const USB_Descriptor_HIDReport_Datatype_t PROGMEM MouseReport[] = {
 	/* from -127 to 127, 1 button (fake), relative */
 	HID_DESCRIPTOR_MOUSE(-128, 127, -128, 127, 1, false)
 };
 
+#if defined(KEYBOARD_REPORT)
+const USB_Descriptor_HIDReport_Datatype_t PROGMEM KeyboardReport[] = {
+	/* N-key rollover keyboard, a bit per key, so that any number of inputs can be held together:
+	 *   Report ID: HID_REPORTID_Keyboard
+	 *   Modifiers: left control to right GUI, usages 0xE0 to 0xE7
+	 *   Keys: usages 0 to KEYBOARD_KEYS - 1
+	 */
+	HID_RI_USAGE_PAGE(8, 0x01),
+	HID_RI_USAGE(8, 0x06),
+	HID_RI_COLLECTION(8, 0x01),
+		HID_RI_REPORT_ID(8, HID_REPORTID_Keyboard),
+		HID_RI_USAGE_PAGE(8, 0x07),
+		HID_RI_USAGE_MINIMUM(8, SETTINGS_KEYCODE_MODIFIER_MIN),
+		HID_RI_USAGE_MAXIMUM(8, SETTINGS_KEYCODE_MODIFIER_MAX),
+		HID_RI_LOGICAL_MINIMUM(8, 0),
+		HID_RI_LOGICAL_MAXIMUM(8, 1),
+		HID_RI_REPORT_SIZE(8, 1),
+		HID_RI_REPORT_COUNT(8, 8),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_USAGE_MINIMUM(8, 0x00),
+		HID_RI_USAGE_MAXIMUM(8, (KEYBOARD_KEYS - 1)),
+		HID_RI_REPORT_COUNT(8, KEYBOARD_KEYS),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+	HID_RI_END_COLLECTION(0),
+	HID_DESCRIPTOR_VENDOR
+};
+#else
 const USB_Descriptor_HIDReport_Datatype_t PROGMEM JoystickReport[] = {
 	/* Digital Joystick with three buttons:
 	 * Mind the report id!
+	 *   Report ID: HID_REPORTID_Joystick
 	 *   Min X/Y Axis values: -1 (left/down)
 	 *   Max X/Y Axis values:  1 (right/up)
 	 *   Buttons: 3
+	 *   Player 2 (INPUT_PLAYERS=2): Z/Rz Axis values -1 to 1, buttons 4-6
+	 *   Edge time (EDGE_TIMESTAMP): 0 to 65535us
 	 */
-	HID_DESCRIPTOR_JOYSTICK(-1, 1, -1, 1, 3)
+	HID_RI_REPORT_ID(8, HID_REPORTID_Joystick),
+#if (INPUT_PLAYERS > 1)
+	HID_RI_USAGE_PAGE(8, 0x01),
+	HID_RI_USAGE(8, 0x04),
+	HID_RI_COLLECTION(8, 0x01),
+		HID_DESCRIPTOR_PLAYER(0x30, 0x31, 1),
+		HID_DESCRIPTOR_PLAYER(0x32, 0x35, 4),
+	HID_RI_END_COLLECTION(0),
+#elif defined(ANALOG_AXES)
+	/* Analog axes, 16-bit from ANALOG_AXIS_MIN to ANALOG_AXIS_MAX */
+	HID_DESCRIPTOR_JOYSTICK(ANALOG_AXIS_MIN, ANALOG_AXIS_MAX, ANALOG_AXIS_MIN, ANALOG_AXIS_MAX, 3),
+#else
+	HID_DESCRIPTOR_JOYSTICK(-1, 1, -1, 1, 3),
+#endif
+#if defined(EDGE_TIMESTAMP)
+	HID_DESCRIPTOR_EDGE_TIME,
+#endif
+	HID_DESCRIPTOR_VENDOR
+};
+#endif
+#endif
+
+#if defined(RAW_STREAM)
+const USB_Descriptor_HIDReport_Datatype_t PROGMEM StreamReport[] = {
+	/* Raw port samples, a vendor defined report without report ID that fills the endpoint, see
+	 * Stream_Report_t for its layout */
+	HID_RI_USAGE_PAGE(16, 0xFF00),
+	HID_RI_USAGE(8, 0x07),
+	HID_RI_COLLECTION(8, 0x01),
+		HID_RI_USAGE(8, 0x07),
+		HID_RI_LOGICAL_MINIMUM(8, 0x00),
+		HID_RI_LOGICAL_MAXIMUM(16, 0xFF),
+		HID_RI_REPORT_SIZE(8, 0x08),
+		HID_RI_REPORT_COUNT(8, sizeof(Stream_Report_t)),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+	HID_RI_END_COLLECTION(0)
 };
+#endif
 
 /** Device descriptor structure. This descriptor, located in FLASH memory, describes the overall
  *  device characteristics, including the supported USB version, control endpoint size and the
@@ -64,13 +262,49 @@ const USB_Descriptor_Device_t PROGMEM DeviceDescriptor = {
 	.ProductID              = 0x2043,
 	.ReleaseNumber          = VERSION_BCD(00.01),
 
-	.ManufacturerStrIndex   = 0x01,
-	.ProductStrIndex        = 0x02,
+	.ManufacturerStrIndex   = STRING_ID_Manufacturer,
+	.ProductStrIndex        = STRING_ID_Product,
 	.SerialNumStrIndex      = NO_DESCRIPTOR,
 
 	.NumberOfConfigurations = FIXED_NUM_CONFIGURATIONS
 };
 
+/** Interface, HID and endpoint descriptors of an entry of \ref HID_INTERFACES, in the configuration descriptor. */
+#define HID_INTERFACE_CONFIGURATION(Name, EPNum, EPSize, ReportType, FeatureReports) \
+	.Name##_Interface = {                                                                        \
+		.Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface}, \
+                                                                                                 \
+		.InterfaceNumber        = INTERFACE_##Name,                                              \
+		.AlternateSetting       = 0x00,                                                          \
+                                                                                                 \
+		.TotalEndpoints         = 1,                                                             \
+                                                                                                 \
+		.Class                  = HID_CSCP_HIDClass,                                             \
+		.SubClass               = HID_CSCP_NonBootSubclass,                                      \
+		.Protocol               = HID_CSCP_NonBootProtocol,                                      \
+                                                                                                 \
+		.InterfaceStrIndex      = NO_DESCRIPTOR                                                  \
+	},                                                                                           \
+                                                                                                 \
+	.Name##_HID = {                                                                              \
+		.Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t), .Type = HID_DTYPE_HID}, \
+                                                                                                 \
+		.HIDSpec                = VERSION_BCD(01.11),                                            \
+		.CountryCode            = 0x00,                                                          \
+		.TotalReportDescriptors = 1,                                                             \
+		.HIDReportType          = HID_DTYPE_Report,                                              \
+		.HIDReportLength        = sizeof(Name##Report)                                           \
+	},                                                                                           \
+                                                                                                 \
+	.Name##_ReportINEndpoint = {                                                                 \
+		.Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint}, \
+                                                                                                 \
+		.EndpointAddress        = (ENDPOINT_DESCRIPTOR_DIR_IN | (EPNum)),                        \
+		.Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA), \
+		.EndpointSize           = (EPSize),                                                      \
+		.PollingIntervalMS      = 0x01                                                           \
+	},
+
 /** Configuration descriptor structure. This descriptor, located in FLASH memory, describes the usage
  *  of the device in one of its supported configurations, including information about any device interfaces
  *  and endpoints. The descriptor is read out by the USB host during the enumeration process when selecting
@@ -81,105 +315,66 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor = {
 		.Header                 = {.Size = sizeof(USB_Descriptor_Configuration_Header_t), .Type = DTYPE_Configuration},
 
 		.TotalConfigurationSize = sizeof(USB_Descriptor_Configuration_t),
-		.TotalInterfaces        = 2,
+		.TotalInterfaces        = INTERFACE_COUNT,
 
 		.ConfigurationNumber    = 1,
 		.ConfigurationStrIndex  = NO_DESCRIPTOR,
 
-		.ConfigAttributes       = (USB_CONFIG_ATTR_BUSPOWERED | USB_CONFIG_ATTR_SELFPOWERED),
+		.ConfigAttributes       = (USB_CONFIG_ATTR_BUSPOWERED | USB_CONFIG_ATTR_SELFPOWERED | USB_CONFIG_ATTR_REMOTEWAKEUP),
 
 		.MaxPowerConsumption    = USB_CONFIG_POWER_MA(100)
 	},
 
-	.HID1_MouseInterface = {
-		.Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
-
-		.InterfaceNumber        = 0x00,
-		.AlternateSetting       = 0x00,
-
-		.TotalEndpoints         = 1,
-
-		.Class                  = HID_CSCP_HIDClass,
-		.SubClass               = HID_CSCP_NonBootSubclass,
-		.Protocol               = HID_CSCP_NonBootProtocol,
-
-		.InterfaceStrIndex      = NO_DESCRIPTOR
-	},
-
-	.HID1_MouseHID = {
-		.Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t), .Type = HID_DTYPE_HID},
-
-		.HIDSpec                = VERSION_BCD(01.11),
-		.CountryCode            = 0x00,
-		.TotalReportDescriptors = 1,
-		.HIDReportType          = HID_DTYPE_Report,
-		.HIDReportLength        = sizeof(MouseReport)
-	},
-
-	.HID1_ReportINEndpoint = {
-		.Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
-
-		.EndpointAddress        = (ENDPOINT_DESCRIPTOR_DIR_IN | MOUSE_EPNUM),
-		.Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
-		.EndpointSize           = HID_EPSIZE,
-		.PollingIntervalMS      = 0x01
-	},
-
-
-
-	.HID2_JoystickInterface = {
-		.Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
-
-		.InterfaceNumber        = 0x01,
-		.AlternateSetting       = 0x00,
-
-		.TotalEndpoints         = 1,
-
-		.Class                  = HID_CSCP_HIDClass,
-		.SubClass               = HID_CSCP_NonBootSubclass,
-		.Protocol               = HID_CSCP_NonBootProtocol,
-
-		.InterfaceStrIndex      = NO_DESCRIPTOR
-	},
-
-	.HID2_JoustickHID = {
-		.Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t), .Type = HID_DTYPE_HID},
-
-		.HIDSpec                = VERSION_BCD(01.11),
-		.CountryCode            = 0x00,
-		.TotalReportDescriptors = 1,
-		.HIDReportType          = HID_DTYPE_Report,
-		.HIDReportLength        = sizeof(JoystickReport)
-	},
-
-	.HID2_ReportINEndpoint = {
-		.Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
-
-		.EndpointAddress        = (ENDPOINT_DESCRIPTOR_DIR_IN | JOYSTICK_EPNUM),
-		.Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
-		.EndpointSize           = HID_EPSIZE,
-		.PollingIntervalMS      = 0x01
-	},
+	HID_INTERFACES(HID_INTERFACE_CONFIGURATION)
 };
 
+/** String descriptor of a wide string literal, its length is counted by the compiler. */
+#define STRING_DESCRIPTOR(String)                                                   \
+	{                                                                               \
+		.Header        = {.Size = USB_STRING_LEN((sizeof(String) / sizeof(wchar_t)) - 1), .Type = DTYPE_String}, \
+		.UnicodeString = String                                                     \
+	}
+
 const USB_Descriptor_String_t PROGMEM LanguageString = {
 	.Header                 = {.Size = USB_STRING_LEN(1), .Type = DTYPE_String},
 
 	.UnicodeString          = {LANGUAGE_ID_ENG}
 };
 
-const USB_Descriptor_String_t PROGMEM ManufacturerString = {
-	.Header                 = {.Size = USB_STRING_LEN(17), .Type = DTYPE_String},
+const USB_Descriptor_String_t PROGMEM ManufacturerString = STRING_DESCRIPTOR(L"FIXME Hackerspace");
 
-	.UnicodeString          = L"FIXME Hackerspace"
+const USB_Descriptor_String_t PROGMEM ProductString = STRING_DESCRIPTOR(L"TRON Joystick");
+
+/** String descriptors by index. */
+static const USB_Descriptor_String_t* const PROGMEM Strings[STRING_COUNT] = {
+	[STRING_ID_Language]     = &LanguageString,
+	[STRING_ID_Manufacturer] = &ManufacturerString,
+	[STRING_ID_Product]      = &ProductString,
 };
 
-const USB_Descriptor_String_t PROGMEM ProductString = {
-	.Header                 = {.Size = USB_STRING_LEN(13), .Type = DTYPE_String},
+/** HID class descriptors of an interface, see \ref HIDDescriptors. */
+typedef struct {
+	const void* HID;
+	const void* Report;
+	uint16_t    ReportSize;
+} HIDDescriptors_t;
+
+#define HID_INTERFACE_LOOKUP(Name, ...)                        \
+	[INTERFACE_##Name] = {                                     \
+		.HID        = &ConfigurationDescriptor.Name##_HID,     \
+		.Report     = Name##Report,                            \
+		.ReportSize = sizeof(Name##Report),                    \
+	},
 
-	.UnicodeString          = L"TRON Joystick"
+/** HID and report descriptors of each interface, by interface number. */
+static const HIDDescriptors_t PROGMEM HIDDescriptors[INTERFACE_COUNT] = {
+	HID_INTERFACES(HID_INTERFACE_LOOKUP)
 };
 
+/** Returns the descriptor requested by the host. The string and HID class descriptors are looked
+ *  up by index in the tables above, which are read from FLASH with memcpy_P() so that the pointers
+ *  they hold are read the same way on any target.
+ */
 uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
                                     const uint8_t wIndex,
                                     const void** const DescriptorAddress)
@@ -202,44 +397,29 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
 		break;
 
 	case DTYPE_String:
-		switch (DescriptorNumber) {
-		case 0x00:
-			Address = &LanguageString;
-			Size    = pgm_read_byte(&LanguageString.Header.Size);
-			break;
-		case 0x01:
-			Address = &ManufacturerString;
-			Size    = pgm_read_byte(&ManufacturerString.Header.Size);
-			break;
-		case 0x02:
-			Address = &ProductString;
-			Size    = pgm_read_byte(&ProductString.Header.Size);
-			break;
-		}
-		break;
+		if (DescriptorNumber < STRING_COUNT) {
+			const USB_Descriptor_String_t* String;
 
-	case HID_DTYPE_HID:
-		switch (wIndex) {
-		case 0:
-			Address = &ConfigurationDescriptor.HID1_MouseHID;
-			break;
-		case 1:
-			Address = &ConfigurationDescriptor.HID2_JoustickHID;
-			break;
+			memcpy_P(&String, &Strings[DescriptorNumber], sizeof(String));
+			Address = String;
+			Size    = pgm_read_byte(&String->Header.Size);
 		}
-		Size = sizeof(USB_HID_Descriptor_HID_t);
 		break;
 
+	case HID_DTYPE_HID:
 	case HID_DTYPE_Report:
-		switch (wIndex) {
-		case 0:
-			Address = &MouseReport;
-			Size = sizeof(MouseReport);
-			break;
-		case 1:
-			Address = &JoystickReport;
-			Size = sizeof(JoystickReport);
-			break;
+		if (wIndex < INTERFACE_COUNT) {
+			HIDDescriptors_t Interface;
+
+			memcpy_P(&Interface, &HIDDescriptors[wIndex], sizeof(Interface));
+
+			if (DescriptorType == HID_DTYPE_HID) {
+				Address = Interface.HID;
+				Size    = sizeof(USB_HID_Descriptor_HID_t);
+			} else {
+				Address = Interface.Report;
+				Size    = Interface.ReportSize;
+			}
 		}
 		break;
 	}
@@ -247,4 +427,3 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
 	*DescriptorAddress = Address;
 	return Size;
 }
-
@@ -32,21 +32,107 @@
 
 #include <LUFA/Drivers/USB/USB.h>
 
+#include "Analog.h"
+#include "Stats.h"
+#include "Settings.h"
+#include "Boot.h"
+#include "Scheduler.h"
+#include "Stream.h"
+
+/** Interface manifest of each interface profile, one entry per HID interface in interface number
+ *  order:
+ *
+ *  \code
+ *  HID_INTERFACE(Name, EndpointNumber, EndpointSize, ReportType, FeatureReports)
+ *  \endcode
+ *
+ *  Each entry generates the interface, HID and endpoint descriptors in the configuration
+ *  descriptor, the interface's entry in the HID and report descriptor lookup table, and the
+ *  Name_HID_Interface class driver instance in Joystick.c with a report buffer for ReportType, or
+ *  for the feature reports if FeatureReports is 1 and they are larger. The report descriptor must
+ *  be named NameReport. Exactly one interface carries the feature reports. The endpoints are
+ *  configured in this order, which must be ascending on the AVR.
+ *
+ *  HID_REPORT_INTERFACES lists the interfaces of the profile, whose reports are built once per input
+ *  snapshot. The RAW_STREAM build appends the raw port sample stream to any profile, as the last
+ *  interface so that the interface numbers of the others do not change; HID_INTERFACES lists them all.
+ */
+#if defined(COMBINED_REPORT)
+	#define HID_REPORT_INTERFACES(HID_INTERFACE)                                              \
+		HID_INTERFACE(Controller, CONTROLLER_EPNUM, HID_EPSIZE, USB_ControllerReport_Data_t, 1)
+#elif defined(KEYBOARD_REPORT)
+	#define HID_REPORT_INTERFACES(HID_INTERFACE)                                              \
+		HID_INTERFACE(Mouse, MOUSE_EPNUM, HID_EPSIZE, USB_MouseReport_Data_t, 0)              \
+		HID_INTERFACE(Keyboard, KEYBOARD_EPNUM, KEYBOARD_EPSIZE, USB_KeyboardReport_NKRO_Data_t, 1)
+#else
+	#define HID_REPORT_INTERFACES(HID_INTERFACE)                                              \
+		HID_INTERFACE(Mouse, MOUSE_EPNUM, HID_EPSIZE, USB_MouseReport_Data_t, 0)              \
+		HID_INTERFACE(Joystick, JOYSTICK_EPNUM, HID_EPSIZE, USB_JoystickReport_Players_t, 1)
+#endif
+
+#if defined(RAW_STREAM)
+	#define HID_STREAM_INTERFACE(HID_INTERFACE)                                               \
+		HID_INTERFACE(Stream, STREAM_EPNUM, STREAM_EPSIZE, Stream_Report_t, 0)
+#else
+	#define HID_STREAM_INTERFACE(HID_INTERFACE)
+#endif
+
+#define HID_INTERFACES(HID_INTERFACE)                                                         \
+	HID_REPORT_INTERFACES(HID_INTERFACE)                                                      \
+	HID_STREAM_INTERFACE(HID_INTERFACE)
+
+#define HID_INTERFACE_NUMBER(Name, ...)       INTERFACE_##Name,
+#define HID_INTERFACE_DESCRIPTORS(Name, ...)  USB_Descriptor_Interface_t Name##_Interface; \
+                                              USB_HID_Descriptor_HID_t   Name##_HID;       \
+                                              USB_Descriptor_Endpoint_t  Name##_ReportINEndpoint;
+
+/** Interface numbers, INTERFACE_Name for each entry of \ref HID_INTERFACES. */
+enum InterfaceNumbers_t
+{
+	HID_INTERFACES(HID_INTERFACE_NUMBER)
+	INTERFACE_COUNT
+};
+
+/** String descriptor indices. */
+enum StringIndices_t
+{
+	STRING_ID_Language     = 0x00,
+	STRING_ID_Manufacturer = 0x01,
+	STRING_ID_Product      = 0x02,
+	STRING_COUNT
+};
+
 typedef struct {
 	USB_Descriptor_Configuration_Header_t Config;
-	USB_Descriptor_Interface_t            HID1_MouseInterface;
-	USB_HID_Descriptor_HID_t              HID1_MouseHID;
-	USB_Descriptor_Endpoint_t             HID1_ReportINEndpoint;
-	USB_Descriptor_Interface_t            HID2_JoystickInterface;
-	USB_HID_Descriptor_HID_t              HID2_JoustickHID;
-	USB_Descriptor_Endpoint_t             HID2_ReportINEndpoint;
+	HID_INTERFACES(HID_INTERFACE_DESCRIPTORS)
 } USB_Descriptor_Configuration_t;
 
 #define MOUSE_EPNUM	1
 #define JOYSTICK_EPNUM  3
+#define KEYBOARD_EPNUM  3
+#define CONTROLLER_EPNUM  1
+#define STREAM_EPNUM    4
+
+/* Report IDs of the joystick or keyboard interface, or of the combined controller interface */
+#define HID_REPORTID_Joystick    0x01
+#define HID_REPORTID_Keyboard    0x01
+#define HID_REPORTID_Controller  0x01
+#define HID_REPORTID_Stats       0x02
+#define HID_REPORTID_Settings    0x03
+#define HID_REPORTID_Boot        0x04
+#define HID_REPORTID_Tasks       0x05
 
 #define HID_EPSIZE      8
 
+/** Number of keyboard usages with a bit in the NKRO keyboard report, from 0 to SETTINGS_KEYCODE_MAX. */
+#define KEYBOARD_KEYS   (SETTINGS_KEYCODE_MAX + 1)
+
+/** Endpoint size of the raw stream interface, a report without ID fills it. */
+#define STREAM_EPSIZE   STREAM_REPORT_SIZE
+
+/** Endpoint size of the keyboard interface, the report ID, the modifiers and the usage bitmap, 16 bytes. */
+#define KEYBOARD_EPSIZE (2 + (KEYBOARD_KEYS / 8))
+
 uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
 				    const uint8_t wIndex,
 				    const void** const DescriptorAddress)
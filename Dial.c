@@ -0,0 +1,178 @@
+/** \file
+ *
+ *  Dial decoder. Each raw position read from Port B is converted to a linear position, from Gray
+ *  code if the encoder outputs it (DIAL_GRAY_CODED), the motion since the previous position is
+ *  taken along the shortest way around the dial, and accumulated until a report can carry it to
+ *  the host.
+ *
+ *  A dial resting on the boundary between two positions flickers between them, which without a
+ *  filter sends a report of alternating single steps on every flip. Motion that continues in the
+ *  direction of the last accumulated motion, or reverses it by more than the hysteresis, is
+ *  accumulated at once. A reversal within the hysteresis is held until the dial has dwelt at the
+ *  reversed position for the dwell time, and dropped if the dial returns before that. The dwell is
+ *  timed with the extended Timer1 count of \ref Boot_GetTimerTicks(), since the dial may rest far
+ *  longer than the 32.768ms Timer1 period between the snapshots of a coalesced interval.
+ */
+
+#include "Dial.h"
+
+#if defined(DIAL_GRAY_CODED)
+/** Gray code to binary conversion of the 7-bit dial position. */
+static const uint8_t PROGMEM GrayToBinary[DIAL_POSITIONS] = {
+	  0,   1,   3,   2,   7,   6,   4,   5,  15,  14,  12,  13,   8,   9,  11,  10,
+	 31,  30,  28,  29,  24,  25,  27,  26,  16,  17,  19,  18,  23,  22,  20,  21,
+	 63,  62,  60,  61,  56,  57,  59,  58,  48,  49,  51,  50,  55,  54,  52,  53,
+	 32,  33,  35,  34,  39,  38,  36,  37,  47,  46,  44,  45,  40,  41,  43,  42,
+	127, 126, 124, 125, 120, 121, 123, 122, 112, 113, 115, 114, 119, 118, 116, 117,
+	 96,  97,  99,  98, 103, 102, 100, 101, 111, 110, 108, 109, 104, 105, 107, 106,
+	 64,  65,  67,  66,  71,  70,  68,  69,  79,  78,  76,  77,  72,  73,  75,  74,
+	 95,  94,  92,  93,  88,  89,  91,  90,  80,  81,  83,  82,  87,  86,  84,  85,
+};
+#endif
+
+/** Last decoded dial position, and the position up to which the motion has been accumulated. */
+static uint8_t Position;
+static uint8_t Accepted;
+
+/** Direction of the last accumulated motion, 1 or -1, 0 before the first. */
+static int8_t Direction;
+
+/** Extended Timer1 count the dial reached its current position at, the start of the dwell of a held
+ *  reversal.
+ */
+static uint32_t PositionSince;
+
+/** Dial position when the last report was built. */
+static uint8_t ReportedPosition;
+
+/** Motion not yet sent to the host, in report steps, saturating rather than wrapping around while
+ *  the host does not take it.
+ */
+static int16_t Accumulator;
+
+/** Report steps per dial step, negative to reverse the dial. */
+static int8_t Gain = 1;
+
+/** Reversals of up to this many dial steps are held, 0 disables the filter. */
+static uint8_t Hysteresis = DIAL_HYSTERESIS;
+
+/** Time a held reversal must rest before it is accumulated, in Timer1 ticks. */
+static uint16_t DwellTicks = (DIAL_DWELL_US * INPUT_TICKS_PER_US);
+
+/** Reports built with dial motion, and reports the jitter filter suppressed, wrapping around. */
+uint16_t Dial_ReportsEmitted;
+uint16_t Dial_ReportsFiltered;
+
+static inline uint8_t Decode(const uint8_t RawPosition)
+{
+#if defined(DIAL_GRAY_CODED)
+	return pgm_read_byte(&GrayToBinary[RawPosition & DIAL_MASK]);
+#else
+	return (RawPosition & DIAL_MASK);
+#endif
+}
+
+/** Starts decoding from the current dial position, so that power-up does not look like motion. */
+void Dial_Init(void)
+{
+	Position    = Decode(Joystick_GetDial());
+	Accepted    = Position;
+	Direction   = 0;
+	Accumulator = 0;
+
+	ReportedPosition = Position;
+}
+
+/** Sets the number of report steps per dial step, a negative gain reverses the dial. */
+void Dial_SetGain(const int8_t NewGain)
+{
+	Gain = NewGain;
+}
+
+/** Sets the jitter filter: reversals of up to the given number of dial steps are held until the
+ *  dial has rested for the given time in microseconds, a hysteresis of 0 disables the filter.
+ */
+void Dial_SetFilter(const uint8_t NewHysteresis,
+                    const uint16_t NewDwellUS)
+{
+	Hysteresis = NewHysteresis;
+	DwellTicks = (NewDwellUS * INPUT_TICKS_PER_US);
+}
+
+/** Accumulates the motion from the last accumulated position to the given raw dial position,
+ *  through the jitter filter. Positions wrap around, so the motion is taken as the shortest signed
+ *  distance over the dial, which is exact as long as the dial moves less than half a turn between
+ *  two updates. Must also be called with the position at each input snapshot, when held reversals
+ *  that have dwelt long enough are released.
+ *
+ *  \param[in] RawPosition  Raw dial position read from Port B
+ *  \param[in] Timestamp    Timer1 count the position was read at
+ */
+void Dial_Update(const uint8_t RawPosition,
+                 const uint16_t Timestamp)
+{
+	uint8_t  NewPosition = Decode(RawPosition);
+	uint32_t Now         = Boot_GetTimerTicks();
+	int8_t   Steps;
+	int16_t  Motion;
+
+	/* The position was read at most a snapshot interval ago, within the Timer1 period */
+	Now -= (uint16_t)((uint16_t)Now - Timestamp);
+
+	if (NewPosition != Position) {
+		Position      = NewPosition;
+		PositionSince = Now;
+	}
+
+	/* Sign extend the 7-bit difference to get a step count in [-64, 63] */
+	Steps = ((int8_t)((uint8_t)(Position - Accepted) << 1) >> 1);
+
+	/* Nothing new, or the dial came back before a held reversal dwelt long enough */
+	if (!(Steps))
+		return;
+
+	if (Hysteresis && Direction && ((Steps < 0) != (Direction < 0)) &&
+	    (abs(Steps) <= Hysteresis) && ((Now - PositionSince) < DwellTicks))
+	{
+		return;
+	}
+
+	Motion = (Steps * Gain);
+
+	if ((Motion > 0) && (Accumulator > (INT16_MAX - Motion)))
+		Accumulator = INT16_MAX;
+	else if ((Motion < 0) && (Accumulator < (INT16_MIN - Motion)))
+		Accumulator = INT16_MIN;
+	else
+		Accumulator += Motion;
+
+	Accepted  = Position;
+	Direction = ((Steps < 0) ? -1 : 1);
+}
+
+/** Removes as much of the accumulated motion as fits in a single report, and counts the report as
+ *  emitted, or as filtered if the dial moved since the last report but the filter held it back.
+ *  Without the filter such a report would have been sent.
+ *
+ *  \return Signed motion in report steps, zero if the dial has not moved
+ */
+int8_t Dial_TakeDelta(void)
+{
+	int16_t Delta = Accumulator;
+
+	if (Delta)
+		Dial_ReportsEmitted++;
+	else if (Position != ReportedPosition)
+		Dial_ReportsFiltered++;
+
+	ReportedPosition = Position;
+
+	if (Delta > DIAL_MAX_REPORT_DELTA)
+		Delta = DIAL_MAX_REPORT_DELTA;
+	else if (Delta < -DIAL_MAX_REPORT_DELTA)
+		Delta = -DIAL_MAX_REPORT_DELTA;
+
+	Accumulator -= Delta;
+
+	return Delta;
+}
@@ -0,0 +1,55 @@
+/** \file
+ *
+ *  Header file for Dial.c.
+ */
+
+#ifndef _DIAL_H_
+#define _DIAL_H_
+
+/* Includes: */
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <LUFA/Common/Common.h>
+#include <LUFA/Drivers/Board/Joystick.h>
+
+#include "Input.h"
+#include "Boot.h"
+
+/* Macros: */
+/** Number of absolute positions of the dial encoder. */
+#define DIAL_POSITIONS           (DIAL_MASK + 1)
+
+/** Largest motion reported in a single mouse report, any excess is carried to the next report. */
+#define DIAL_MAX_REPORT_DELTA    127
+
+/** Default number of dial steps up to which a reversal of the dial's motion is held by the jitter
+ *  filter, 0 disables the filter. Set at runtime by \ref Dial_SetFilter().
+ */
+#if !defined(DIAL_HYSTERESIS)
+#define DIAL_HYSTERESIS          1
+#endif
+
+/** Default time in microseconds a reversal held by the jitter filter must rest at its position
+ *  before it is reported. Set at runtime by \ref Dial_SetFilter().
+ */
+#if !defined(DIAL_DWELL_US)
+#define DIAL_DWELL_US            8000
+#endif
+
+/* External Variables: */
+extern uint16_t Dial_ReportsEmitted;
+extern uint16_t Dial_ReportsFiltered;
+
+/* Function Prototypes: */
+void    Dial_Init(void);
+void    Dial_SetGain(const int8_t NewGain);
+void    Dial_SetFilter(const uint8_t NewHysteresis,
+                       const uint16_t NewDwellUS);
+void    Dial_Update(const uint8_t RawPosition,
+                    const uint16_t Timestamp);
+int8_t  Dial_TakeDelta(void);
+
+#endif
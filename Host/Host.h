@@ -0,0 +1,107 @@
+/** \file
+ *
+ *  Interface between the host harness and the simulated ATmega32U4 and USB stack the firmware
+ *  runs against in the host build.
+ */
+
+#ifndef _HOST_H_
+#define _HOST_H_
+
+/* Includes: */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <avr/io.h>
+#include <LUFA/Drivers/USB/USB.h>
+
+/* Macros: */
+/** Highest endpoint number of the simulated USB controller. */
+#define HOST_MAX_ENDPOINTS      7
+
+/** Largest endpoint bank of the simulated USB controller. */
+#define HOST_MAX_ENDPOINT_SIZE  64
+
+/** Number of simulated ADC inputs, ADC0 and ADC1 on Port F0 and F1. */
+#define HOST_ADC_CHANNELS       2
+
+/** AVcc, the reference of the simulated ADC, in millivolts. */
+#define HOST_ADC_VREF_MV        5000
+
+/** Peak noise added to each simulated conversion, in sixteenths of an LSB. */
+#if !defined(HOST_ADC_NOISE)
+#define HOST_ADC_NOISE          16
+#endif
+
+/** Offset of the host's IN tokens from the start of each frame, in microseconds. */
+#if !defined(HOST_IN_OFFSET_US)
+#define HOST_IN_OFFSET_US       50
+#endif
+
+/** Watchdog timeout at its shortest period, 2048 cycles of its 128kHz oscillator. */
+#define HOST_WATCHDOG_CYCLES    HOST_US_TO_CYCLES(16000)
+
+/** Converts simulated CPU cycles to microseconds. */
+#define HOST_CYCLES_TO_US(c)    ((c) / (F_CPU / 1000000UL))
+
+/** Converts microseconds to simulated CPU cycles. */
+#define HOST_US_TO_CYCLES(us)   ((uint64_t)(us) * (F_CPU / 1000000UL))
+
+/* Type Defines: */
+/** Bus events of the trace and of the device, see Host_MetricsBus(). */
+enum Host_BusEvents_t
+{
+	HOST_BUS_None         = 0,
+	HOST_BUS_Suspend      = 1, /**< The host stops the frames, the device suspends 3ms later */
+	HOST_BUS_Resume       = 2, /**< The host resumes the bus, on its own or after a remote wakeup */
+	HOST_BUS_RemoteWakeup = 3, /**< The device signals remote wakeup */
+};
+
+/* External Variables: */
+extern uint64_t Host_Cycles;
+extern uint32_t Host_Wakeups;
+extern uint64_t Host_PowerDownCycles;
+
+/* Function Prototypes: */
+/* HostIO.c */
+void     Host_AdvanceCycles(uint64_t Cycles);
+void     Host_DispatchInterrupts(void);
+void     Host_SyncFlags(void);
+void     Host_SetPins(const uint8_t PinD,
+                      const uint8_t PinB,
+                      const uint8_t PinF);
+void     Host_SetAnalog(const uint16_t Millivolts0,
+                        const uint16_t Millivolts1);
+
+/* HostMetrics.c */
+void     Host_MetricsStart(void);
+void     Host_MetricsPins(const uint64_t Cycles,
+                          const uint8_t PinD,
+                          const uint8_t PinB,
+                          const uint8_t PinF);
+void     Host_MetricsReport(const uint64_t Cycles,
+                            const uint8_t EndpointNumber,
+                            const uint8_t* const Report,
+                            const uint16_t Length);
+void     Host_MetricsBus(const uint64_t Cycles,
+                         const uint8_t Event);
+void     Host_MetricsSampled(const uint8_t PinD,
+                             const uint8_t PinB,
+                             const uint8_t PinF);
+void     Host_MetricsFinish(const uint64_t Cycles);
+
+/* HostUSB.c */
+void     Host_USBConnect(void);
+void     Host_USBStartOfFrame(void);
+void     Host_USBSuspend(void);
+void     Host_USBResume(void);
+bool     Host_USBTakeRemoteWakeup(void);
+int16_t  Host_USBControlRequest(const USB_Request_Header_t* const Request,
+                                void* const Data);
+uint16_t Host_USBReadIN(const uint8_t EndpointNumber,
+                        uint8_t* const Buffer);
+bool     Host_USBIsINEndpoint(const uint8_t EndpointNumber);
+
+/* Provided by the harness, called once per main loop iteration from USB_USBTask() */
+void     Host_Yield(void);
+
+#endif
@@ -0,0 +1,618 @@
+/** \file
+ *
+ *  Unit tests of the firmware's descriptor lookup, report generation and change detection, run by
+ *  "make check". The firmware is linked as for the trace harness, but with its main() renamed: the
+ *  tests set the device up and run the main loop themselves for as long as each step takes. Every
+ *  main loop iteration still ends in USB_USBTask(), which yields here to advance the simulated
+ *  time, start the frames and poll the IN endpoints once per frame like the host controller.
+ *
+ *  Each failed check is printed on stderr with its line; the exit status is non-zero if any
+ *  check failed.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/sleep.h>
+
+#include "Host.h"
+#include "Joystick.h"
+#include "Boot.h"
+#include "Scheduler.h"
+
+/** CPU cycles taken by one iteration of the firmware main loop, as in HostTrace.c. */
+#define CHECK_LOOP_CYCLES     160
+
+/** Granularity of the simulated time while the CPU sleeps, in cycles. */
+#define CHECK_SLEEP_STEP_CYCLES 16
+
+#define CHECK_FRAME_CYCLES    HOST_US_TO_CYCLES(1000)
+#define CHECK_NEVER           UINT64_MAX
+
+/** Idle levels of the ports, all inputs released and pulled up. */
+#define CHECK_IDLE_PIND       0xFF
+#define CHECK_IDLE_PINB       0xFF
+#define CHECK_IDLE_PINF       0xFF
+
+/** Interface, endpoint, ID and size of the report carrying player 1's joystick and buttons. The
+ *  reports of the keyboard profile, which maps them to keys, and of the ANALOG_AXES build, which
+ *  reads the stick from the ADC, are not checked.
+ */
+#if defined(COMBINED_REPORT) && !defined(ANALOG_AXES)
+	#define CHECK_REPORT_INTERFACE  INTERFACE_Controller
+	#define CHECK_REPORT_EPNUM      CONTROLLER_EPNUM
+	#define CHECK_REPORT_ID         HID_REPORTID_Controller
+	#define CHECK_REPORT_SIZE       (1 + sizeof(USB_ControllerReport_Data_t))
+#elif !defined(KEYBOARD_REPORT) && !defined(ANALOG_AXES)
+	#define CHECK_REPORT_INTERFACE  INTERFACE_Joystick
+	#define CHECK_REPORT_EPNUM      JOYSTICK_EPNUM
+	#define CHECK_REPORT_ID         HID_REPORTID_Joystick
+	#define CHECK_REPORT_SIZE       (1 + sizeof(USB_JoystickReport_Players_t))
+#endif
+
+#define CHECK(Condition)      Check((Condition), #Condition, __LINE__)
+
+static uint64_t NextFrameCycles;
+static uint64_t NextPollCycles = CHECK_NEVER;
+
+/** Reports received on each IN endpoint since the last ClearReports(), and the last one of each. */
+static uint32_t Reports[HOST_MAX_ENDPOINTS + 1];
+static uint8_t  LastReport[HOST_MAX_ENDPOINTS + 1][HOST_MAX_ENDPOINT_SIZE];
+static uint16_t LastLength[HOST_MAX_ENDPOINTS + 1];
+
+#if defined(RAW_STREAM)
+/** Index of the next raw stream sample, and the samples missing between consecutive reports. */
+static uint16_t StreamNext;
+static uint32_t StreamLost;
+static bool     StreamStarted;
+#endif
+
+static uint32_t Checks;
+static uint32_t Failures;
+
+static void Check(const bool Passed,
+                  const char* const Condition,
+                  const int Line)
+{
+	Checks++;
+
+	if (!Passed) {
+		Failures++;
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, Line, Condition);
+	}
+}
+
+#if defined(RAW_STREAM)
+/** Follows the sample indices of a raw stream report, see Stream_Report_t. */
+static void StreamReport(const uint8_t* const Report)
+{
+	uint16_t Index   = (Report[0] | (Report[1] << 8));
+	uint16_t End     = (STREAM_HEADER_SIZE + Report[2]);
+	uint16_t Samples = 1;
+
+	for (uint16_t Offset = STREAM_HEADER_SIZE; Offset < End; ) {
+		uint8_t Token = Report[Offset++];
+
+		Offset  += (!!(Token & STREAM_TOKEN_PIND) + !!(Token & STREAM_TOKEN_PINB) + !!(Token & STREAM_TOKEN_PINF));
+		Samples += ((Token & STREAM_TOKEN_RUN_MASK) + 1);
+	}
+
+	if (StreamStarted)
+		StreamLost += (uint16_t)(Index - StreamNext);
+
+	StreamNext    = (Index + Samples);
+	StreamStarted = true;
+}
+#endif
+
+static void PollEndpoints(void)
+{
+	for (uint8_t EndpointNumber = 1; EndpointNumber <= HOST_MAX_ENDPOINTS; EndpointNumber++) {
+		uint8_t  Buffer[HOST_MAX_ENDPOINT_SIZE];
+		uint16_t Length;
+
+		if (!Host_USBIsINEndpoint(EndpointNumber) || !(Length = Host_USBReadIN(EndpointNumber, Buffer)))
+			continue;
+
+		Reports[EndpointNumber]++;
+		LastLength[EndpointNumber] = Length;
+		memcpy(LastReport[EndpointNumber], Buffer, Length);
+
+#if defined(RAW_STREAM)
+		if (EndpointNumber == STREAM_EPNUM)
+			StreamReport(Buffer);
+#endif
+	}
+}
+
+static void ClearReports(void)
+{
+	memset(Reports, 0, sizeof(Reports));
+}
+
+/** Advances the simulated time up to the given cycle count, with the frames and IN polls due. */
+static void RunUntil(const uint64_t Target)
+{
+	for (;;) {
+		uint64_t Next = MIN(NextFrameCycles, NextPollCycles);
+
+		if (Next > Target)
+			break;
+
+		if (Next > Host_Cycles)
+			Host_AdvanceCycles(Next - Host_Cycles);
+
+		if (Next == NextFrameCycles) {
+			NextPollCycles   = (NextFrameCycles + HOST_US_TO_CYCLES(HOST_IN_OFFSET_US));
+			NextFrameCycles += CHECK_FRAME_CYCLES;
+			Host_USBStartOfFrame();
+		} else {
+			NextPollCycles = CHECK_NEVER;
+			PollEndpoints();
+		}
+	}
+
+	Host_AdvanceCycles(Target - Host_Cycles);
+}
+
+void Host_Yield(void)
+{
+	RunUntil(Host_Cycles + CHECK_LOOP_CYCLES);
+}
+
+void Host_Sleep(void)
+{
+	uint32_t Wakeups = Host_Wakeups;
+
+	if (!(SMCR & (1 << SE)))
+		return;
+
+	Host_DispatchInterrupts();
+
+	while (Host_Wakeups == Wakeups)
+		RunUntil(Host_Cycles + CHECK_SLEEP_STEP_CYCLES);
+}
+
+/** Runs the firmware's main loop for the given time. */
+static void Run(const uint32_t Microseconds)
+{
+	uint64_t Target = (Host_Cycles + HOST_US_TO_CYCLES(Microseconds));
+
+	while (Host_Cycles < Target)
+		Scheduler_Run();
+}
+
+/** Sets the device up as its main() does with the given joystick port, and has the host enumerate
+ *  it and start the frames.
+ */
+static void Start(const uint8_t PinD)
+{
+	PIND = PinD;
+	PINB = CHECK_IDLE_PINB;
+	PINF = CHECK_IDLE_PINF;
+
+	Boot_Init();
+	SetupHardware();
+	Scheduler_Init();
+	sei();
+
+	Host_USBConnect();
+	NextFrameCycles = Host_Cycles;
+}
+
+/** Looks every descriptor up, and the ones past the last string and interface, which must not exist. */
+static void CheckDescriptorLookup(void)
+{
+	const USB_Descriptor_Device_t*        Device;
+	const USB_Descriptor_Configuration_t* Config;
+	const void*                           Address;
+	uint16_t                              Size;
+	uint8_t                               Interfaces = 0;
+
+	Size = CALLBACK_USB_GetDescriptor((DTYPE_Device << 8), 0, (const void**)&Device);
+	CHECK(Size == sizeof(USB_Descriptor_Device_t));
+	CHECK(Device->Header.Size == Size);
+	CHECK(Device->Header.Type == DTYPE_Device);
+	CHECK(Device->ProductStrIndex == STRING_ID_Product);
+
+	Size = CALLBACK_USB_GetDescriptor((DTYPE_Configuration << 8), 0, (const void**)&Config);
+	CHECK(Size == sizeof(USB_Descriptor_Configuration_t));
+	CHECK(Config->Config.TotalConfigurationSize == Size);
+	CHECK(Config->Config.TotalInterfaces == INTERFACE_COUNT);
+
+	for (uint8_t Index = 0; Index < STRING_COUNT; Index++) {
+		const USB_Descriptor_String_t* String;
+
+		Size = CALLBACK_USB_GetDescriptor(((DTYPE_String << 8) | Index), 0, (const void**)&String);
+		CHECK((Size >= sizeof(USB_Descriptor_Header_t)) && (String->Header.Size == Size));
+		CHECK(String->Header.Type == DTYPE_String);
+	}
+
+	CHECK(CALLBACK_USB_GetDescriptor(((DTYPE_String << 8) | STRING_COUNT), 0, &Address) == NO_DESCRIPTOR);
+
+	/* Each interface's HID descriptor is the one in the configuration descriptor, and announces
+	 * the length of its report descriptor */
+	for (uint16_t Offset = sizeof(USB_Descriptor_Configuration_Header_t); Offset < sizeof(*Config);) {
+		const uint8_t*                  Descriptor = &((const uint8_t*)Config)[Offset];
+		const USB_HID_Descriptor_HID_t* HID;
+		uint8_t                         Interface;
+
+		CHECK(Descriptor[0] >= sizeof(USB_Descriptor_Header_t));
+		if (Descriptor[0] < sizeof(USB_Descriptor_Header_t))
+			break;
+
+		Offset += Descriptor[0];
+
+		if (Descriptor[1] != DTYPE_Interface)
+			continue;
+
+		Interface = ((const USB_Descriptor_Interface_t*)Descriptor)->InterfaceNumber;
+		CHECK(Interface == Interfaces++);
+
+		Size = CALLBACK_USB_GetDescriptor((HID_DTYPE_HID << 8), Interface, (const void**)&HID);
+		CHECK(Size == sizeof(USB_HID_Descriptor_HID_t));
+		CHECK(!memcmp(HID, &Descriptor[sizeof(USB_Descriptor_Interface_t)], sizeof(*HID)));
+
+		Size = CALLBACK_USB_GetDescriptor((HID_DTYPE_Report << 8), Interface, &Address);
+		CHECK((Address != NULL) && (Size == HID->HIDReportLength));
+	}
+
+	CHECK(Interfaces == INTERFACE_COUNT);
+	CHECK(CALLBACK_USB_GetDescriptor((HID_DTYPE_HID << 8), INTERFACE_COUNT, &Address) == NO_DESCRIPTOR);
+	CHECK(CALLBACK_USB_GetDescriptor((HID_DTYPE_Report << 8), INTERFACE_COUNT, &Address) == NO_DESCRIPTOR);
+	CHECK(CALLBACK_USB_GetDescriptor((DTYPE_Endpoint << 8), 0, &Address) == NO_DESCRIPTOR);
+}
+
+#if defined(CHECK_REPORT_EPNUM)
+/** Sends a HID class request to the given interface, returning the length of its data stage. */
+static int16_t ClassRequest(const uint8_t Direction,
+                            const uint8_t Request,
+                            const uint16_t wValue,
+                            const uint8_t Interface,
+                            uint8_t* const Data,
+                            const uint16_t Length)
+{
+	USB_Request_Header_t Header = {
+		.bmRequestType = (Direction | REQTYPE_CLASS | REQREC_INTERFACE),
+		.bRequest      = Request,
+		.wValue        = wValue,
+		.wIndex        = Interface,
+		.wLength       = Length,
+	};
+
+	return Host_USBControlRequest(&Header, Data);
+}
+
+/** Checks the last report against player 1's axes and buttons: the report ID, then X, Y and the
+ *  button bits of the first \ref USB_JoystickReport_Data_t.
+ */
+static void CheckJoystickReport(const int8_t X,
+                                const int8_t Y,
+                                const uint8_t Button)
+{
+	const uint8_t* Report = LastReport[CHECK_REPORT_EPNUM];
+
+	CHECK(LastLength[CHECK_REPORT_EPNUM] == CHECK_REPORT_SIZE);
+	CHECK(Report[0] == CHECK_REPORT_ID);
+	CHECK((int8_t)Report[1] == X);
+	CHECK((int8_t)Report[2] == Y);
+	CHECK(Report[3] == Button);
+}
+
+/** Holds the given pins for the given time, and checks that it produced exactly the given number
+ *  of reports, and no report of the dial.
+ */
+static void Hold(const uint8_t PinD,
+                 const uint8_t PinF,
+                 const uint32_t Microseconds,
+                 const uint32_t ExpectedReports)
+{
+	ClearReports();
+	Host_SetPins(PinD, CHECK_IDLE_PINB, PinF);
+	Run(Microseconds);
+
+	CHECK(Reports[CHECK_REPORT_EPNUM] == ExpectedReports);
+#if !defined(COMBINED_REPORT)
+	CHECK(Reports[MOUSE_EPNUM] == 0);
+#endif
+}
+
+/** Checks the report of each direction and button combination. */
+static void CheckReportGeneration(void)
+{
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 10000, 0);
+
+	Hold((CHECK_IDLE_PIND & ~(1 << 0)), CHECK_IDLE_PINF, 10000, 1);
+	CheckJoystickReport(0, -1, 0);
+
+	Hold((CHECK_IDLE_PIND & ~((1 << 1) | (1 << 3))), CHECK_IDLE_PINF, 10000, 1);
+	CheckJoystickReport(1, 1, 0);
+
+	Hold((CHECK_IDLE_PIND & ~(1 << 2)), (CHECK_IDLE_PINF & ~((1 << 5) | (1 << 7))), 10000, 1);
+	CheckJoystickReport(-1, 0, ((1 << 0) | (1 << 2)));
+
+	Hold(CHECK_IDLE_PIND, (CHECK_IDLE_PINF & ~(1 << 6)), 10000, 1);
+	CheckJoystickReport(0, 0, (1 << 1));
+
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 10000, 1);
+	CheckJoystickReport(0, 0, 0);
+}
+
+/** Checks that a report is sent once per change of the inputs, again only when the idle period
+ *  elapses, and not at all for a glitch shorter than the debounce time.
+ */
+static void CheckChangeDetection(void)
+{
+	uint8_t Idle[1];
+
+	/* The default idle period of LUFA is 500ms */
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 400000, 0);
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 200000, 1);
+	CheckJoystickReport(0, 0, 0);
+
+	/* Linux disables the idle reports */
+	CHECK(ClassRequest(REQDIR_HOSTTODEVICE, HID_REQ_SetIdle, 0, CHECK_REPORT_INTERFACE, NULL, 0) == 0);
+	CHECK(ClassRequest(REQDIR_DEVICETOHOST, HID_REQ_GetIdle, 0, CHECK_REPORT_INTERFACE, Idle, sizeof(Idle)) == 1);
+	CHECK(Idle[0] == 0);
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 1000000, 0);
+
+	Hold((CHECK_IDLE_PIND & ~(1 << 3)), CHECK_IDLE_PINF, 50000, 1);
+	CheckJoystickReport(1, 0, 0);
+
+	/* A glitch back to the idle level, well under the debounce time */
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 100, 0);
+	Hold((CHECK_IDLE_PIND & ~(1 << 3)), CHECK_IDLE_PINF, 50000, 0);
+
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 50000, 1);
+	CheckJoystickReport(0, 0, 0);
+}
+
+/** Reads the statistics feature report, returning the length the device answered with. */
+static int16_t GetStatsReport(Stats_Report_t* const Stats)
+{
+	uint8_t Report[1 + sizeof(Stats_Report_t)];
+	int16_t Length;
+
+	Length = ClassRequest(REQDIR_DEVICETOHOST, HID_REQ_GetReport,
+	                      (((HID_REPORT_ITEM_Feature + 1) << 8) | HID_REPORTID_Stats),
+	                      CHECK_REPORT_INTERFACE, Report, sizeof(Report));
+
+	CHECK(Report[0] == HID_REPORTID_Stats);
+	memcpy(Stats, &Report[1], sizeof(*Stats));
+
+	return Length;
+}
+
+/** Checks that reading a feature report neither sends an input report nor counts one as sent,
+ *  the feature report must not replace the last input report the next one is compared with.
+ */
+static void CheckFeatureReports(void)
+{
+	Stats_Report_t Before;
+	Stats_Report_t After;
+
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 10000, 0);
+
+	CHECK(GetStatsReport(&Before) == (1 + sizeof(Stats_Report_t)));
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 10000, 0);
+	CHECK(GetStatsReport(&After) == (1 + sizeof(Stats_Report_t)));
+	CHECK(After.ReportsSent == Before.ReportsSent);
+
+	Hold((CHECK_IDLE_PIND & ~(1 << 0)), CHECK_IDLE_PINF, 10000, 1);
+	CheckJoystickReport(0, -1, 0);
+	CHECK(GetStatsReport(&After) == (1 + sizeof(Stats_Report_t)));
+	CHECK(After.ReportsSent == (uint16_t)(Before.ReportsSent + 1));
+
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 10000, 1);
+	CheckJoystickReport(0, 0, 0);
+}
+
+/** Checks that GET_REPORT for the input report returns the last report sent, and leaves a change
+ *  still being debounced to the next IN report.
+ */
+static void CheckInputRequest(void)
+{
+	uint8_t Report[CHECK_REPORT_SIZE];
+
+	Hold(CHECK_IDLE_PIND, (CHECK_IDLE_PINF & ~(1 << 5)), 10000, 1);
+	CheckJoystickReport(0, 0, (1 << 0));
+
+	Hold((CHECK_IDLE_PIND & ~(1 << 2)), (CHECK_IDLE_PINF & ~(1 << 5)), 100, 0);
+	CHECK(ClassRequest(REQDIR_DEVICETOHOST, HID_REQ_GetReport,
+	                   (((HID_REPORT_ITEM_In + 1) << 8) | CHECK_REPORT_ID),
+	                   CHECK_REPORT_INTERFACE, Report, sizeof(Report)) == sizeof(Report));
+	CHECK(!memcmp(Report, LastReport[CHECK_REPORT_EPNUM], 4));
+
+	Hold((CHECK_IDLE_PIND & ~(1 << 2)), (CHECK_IDLE_PINF & ~(1 << 5)), 10000, 1);
+	CheckJoystickReport(-1, 0, (1 << 0));
+
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 10000, 1);
+	CheckJoystickReport(0, 0, 0);
+}
+
+/** Checks that the task loads are known after the first measurement window, an eighth of a second
+ *  after the start, and that the USB task's passes that only polled are not counted.
+ */
+static void CheckTaskLoad(void)
+{
+	uint8_t            Report[1 + sizeof(Scheduler_Report_t)];
+	Scheduler_Report_t Load;
+
+	Run(50000);
+
+	CHECK(ClassRequest(REQDIR_DEVICETOHOST, HID_REQ_GetReport,
+	                   (((HID_REPORT_ITEM_Feature + 1) << 8) | HID_REPORTID_Tasks),
+	                   CHECK_REPORT_INTERFACE, Report, sizeof(Report)) == sizeof(Report));
+	CHECK(Report[0] == HID_REPORTID_Tasks);
+	memcpy(&Load, &Report[1], sizeof(Load));
+
+	CHECK(Load.Task[SCHEDULER_TASK_Reports].Runs != 0);
+	CHECK(Load.Task[SCHEDULER_TASK_USB].LoadPermille < 1000);
+#if defined(RAW_STREAM)
+	/* The stream is drained every frame */
+	CHECK(Load.Task[SCHEDULER_TASK_USB].LoadPermille != 0);
+#else
+	/* The harness takes the control requests outside of the main loop */
+	CHECK(Load.Task[SCHEDULER_TASK_USB].Runs == 0);
+#endif
+}
+
+/** Writes the settings feature report, then runs the main loop until the settings task took it. */
+static void SetSettings(const Settings_t* const NewSettings)
+{
+	uint8_t Report[1 + sizeof(Settings_t)];
+
+	Report[0] = HID_REPORTID_Settings;
+	memcpy(&Report[1], NewSettings, sizeof(Settings_t));
+	CHECK(ClassRequest(REQDIR_HOSTTODEVICE, HID_REQ_SetReport,
+	                   (((HID_REPORT_ITEM_Feature + 1) << 8) | HID_REPORTID_Settings),
+	                   CHECK_REPORT_INTERFACE, Report, sizeof(Report)) == sizeof(Report));
+	Run(10000);
+}
+
+/** Checks that settings written by the host are taken by the settings task and read back, and
+ *  that invalid settings are ignored.
+ */
+static void CheckSettings(void)
+{
+	uint8_t    Report[1 + sizeof(Settings_t)];
+	Settings_t Original = Settings;
+	Settings_t Changed  = Settings;
+
+	Changed.DialGain = -2;
+	SetSettings(&Changed);
+	CHECK(!memcmp(&Settings, &Changed, sizeof(Settings_t)));
+
+	/* A zero dial gain is out of range */
+	Changed.DialGain = 0;
+	SetSettings(&Changed);
+	CHECK(Settings.DialGain == -2);
+
+	SetSettings(&Original);
+	CHECK(!memcmp(&Settings, &Original, sizeof(Settings_t)));
+
+#if !defined(COMBINED_REPORT)
+	/* The settings are only taken from the interface carrying the feature reports */
+	Changed.DialGain = -2;
+	Report[0] = HID_REPORTID_Settings;
+	memcpy(&Report[1], &Changed, sizeof(Settings_t));
+	CHECK(ClassRequest(REQDIR_HOSTTODEVICE, HID_REQ_SetReport,
+	                   (((HID_REPORT_ITEM_Feature + 1) << 8) | HID_REPORTID_Settings),
+	                   INTERFACE_Mouse, Report, sizeof(Report)) == sizeof(Report));
+	Run(10000);
+	CHECK(!memcmp(&Settings, &Original, sizeof(Settings_t)));
+#endif
+
+	memset(&Report[1], 0, sizeof(Settings_t));
+	CHECK(ClassRequest(REQDIR_DEVICETOHOST, HID_REQ_GetReport,
+	                   (((HID_REPORT_ITEM_Feature + 1) << 8) | HID_REPORTID_Settings),
+	                   CHECK_REPORT_INTERFACE, Report, sizeof(Report)) == sizeof(Report));
+	CHECK(!memcmp(&Report[1], &Original, sizeof(Settings_t)));
+}
+
+#if !defined(COMBINED_REPORT)
+/** Returns Port B with the dial the given number of steps past its idle position. */
+static uint8_t DialPins(const uint8_t Steps)
+{
+	uint8_t Position = (CHECK_IDLE_PINB & DIAL_MASK);
+
+#if defined(DIAL_GRAY_CODED)
+	for (uint8_t Shift = (Position >> 1); Shift; Shift >>= 1)
+		Position ^= Shift;
+
+	Position = ((Position + Steps) & DIAL_MASK);
+	Position ^= (Position >> 1);
+#else
+	Position = ((Position + Steps) & DIAL_MASK);
+#endif
+
+	return ((CHECK_IDLE_PINB & ~DIAL_MASK) | Position);
+}
+
+/** Checks that a reversal held by the dial jitter filter is reported once it has dwelt, when the
+ *  snapshots of a coalesced interval are further apart than the dwell and come at any phase of it.
+ */
+static void CheckDialDwell(void)
+{
+	Settings_t Original  = Settings;
+	Settings_t Coalesced = Settings;
+
+	Coalesced.CoalesceFrames = SETTINGS_COALESCE_MAX;
+	SetSettings(&Coalesced);
+
+	/* Every move after the first reverses the previous one */
+	for (uint8_t i = 0; i < 8; i++) {
+		ClearReports();
+		Host_SetPins(CHECK_IDLE_PIND, DialPins((i & 1) ? 0 : 1), CHECK_IDLE_PINF);
+		Run(45000 + (i * 5000));
+
+		CHECK(Reports[MOUSE_EPNUM] == 1);
+		CHECK((int8_t)LastReport[MOUSE_EPNUM][2] == ((i & 1) ? -Settings.DialGain : Settings.DialGain));
+	}
+
+	SetSettings(&Original);
+}
+#endif
+
+#if defined(RAW_STREAM)
+/** Checks that the raw stream is drained every frame, so that no sample is lost while the input
+ *  snapshots are taken only every few frames.
+ */
+static void CheckStream(void)
+{
+	Settings_t Original  = Settings;
+	Settings_t Coalesced = Settings;
+
+	Coalesced.CoalesceFrames = SETTINGS_COALESCE_MAX;
+	SetSettings(&Coalesced);
+
+	ClearReports();
+	StreamLost = 0;
+	Hold((CHECK_IDLE_PIND & ~(1 << 0)), CHECK_IDLE_PINF, 50000, 1);
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 50000, 1);
+	CHECK(StreamLost == 0);
+	CHECK(Reports[STREAM_EPNUM] >= 45);
+
+	SetSettings(&Original);
+}
+#endif
+#endif
+
+int main(void)
+{
+	CheckDescriptorLookup();
+
+	/* Up is held from power-on, through the input initialization and the configuration */
+	Start(CHECK_IDLE_PIND & ~(1 << 0));
+
+	/* The initial report sent right after the configuration carries it */
+	ClearReports();
+	Run(50000);
+#if defined(CHECK_REPORT_EPNUM)
+	CHECK(Reports[CHECK_REPORT_EPNUM] == 1);
+	CheckJoystickReport(0, -1, 0);
+
+	/* Its release is reported */
+	Hold(CHECK_IDLE_PIND, CHECK_IDLE_PINF, 50000, 1);
+	CheckJoystickReport(0, 0, 0);
+
+	CheckTaskLoad();
+	CheckReportGeneration();
+	CheckChangeDetection();
+	CheckFeatureReports();
+	CheckInputRequest();
+	CheckSettings();
+#if !defined(COMBINED_REPORT)
+	CheckDialDwell();
+#endif
+#if defined(RAW_STREAM)
+	CheckStream();
+#endif
+#endif
+
+	fprintf(stderr, "%" PRIu32 " checks, %" PRIu32 " failed\n", Checks, Failures);
+
+	return (Failures ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,348 @@
+/** \file
+ *
+ *  Simulated ATmega32U4 I/O: register storage, pin change and external interrupts on the input
+ *  ports, Timer1, the ADC and the watchdog interrupt. Interrupts are delivered between main loop
+ *  iterations, whenever the harness advances the simulated time or changes the pins. While the CPU
+ *  sleeps in power-down, or their clock is gated in PRR0, Timer1 and the ADC stand still.
+ */
+
+#include <stddef.h>
+
+#include <avr/sleep.h>
+
+#include "Host.h"
+
+#define HOST_DEFINE_REGISTER_8(Reg)   volatile uint8_t Reg;
+#define HOST_DEFINE_REGISTER_16(Reg)  volatile uint16_t Reg;
+
+HOST_REGISTERS_8(HOST_DEFINE_REGISTER_8)
+HOST_REGISTERS_16(HOST_DEFINE_REGISTER_16)
+
+/** Simulated CPU cycles since reset. */
+uint64_t Host_Cycles;
+
+/** Interrupts serviced so far, including the USB events, which wake the CPU from sleep. */
+uint32_t Host_Wakeups;
+
+/** Simulated cycles the CPU spent in power-down. */
+uint64_t Host_PowerDownCycles;
+
+/** Simulated cycle count at which the EEPROM write in progress completes, see <avr/eeprom.h>. */
+uint64_t Host_EEPROMReadyCycles;
+
+/** Voltages on the ADC inputs in millivolts, against the AVcc reference, see Host_SetAnalog(). */
+static uint16_t AnalogMillivolts[HOST_ADC_CHANNELS] = {
+	[0 ... (HOST_ADC_CHANNELS - 1)] = (HOST_ADC_VREF_MV / 2)
+};
+
+/** Cycles accumulated towards the next Timer1 tick. */
+static uint32_t Timer1Prescaler;
+
+/** Whether an ADC conversion is in progress, the cycles left until it completes and the channel
+ *  it samples, latched when it started.
+ */
+static bool     ADCConverting;
+static uint32_t ADCCyclesLeft;
+static uint8_t  ADCChannel;
+
+/** Cycles accumulated towards the next watchdog timeout. */
+static uint32_t WatchdogPrescaler;
+
+/** State of the pseudo random noise added to the conversions. */
+static uint32_t ADCNoise = 1;
+
+/** Pending interrupt flags. The flag registers are write-one-to-clear on the AVR, which plain
+ *  variables cannot model: the firmware-visible EIFR, PCIFR and TIFR1 only collect the bits written
+ *  since the last Host_SyncFlags(), which then clears them here. They always read back as zero.
+ */
+static uint8_t PendingEIFR;
+static uint8_t PendingPCIFR;
+static uint8_t PendingTIFR1;
+static bool    PendingADIF;
+static bool    PendingWDIF;
+
+static uint32_t ADCClockDivider(void)
+{
+	uint8_t Prescaler = (ADCSRA & ((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0)));
+
+	return (Prescaler ? (1 << Prescaler) : 2);
+}
+
+/** Applies the flag bits the firmware wrote, the firmware-visible flag registers read back as zero
+ *  afterwards. Atomic blocks call it on entry, as the firmware may read a flag register in them.
+ */
+void Host_SyncFlags(void)
+{
+	PendingEIFR  &= ~EIFR;
+	PendingPCIFR &= ~PCIFR;
+	PendingTIFR1 &= ~TIFR1;
+
+	if (ADCSRA & (1 << ADIF))
+		PendingADIF = false;
+
+	EIFR    = 0;
+	PCIFR   = 0;
+	TIFR1   = 0;
+	ADCSRA &= ~(1 << ADIF);
+
+	/* Setting ADSC starts a conversion, the first one after enabling the ADC takes 25 ADC clocks */
+	if (!(ADCSRA & (1 << ADEN))) {
+		ADCSRA       &= ~(1 << ADSC);
+		ADCConverting = false;
+	} else if ((ADCSRA & (1 << ADSC)) && !ADCConverting) {
+		ADCConverting = true;
+		ADCChannel    = (ADMUX & 0x1F);
+		ADCCyclesLeft = (25 * ADCClockDivider());
+	}
+}
+
+/* Interrupt vectors the firmware may or may not implement */
+#define HOST_VECTORS(X)                                              \
+	X(INT0_vect) X(INT1_vect) X(INT2_vect) X(INT3_vect)              \
+	X(PCINT0_vect)                                                   \
+	X(TIMER1_COMPA_vect) X(TIMER1_COMPB_vect) X(TIMER1_COMPC_vect)   \
+	X(TIMER1_OVF_vect)                                               \
+	X(ADC_vect)                                                      \
+	X(WDT_vect)
+
+#define HOST_DECLARE_VECTOR(Vector)  void Vector(void) __attribute__((weak));
+HOST_VECTORS(HOST_DECLARE_VECTOR)
+
+static void CallVector(void (*const Vector)(void))
+{
+	uint8_t SavedSREG = SREG;
+
+	if (Vector == NULL)
+		return;
+
+	/* The AVR clears the global interrupt flag on entry and RETI sets it again */
+	SREG &= ~(1 << SREG_I);
+	Host_Wakeups++;
+	Vector();
+	SREG = (SavedSREG | (1 << SREG_I));
+}
+
+/** Runs the handlers of all pending and enabled interrupts, in vector priority order. */
+void Host_DispatchInterrupts(void)
+{
+	static void (*const ExternalVectors[])(void) = {INT0_vect, INT1_vect, INT2_vect, INT3_vect};
+
+	Host_SyncFlags();
+
+	if (!(SREG & (1 << SREG_I)))
+		return;
+
+	for (uint8_t i = 0; i < 4; i++) {
+		uint8_t Sense = ((EICRA >> (i * 2)) & 0x03);
+
+		if (!(EIMSK & (1 << i)))
+			continue;
+
+		/* Level interrupts have no flag and fire for as long as the pin is held low */
+		if (((Sense == 0) && !(PIND & (1 << i))) || (PendingEIFR & (1 << i))) {
+			PendingEIFR &= ~(1 << i);
+			CallVector(ExternalVectors[i]);
+		}
+	}
+
+	if ((PendingPCIFR & (1 << PCIF0)) && (PCICR & (1 << PCIE0))) {
+		PendingPCIFR &= ~(1 << PCIF0);
+		CallVector(PCINT0_vect);
+	}
+
+	if (PendingWDIF && (WDTCSR & (1 << WDIE))) {
+		PendingWDIF = false;
+		CallVector(WDT_vect);
+	}
+
+	static void (*const Timer1Vectors[])(void) = {TIMER1_OVF_vect, TIMER1_COMPA_vect, TIMER1_COMPB_vect, TIMER1_COMPC_vect};
+	static const uint8_t Timer1Order[] = {OCF1A, OCF1B, OCF1C, TOV1};
+
+	for (uint8_t i = 0; i < sizeof(Timer1Order); i++) {
+		uint8_t Flag = Timer1Order[i];
+
+		if ((PendingTIFR1 & TIMSK1) & (1 << Flag)) {
+			PendingTIFR1 &= ~(1 << Flag);
+
+#if defined(RAW_STREAM)
+			/* Compare C samples the ports for the raw stream, the metrics check the samples sent */
+			if (Flag == OCF1C)
+				Host_MetricsSampled(PIND, PINB, PINF);
+#endif
+
+			CallVector(Timer1Vectors[Flag]);
+		}
+	}
+
+	if (PendingADIF && (ADCSRA & (1 << ADIE))) {
+		PendingADIF = false;
+		CallVector(ADC_vect);
+	}
+}
+
+/** Updates the input pins, raising the external and pin change interrupt flags for the edges
+ *  the firmware has enabled.
+ */
+void Host_SetPins(const uint8_t PinD,
+                  const uint8_t PinB,
+                  const uint8_t PinF)
+{
+	uint8_t ChangedD = (PIND ^ PinD);
+	uint8_t ChangedB = (PINB ^ PinB);
+
+	Host_SyncFlags();
+
+	PIND = PinD;
+	PINB = PinB;
+	PINF = PinF;
+
+	for (uint8_t i = 0; i < 4; i++) {
+		uint8_t Sense = ((EICRA >> (i * 2)) & 0x03);
+		bool    High  = ((PinD & (1 << i)) != 0);
+
+		if (!(ChangedD & (1 << i)))
+			continue;
+
+		if ((Sense == 1) || ((Sense == 2) && !High) || ((Sense == 3) && High))
+			PendingEIFR |= (1 << i);
+	}
+
+	if (ChangedB & PCMSK0)
+		PendingPCIFR |= (1 << PCIF0);
+
+	Host_DispatchInterrupts();
+}
+
+/** Sets the voltages on ADC0 (Port F0) and ADC1 (Port F1). */
+void Host_SetAnalog(const uint16_t Millivolts0,
+                    const uint16_t Millivolts1)
+{
+	AnalogMillivolts[0] = Millivolts0;
+	AnalogMillivolts[1] = Millivolts1;
+}
+
+static uint16_t Timer1ClockDivider(void)
+{
+	static const uint16_t Dividers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+
+	return Dividers[TCCR1B & ((1 << CS12) | (1 << CS11) | (1 << CS10))];
+}
+
+static void Timer1Tick(void)
+{
+	bool CTCMode = ((TCCR1B & (1 << WGM12)) && !(TCCR1B & (1 << WGM13)));
+
+	Host_SyncFlags();
+
+	if (CTCMode && (TCNT1 == OCR1A))
+		TCNT1 = 0;
+	else if (TCNT1++ == 0xFFFF)
+		PendingTIFR1 |= (1 << TOV1);
+
+	if (TCNT1 == OCR1A)
+		PendingTIFR1 |= (1 << OCF1A);
+	if (TCNT1 == OCR1B)
+		PendingTIFR1 |= (1 << OCF1B);
+	if (TCNT1 == OCR1C)
+		PendingTIFR1 |= (1 << OCF1C);
+}
+
+/** Returns the result of a conversion of the given channel. The input voltage is dithered by
+ *  uniform noise of \ref HOST_ADC_NOISE sixteenths of an LSB, as the real input's noise dithers it.
+ */
+static uint16_t ADCConvert(const uint8_t Channel)
+{
+	int32_t Sixteenths;
+
+	if (Channel >= HOST_ADC_CHANNELS)
+		return 0;
+
+	Sixteenths = (((int32_t)AnalogMillivolts[Channel] * 1024 * 16) / HOST_ADC_VREF_MV);
+
+	ADCNoise    = ((ADCNoise * 1103515245) + 12345);
+	Sixteenths += ((int32_t)((ADCNoise >> 16) % ((2 * HOST_ADC_NOISE) + 1)) - HOST_ADC_NOISE);
+
+	return MIN(MAX(((Sixteenths + 8) >> 4), 0), 1023);
+}
+
+/** Completes the conversion in progress. In free running mode the next conversion starts at once,
+ *  on the channel selected at this instant.
+ */
+static void ADCComplete(void)
+{
+	uint16_t Result = ADCConvert(ADCChannel);
+
+	if ((ADCSRA & (1 << ADATE)) && !(ADCSRB & ((1 << ADTS3) | (1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0)))) {
+		ADCChannel    = (ADMUX & 0x1F);
+		ADCCyclesLeft = (13 * ADCClockDivider());
+	} else {
+		ADCSRA       &= ~(1 << ADSC);
+		ADCConverting = false;
+	}
+
+	Host_SyncFlags();
+
+	ADC         = Result;
+	PendingADIF = true;
+}
+
+/** Returns whether the CPU is in power-down sleep, where the I/O clock is stopped. */
+static bool IsPoweredDown(void)
+{
+	uint8_t Mask = ((1 << SE) | (1 << SM0) | (1 << SM1) | (1 << SM2));
+
+	return ((SMCR & Mask) == ((1 << SE) | SLEEP_MODE_PWR_DOWN));
+}
+
+/** Advances the simulated time, ticking the timers, the ADC and the watchdog and delivering their
+ *  interrupts.
+ */
+void Host_AdvanceCycles(uint64_t Cycles)
+{
+	while (Cycles) {
+		bool     PoweredDown = IsPoweredDown();
+		bool     Timer1Runs  = (!PoweredDown && !(PRR0 & (1 << PRTIM1)));
+		bool     ADCRuns     = (ADCConverting && !PoweredDown && !(PRR0 & (1 << PRADC)));
+		bool     Watchdog    = ((WDTCSR & (1 << WDIE)) != 0);
+		uint16_t Divider     = (Timer1Runs ? Timer1ClockDivider() : 0);
+		uint64_t ToTick      = (Divider ? (Divider - Timer1Prescaler) : UINT64_MAX);
+		uint64_t ToADC       = (ADCRuns ? ADCCyclesLeft : UINT64_MAX);
+		uint64_t ToWatchdog  = (Watchdog ? (HOST_WATCHDOG_CYCLES - WatchdogPrescaler) : UINT64_MAX);
+		uint64_t Step        = MIN(Cycles, MIN(ToTick, MIN(ToADC, ToWatchdog)));
+
+		Cycles      -= Step;
+		Host_Cycles += Step;
+
+		if (PoweredDown)
+			Host_PowerDownCycles += Step;
+
+		if (Divider)
+			Timer1Prescaler += Step;
+		if (ADCRuns)
+			ADCCyclesLeft -= Step;
+
+		/* The watchdog counts from the moment its interrupt is enabled */
+		if (Watchdog)
+			WatchdogPrescaler += Step;
+		else
+			WatchdogPrescaler = 0;
+
+		if ((Step != ToTick) && (Step != ToADC) && (Step != ToWatchdog))
+			continue;
+
+		if (Step == ToTick) {
+			Timer1Prescaler = 0;
+			Timer1Tick();
+		}
+
+		if (Step == ToADC)
+			ADCComplete();
+
+		if (Step == ToWatchdog) {
+			WatchdogPrescaler = 0;
+			PendingWDIF       = true;
+		}
+
+		Host_DispatchInterrupts();
+	}
+}
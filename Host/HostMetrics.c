@@ -0,0 +1,835 @@
+/** \file
+ *
+ *  Ground truth and metrics of a trace run. The harness hands every pin change of the trace and
+ *  every report the host receives to this file, which derives from the pins what the reports should
+ *  have carried and compares:
+ *
+ *  - the joystick and buttons states an ideal debouncer produces from the trace against the
+ *    joystick reports received, in order. Like the firmware's, the ideal debouncer takes each input
+ *    on its own: a level held for a debounce window plus the sampling interval must be reported,
+ *    one held for less than three samples must not, anything in between may be;
+ *  - the dial steps of the trace against the dial motion in the reports;
+ *  - the reports sent and suppressed by the firmware, read from its statistics feature report;
+ *  - in USB suspend, the inputs changed without a remote wakeup, the time from the first input
+ *    change to the remote wakeup and from the restart of the frames to the first report;
+ *  - in the RAW_STREAM build, each sample decoded from the raw stream against the ports at the run
+ *    of the sampling interrupt with its index, and the samples lost to gaps in the index.
+ *
+ *  The trace and the reports are kept until the end of the run, when the metrics are printed after
+ *  the harness summary.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Host.h"
+#include "Descriptors.h"
+
+/** Number of expected states a received joystick state is searched in, before it is taken as
+ *  an unexpected state rather than a sign that the states in between were lost.
+ */
+#define HOST_MATCH_WINDOW        16
+
+/** Size of the settings feature report with its ID. Settings_t is packed on the device but not in
+ *  the harness, which reads the report bytes instead.
+ */
+#define HOST_SETTINGS_REPORT_SIZE (1 + 4 + SETTINGS_BUTTONS + SETTINGS_KEYS + 3)
+
+/** Size of the boot timing feature report with its ID, Boot_Report_t is packed likewise. */
+#define HOST_BOOT_REPORT_SIZE     (3 + (4 * BOOT_STAGES))
+
+/** Size of the task load feature report with its ID. */
+#define HOST_TASKS_REPORT_SIZE    (1 + (8 * SCHEDULER_TASKS))
+
+/** Digital inputs of all players, as in the InputState_t of the firmware. */
+#if (INPUT_PLAYERS > 1)
+#define HOST_DIGITAL_MASK        (INPUT_DIGITAL_MASK | (INPUT_DIGITAL_MASK << 8))
+#else
+#define HOST_DIGITAL_MASK        INPUT_DIGITAL_MASK
+#endif
+
+/** Number of bits of a digital input state. */
+#define HOST_DIGITAL_BITS        (8 * sizeof(InputState_t))
+
+/** Joystick report contents a digital input state maps to, or the modifiers and key bitmap of the
+ *  keyboard report of a KEYBOARD_REPORT build.
+ */
+#if defined(KEYBOARD_REPORT)
+typedef struct {
+	uint8_t Keys[1 + (KEYBOARD_KEYS / 8)];
+} Host_JoystickKey_t;
+#else
+typedef struct {
+	int8_t  X[INPUT_PLAYERS];
+	int8_t  Y[INPUT_PLAYERS];
+	uint8_t Buttons[INPUT_PLAYERS];
+} Host_JoystickKey_t;
+#endif
+
+/** Level change of a single input that the ideal debouncer accepts. */
+typedef struct {
+	uint64_t     Cycles;   /**< Time of the first edge away from the last steady level */
+	InputState_t Mask;     /**< Input bit */
+	bool         Level;
+	bool     Required; /**< Held long enough that the debouncer always accepts it */
+} Host_InputEvent_t;
+
+/** Joystick state that may reach the host, or a joystick state the host received. */
+typedef struct {
+	uint64_t           Cycles;     /**< Time of the first edge to this state, or of the receipt */
+	Host_JoystickKey_t Key;
+	bool               Required;   /**< The host must receive this state */
+	uint64_t           EdgeCycles; /**< Edge time carried by the received report (EDGE_TIMESTAMP), 0 for none */
+} Host_JoystickState_t;
+
+/** Growable array of Count elements of the given type. */
+#define HOST_ARRAY(Type)  struct { Type* Items; uint32_t Count; uint32_t Allocated; }
+
+#define HOST_ARRAY_APPEND(Array, Item)                                                  \
+	do {                                                                                \
+		if ((Array).Count == (Array).Allocated) {                                       \
+			(Array).Allocated = ((Array).Allocated ? ((Array).Allocated * 2) : 256);    \
+			(Array).Items     = realloc((Array).Items, ((Array).Allocated * sizeof(*(Array).Items))); \
+		}                                                                               \
+		(Array).Items[(Array).Count++] = (Item);                                        \
+	} while (0)
+
+typedef HOST_ARRAY(Host_InputEvent_t)    Host_InputEvents_t;
+typedef HOST_ARRAY(Host_JoystickState_t) Host_JoystickStates_t;
+
+#if defined(RAW_STREAM)
+/** Ports read by the raw stream's sampling interrupt. */
+typedef struct {
+	uint8_t Pins[3];
+} Host_PortSample_t;
+
+typedef HOST_ARRAY(Host_PortSample_t) Host_PortSamples_t;
+#endif
+
+/** Settings read from the device after enumeration, see Settings_t. */
+static uint16_t DebounceUS;
+static int8_t   DialGain;
+static uint8_t  CoalesceFrames;
+static uint8_t  ButtonMap[SETTINGS_BUTTONS];
+static uint8_t  KeyMap[SETTINGS_KEYS];
+static uint8_t  DialHysteresis;
+static uint16_t DialDwellUS;
+
+/** Digital inputs of the trace: the initial state, each input's current level and since when, the
+ *  first edge after each input's last steady level, and the levels the ideal debouncer accepted last.
+ */
+static bool         Started;
+static InputState_t InitialState;
+static InputState_t PinState;
+static uint64_t     PinSince[HOST_DIGITAL_BITS];
+static uint64_t     EdgeSince[HOST_DIGITAL_BITS];
+static InputState_t AcceptedState;
+
+static Host_InputEvents_t    Events;
+static Host_JoystickStates_t Received;
+
+/** Dial position of the trace, then the net and total steps of the trace and of the reports. The
+ *  total catches steps lost both ways, which the net motion of a dial turned back and forth hides.
+ */
+static uint8_t  DialPosition;
+static int32_t  DialTruth;
+static uint32_t DialTruthTotal;
+static int32_t  DialReceived;
+static uint32_t DialReceivedTotal;
+
+static uint32_t Reports[HOST_MAX_ENDPOINTS + 1];
+
+#if defined(RAW_STREAM)
+/** Ports at each run of the sampling interrupt, the samples decoded from the raw stream, those
+ *  that differ from the ports at their interrupt, the samples lost to gaps in the sample index,
+ *  the reports that could not be decoded, and the number of the next sample expected.
+ */
+static Host_PortSamples_t Sampled;
+static uint64_t           StreamSamples;
+static uint64_t           StreamWrong;
+static uint64_t           StreamLost;
+static uint32_t           StreamMalformed;
+static uint64_t           StreamNext;
+#endif
+
+/** Suspends of the run, the remote wakeups and the suspends whose input changes did not wake the
+ *  host, and the bus time spent suspended, from the device's suspend to the restart of the frames.
+ */
+static uint32_t Suspends;
+static uint32_t RemoteWakeups;
+static uint32_t MissedWakeups;
+static uint64_t SuspendedCycles;
+
+/** Suspend in progress: since when, and the first input change in it and whether it woke the host. */
+static bool     Suspended;
+static uint64_t SuspendStart;
+static bool     SuspendInput;
+static uint64_t SuspendInputCycles;
+static bool     SuspendWoken;
+
+/** Restart of the frames after the last resume, until the first report, and the longest times
+ *  from the input to the remote wakeup and from the restart to the first report.
+ */
+static bool     ResumePending;
+static uint64_t ResumeCycles;
+static uint64_t WakeupLatencyMax;
+static uint64_t ResumeLatencyMax;
+
+/** Maps the pins to the digital input state. The pins of player 2 are spelled out here rather than
+ *  read through the board drivers, so that the metrics also check the drivers' pin map.
+ */
+static InputState_t DigitalState(const uint8_t PinD,
+                                 const uint8_t PinB,
+                                 const uint8_t PinF)
+{
+	InputState_t State = ((~PinD & JOY_MASK) | ((PinF & BUTTONS_MASK) ^ BUTTONS_MASK));
+
+#if (INPUT_PLAYERS > 1)
+	uint8_t Player2 = 0;
+
+	Player2 |= (!(PinD & (1 << 4)) ? JOY_UP          : 0);
+	Player2 |= (!(PinD & (1 << 5)) ? JOY_DOWN        : 0);
+	Player2 |= (!(PinD & (1 << 7)) ? JOY_LEFT        : 0);
+	Player2 |= (!(PinB & (1 << 7)) ? JOY_RIGHT       : 0);
+	Player2 |= (!(PinF & (1 << 0)) ? BUTTONS_BUTTON1 : 0);
+	Player2 |= (!(PinF & (1 << 1)) ? BUTTONS_BUTTON2 : 0);
+	Player2 |= (!(PinF & (1 << 4)) ? BUTTONS_BUTTON3 : 0);
+
+	State |= ((InputState_t)Player2 << 8);
+#endif
+
+	return State;
+}
+
+static uint8_t DialDecode(const uint8_t PinB)
+{
+	uint8_t Position = (PinB & DIAL_MASK);
+
+#if defined(DIAL_GRAY_CODED)
+	Position ^= (Position >> 1);
+	Position ^= (Position >> 2);
+	Position ^= (Position >> 4);
+#endif
+
+	return Position;
+}
+
+#if defined(KEYBOARD_REPORT)
+/** Maps a digital input state to the keyboard report contents, like CreateKeyboardReport(). */
+static Host_JoystickKey_t JoystickKey(const InputState_t State)
+{
+	static const uint8_t Inputs[SETTINGS_PLAYER_KEYS] = {
+		JOY_UP, JOY_DOWN, JOY_LEFT, JOY_RIGHT, BUTTONS_BUTTON1, BUTTONS_BUTTON2, BUTTONS_BUTTON3,
+	};
+
+	Host_JoystickKey_t Key = {{0}};
+
+	for (uint8_t Player = 0; Player < INPUT_PLAYERS; Player++) {
+		for (uint8_t i = 0; i < SETTINGS_PLAYER_KEYS; i++) {
+			uint8_t Usage = KeyMap[(Player * SETTINGS_PLAYER_KEYS) + i];
+
+			if (!(INPUT_PLAYER_STATE(State, Player) & Inputs[i]) || !Usage)
+				continue;
+
+			if (Usage >= SETTINGS_KEYCODE_MODIFIER_MIN)
+				Key.Keys[0] |= (1 << (Usage - SETTINGS_KEYCODE_MODIFIER_MIN));
+			else
+				Key.Keys[1 + (Usage / 8)] |= (1 << (Usage % 8));
+		}
+	}
+
+	return Key;
+}
+#else
+/** Maps a digital input state to the joystick report contents, like CreateJoystickReport(). The
+ *  axes of an ANALOG_AXES build do not come from the digital inputs and are not compared.
+ */
+static Host_JoystickKey_t JoystickKey(const InputState_t State)
+{
+	Host_JoystickKey_t Key = {{0}};
+
+	for (uint8_t Player = 0; Player < INPUT_PLAYERS; Player++) {
+		uint8_t PlayerState = INPUT_PLAYER_STATE(State, Player);
+
+#if !defined(ANALOG_AXES)
+		Key.Y[Player] = ((PlayerState & JOY_UP) ? -1 : ((PlayerState & JOY_DOWN) ? 1 : 0));
+		Key.X[Player] = ((PlayerState & JOY_LEFT) ? -1 : ((PlayerState & JOY_RIGHT) ? 1 : 0));
+#endif
+
+		for (uint8_t i = 0; i < 3; i++) {
+			if (PlayerState & ButtonMap[i])
+				Key.Buttons[Player] |= (1 << i);
+		}
+	}
+
+	return Key;
+}
+#endif
+
+static bool KeysEqual(const Host_JoystickKey_t* const A,
+                      const Host_JoystickKey_t* const B)
+{
+	return !memcmp(A, B, sizeof(Host_JoystickKey_t));
+}
+
+static int16_t GetFeatureReport(const uint8_t ReportID,
+                                uint8_t* const Data,
+                                const uint16_t Length)
+{
+	USB_Request_Header_t Request = {
+		.bmRequestType = (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE),
+		.bRequest      = HID_REQ_GetReport,
+		.wValue        = (((HID_REPORT_ITEM_Feature + 1) << 8) | ReportID),
+#if defined(COMBINED_REPORT)
+		.wIndex        = 0,
+#else
+		.wIndex        = 1,
+#endif
+		.wLength       = Length,
+	};
+
+	return Host_USBControlRequest(&Request, Data);
+}
+
+/** Reads the settings the ground truth depends on, must be called once the device is configured. */
+void Host_MetricsStart(void)
+{
+	uint8_t Report[HOST_SETTINGS_REPORT_SIZE];
+
+	if (GetFeatureReport(HID_REPORTID_Settings, Report, sizeof(Report)) != sizeof(Report)) {
+		fprintf(stderr, "metrics: cannot read the settings feature report\n");
+		exit(EXIT_FAILURE);
+	}
+
+	DebounceUS     = (Report[1] | (Report[2] << 8));
+	DialGain       = (int8_t)Report[3];
+	CoalesceFrames = Report[4];
+
+	for (uint8_t i = 0; i < SETTINGS_BUTTONS; i++)
+		ButtonMap[i] = Report[5 + i];
+
+	for (uint8_t i = 0; i < SETTINGS_KEYS; i++)
+		KeyMap[i] = Report[5 + SETTINGS_BUTTONS + i];
+
+	DialHysteresis = Report[5 + SETTINGS_BUTTONS + SETTINGS_KEYS];
+	DialDwellUS    = (Report[6 + SETTINGS_BUTTONS + SETTINGS_KEYS] | (Report[7 + SETTINGS_BUTTONS + SETTINGS_KEYS] << 8));
+}
+
+/** Ends the run of the given input's current level, which the ideal debouncer accepts if it was
+ *  held for at least three debouncer samples. The debouncer may miss the last bounces before such
+ *  a level, so its change is timed from the first edge after the previous steady level.
+ */
+static void EndRun(const uint8_t Bit,
+                   const uint64_t Cycles)
+{
+	InputState_t Mask = ((InputState_t)1 << Bit);
+	bool     Level  = ((PinState & Mask) != 0);
+	uint64_t Held   = (Cycles - PinSince[Bit]);
+	bool     Steady = (Held >= HOST_US_TO_CYCLES((DebounceUS * 3) / 4));
+	uint64_t Edge   = EdgeSince[Bit];
+
+	if (Steady)
+		EdgeSince[Bit] = Cycles;
+
+	if (!Steady || (Level == ((AcceptedState & Mask) != 0)))
+		return;
+
+	AcceptedState ^= Mask;
+
+	HOST_ARRAY_APPEND(Events, ((Host_InputEvent_t){
+		.Cycles   = Edge,
+		.Mask     = Mask,
+		.Level    = Level,
+		.Required = (Held >= HOST_US_TO_CYCLES(DebounceUS + (DebounceUS / 4))),
+	}));
+}
+
+/** Records the pins of the trace from the given time on. */
+void Host_MetricsPins(const uint64_t Cycles,
+                      const uint8_t PinD,
+                      const uint8_t PinB,
+                      const uint8_t PinF)
+{
+	InputState_t State    = DigitalState(PinD, PinB, PinF);
+	uint8_t      Position = DialDecode(PinB);
+	int8_t       Steps;
+
+	if (!Started) {
+		Started       = true;
+		InitialState  = State;
+		PinState      = State;
+		AcceptedState = State;
+		DialPosition  = Position;
+		return;
+	}
+
+	if (Suspended && !SuspendInput && ((State != PinState) || (Position != DialPosition))) {
+		SuspendInput       = true;
+		SuspendInputCycles = Cycles;
+	}
+
+	for (uint8_t Bit = 0; Bit < HOST_DIGITAL_BITS; Bit++) {
+		InputState_t Mask = ((InputState_t)1 << Bit);
+
+		if (!((State ^ PinState) & HOST_DIGITAL_MASK & Mask))
+			continue;
+
+		EndRun(Bit, Cycles);
+		PinState      ^= Mask;
+		PinSince[Bit]  = Cycles;
+	}
+
+	/* Shortest signed distance over the dial, as the trace moves less than half a turn per line */
+	Steps = ((int8_t)((uint8_t)(Position - DialPosition) << 1) >> 1);
+
+	DialTruth      += Steps;
+	DialTruthTotal += abs(Steps);
+	DialPosition    = Position;
+}
+
+#if defined(RAW_STREAM)
+/** Records the ports read by the raw stream's sampling interrupt, which numbers its samples the
+ *  same way from power-up on.
+ */
+void Host_MetricsSampled(const uint8_t PinD,
+                         const uint8_t PinB,
+                         const uint8_t PinF)
+{
+	HOST_ARRAY_APPEND(Sampled, ((Host_PortSample_t){.Pins = {PinD, PinB, PinF}}));
+}
+
+/** Checks the next sample decoded from the raw stream against the ports its interrupt read. */
+static void StreamSample(const uint8_t* const Pins)
+{
+	if ((StreamNext >= Sampled.Count) || memcmp(Sampled.Items[StreamNext].Pins, Pins, sizeof(Sampled.Items[0].Pins)))
+		StreamWrong++;
+
+	StreamSamples++;
+	StreamNext++;
+}
+
+/** Decodes a raw stream report, see Stream_Report_t. A gap in the 16-bit sample index counts as
+ *  lost samples, an overlap has the samples checked again; the stream is read often enough that
+ *  the index does not wrap in between.
+ */
+static void StreamReport(const uint8_t* const Report,
+                         const uint16_t Length)
+{
+	uint16_t Index = (Report[0] | (Report[1] << 8));
+	uint16_t End   = (STREAM_HEADER_SIZE + Report[2]);
+	uint8_t  Pins[3];
+	uint16_t Offset;
+
+	if ((Length < STREAM_HEADER_SIZE) || (Report[2] > (Length - STREAM_HEADER_SIZE))) {
+		StreamMalformed++;
+		return;
+	}
+
+	if (StreamSamples) {
+		int16_t Gap = (int16_t)(Index - (uint16_t)StreamNext);
+
+		if (Gap > 0)
+			StreamLost += Gap;
+
+		StreamNext += Gap;
+	} else {
+		StreamNext = Index;
+	}
+
+	memcpy(Pins, &Report[3], sizeof(Pins));
+	StreamSample(Pins);
+
+	for (Offset = STREAM_HEADER_SIZE; Offset < End; ) {
+		uint8_t Token = Report[Offset++];
+		uint8_t Masks = (!!(Token & STREAM_TOKEN_PIND) + !!(Token & STREAM_TOKEN_PINB) + !!(Token & STREAM_TOKEN_PINF));
+
+		if ((Offset + Masks) > End) {
+			StreamMalformed++;
+			return;
+		}
+
+		for (uint8_t Run = (Token & STREAM_TOKEN_RUN_MASK); Run; Run--)
+			StreamSample(Pins);
+
+		if (Token & STREAM_TOKEN_PIND)
+			Pins[0] ^= Report[Offset++];
+		if (Token & STREAM_TOKEN_PINB)
+			Pins[1] ^= Report[Offset++];
+		if (Token & STREAM_TOKEN_PINF)
+			Pins[2] ^= Report[Offset++];
+
+		StreamSample(Pins);
+	}
+}
+#endif
+
+/** Records a report received by the host on the given endpoint. */
+void Host_MetricsReport(const uint64_t Cycles,
+                        const uint8_t EndpointNumber,
+                        const uint8_t* const Report,
+                        const uint16_t Length)
+{
+	Host_JoystickKey_t Key;
+	uint64_t           EdgeCycles = 0;
+	uint16_t           DataLength = Length;
+
+	Reports[EndpointNumber]++;
+
+	if (ResumePending && (Cycles >= ResumeCycles)) {
+		ResumePending    = false;
+		ResumeLatencyMax = MAX(ResumeLatencyMax, (Cycles - ResumeCycles));
+	}
+
+#if defined(RAW_STREAM)
+	if (EndpointNumber == STREAM_EPNUM) {
+		StreamReport(Report, Length);
+		return;
+	}
+#endif
+
+#if defined(COMBINED_REPORT)
+	if (EndpointNumber != CONTROLLER_EPNUM)
+		return;
+#else
+	if (EndpointNumber == MOUSE_EPNUM) {
+		if (Length >= 3) {
+			DialReceived      += (int8_t)Report[2];
+			DialReceivedTotal += abs((int8_t)Report[2]);
+		}
+
+		return;
+	}
+
+	if (EndpointNumber != JOYSTICK_EPNUM)
+		return;
+#endif
+
+#if defined(EDGE_TIMESTAMP)
+	/* The edge time ends the report, counted back from the start of the frame it was polled in */
+	if (Length >= 3) {
+		uint16_t EdgeUS = (Report[Length - 2] | (Report[Length - 1] << 8));
+
+		if (EdgeUS)
+			EdgeCycles = (Cycles - HOST_US_TO_CYCLES(HOST_IN_OFFSET_US) - HOST_US_TO_CYCLES(EdgeUS));
+
+		DataLength -= 2;
+	}
+#endif
+
+#if defined(KEYBOARD_REPORT)
+	if (DataLength < (1 + sizeof(Key.Keys)))
+		return;
+
+	memcpy(Key.Keys, &Report[1], sizeof(Key.Keys));
+#elif defined(ANALOG_AXES)
+	if (DataLength < 6)
+		return;
+
+	Key = (Host_JoystickKey_t){.Buttons = {Report[5]}};
+#else
+	if (DataLength < (1 + (3 * INPUT_PLAYERS)))
+		return;
+
+	for (uint8_t Player = 0; Player < INPUT_PLAYERS; Player++) {
+		Key.X[Player]       = (int8_t)Report[1 + (3 * Player)];
+		Key.Y[Player]       = (int8_t)Report[2 + (3 * Player)];
+		Key.Buttons[Player] = Report[3 + (3 * Player)];
+	}
+#endif
+
+#if defined(COMBINED_REPORT)
+	DialReceived      += (int8_t)Report[DataLength - 1];
+	DialReceivedTotal += abs((int8_t)Report[DataLength - 1]);
+#endif
+
+	/* Reports without a joystick change carry the dial or the analog axes, or are idle repeats */
+	if (Received.Count && KeysEqual(&Received.Items[Received.Count - 1].Key, &Key))
+		return;
+
+	HOST_ARRAY_APPEND(Received, ((Host_JoystickState_t){.Cycles = Cycles, .Key = Key, .EdgeCycles = EdgeCycles}));
+}
+
+/** Records a bus event: the device suspending, signalling remote wakeup, or the host resuming the
+ *  bus, with the time the frames restart.
+ */
+void Host_MetricsBus(const uint64_t Cycles,
+                     const uint8_t Event)
+{
+	switch (Event) {
+	case HOST_BUS_Suspend:
+		Suspends++;
+		Suspended    = true;
+		SuspendStart = Cycles;
+		SuspendInput = false;
+		SuspendWoken = false;
+		break;
+
+	case HOST_BUS_RemoteWakeup:
+		RemoteWakeups++;
+		SuspendWoken = true;
+
+		if (SuspendInput)
+			WakeupLatencyMax = MAX(WakeupLatencyMax, (Cycles - SuspendInputCycles));
+		break;
+
+	case HOST_BUS_Resume:
+		if (!Suspended)
+			break;
+
+		Suspended        = false;
+		SuspendedCycles += (Cycles - SuspendStart);
+		MissedWakeups   += (SuspendInput && !SuspendWoken);
+		ResumePending    = true;
+		ResumeCycles     = Cycles;
+		break;
+	}
+}
+
+static int CompareEvents(const void* const A,
+                         const void* const B)
+{
+	const Host_InputEvent_t* EventA = A;
+	const Host_InputEvent_t* EventB = B;
+
+	if (EventA->Cycles != EventB->Cycles)
+		return ((EventA->Cycles < EventB->Cycles) ? -1 : 1);
+
+	return ((EventA->Mask < EventB->Mask) ? -1 : 1);
+}
+
+/** Applies the accepted input changes in time order to build the joystick states expected. Input
+ *  changes the report does not show are merged into the state before them, changes at the same
+ *  time into one state. A state that lasts less than a snapshot interval may be sent together
+ *  with the next, so it is not required.
+ */
+static void BuildExpected(Host_JoystickStates_t* const Expected)
+{
+	InputState_t State = InitialState;
+
+	qsort(Events.Items, Events.Count, sizeof(*Events.Items), CompareEvents);
+
+	HOST_ARRAY_APPEND(*Expected, ((Host_JoystickState_t){.Cycles = 0, .Key = JoystickKey(State), .Required = true}));
+
+	for (uint32_t i = 0; i < Events.Count; i++) {
+		Host_InputEvent_t*    Event = &Events.Items[i];
+		Host_JoystickState_t* Last  = &Expected->Items[Expected->Count - 1];
+		Host_JoystickKey_t    Key;
+
+		State = (Event->Level ? (State | Event->Mask) : (State & ~Event->Mask));
+		Key   = JoystickKey(State);
+
+		if (KeysEqual(&Last->Key, &Key)) {
+			Last->Required |= Event->Required;
+			continue;
+		}
+
+		if ((Expected->Count > 1) && (Last->Cycles == Event->Cycles)) {
+			Last->Key       = Key;
+			Last->Required |= Event->Required;
+			continue;
+		}
+
+		if ((Expected->Count > 1) && ((Event->Cycles - Last->Cycles) < HOST_US_TO_CYCLES(CoalesceFrames * 1000UL)))
+			Last->Required = false;
+
+		HOST_ARRAY_APPEND(*Expected, ((Host_JoystickState_t){.Cycles = Event->Cycles, .Key = Key, .Required = Event->Required}));
+	}
+}
+
+/** Counts the required states from First up to Last that the host did not receive. Optional
+ *  states the host did not receive either may hide no change at all, when the states around them
+ *  are the same.
+ */
+static uint32_t CountLost(const Host_JoystickStates_t* const Expected,
+                          const uint32_t First,
+                          const uint32_t Last)
+{
+	Host_JoystickKey_t Previous;
+	uint32_t           Count = 0;
+
+	if (First >= Last)
+		return 0;
+
+	Previous = Expected->Items[First ? (First - 1) : 0].Key;
+
+	for (uint32_t i = First; i < Last; i++) {
+		if (!Expected->Items[i].Required || KeysEqual(&Expected->Items[i].Key, &Previous))
+			continue;
+
+		Previous = Expected->Items[i].Key;
+		Count++;
+	}
+
+	return Count;
+}
+
+/** Prints the metrics of the run, which ended at the given time. */
+void Host_MetricsFinish(const uint64_t Cycles)
+{
+	Host_JoystickStates_t Expected = {0};
+
+	uint8_t  Stats[64];
+	uint8_t  Boot[HOST_BOOT_REPORT_SIZE];
+	uint8_t  Tasks[HOST_TASKS_REPORT_SIZE];
+	double   Seconds    = ((double)HOST_CYCLES_TO_US(Cycles) / 1000000);
+	uint32_t Required   = 0;
+	uint32_t Matched    = 0;
+	uint32_t Lost       = 0;
+	uint32_t Unexpected = 0;
+	uint64_t LatencySum = 0;
+	uint64_t LatencyMax = 0;
+	uint32_t Latencies  = 0;
+	uint64_t EdgeErrorSum = 0;
+	uint64_t EdgeErrorMax = 0;
+	uint32_t EdgeTimes    = 0;
+	uint16_t Sent;
+	uint16_t Suppressed;
+	uint16_t DialEmitted;
+	uint16_t DialFiltered;
+
+	for (uint8_t Bit = 0; Bit < HOST_DIGITAL_BITS; Bit++) {
+		if (HOST_DIGITAL_MASK & ((InputState_t)1 << Bit))
+			EndRun(Bit, Cycles);
+	}
+
+	BuildExpected(&Expected);
+
+	for (uint32_t i = 0; i < Expected.Count; i++)
+		Required += Expected.Items[i].Required;
+
+	for (uint32_t r = 0; r < Received.Count; r++) {
+		Host_JoystickState_t* State = &Received.Items[r];
+		uint32_t              Last  = MIN(Expected.Count, (Matched + HOST_MATCH_WINDOW));
+		uint32_t              i;
+
+		for (i = Matched; i < Last; i++) {
+			if (KeysEqual(&Expected.Items[i].Key, &State->Key))
+				break;
+		}
+
+		if (i == Last) {
+			Unexpected++;
+			continue;
+		}
+
+		/* The first state is the one the device powered up in, not a change */
+		if (i) {
+			uint64_t Latency = (State->Cycles - Expected.Items[i].Cycles);
+
+			LatencySum += Latency;
+			LatencyMax  = MAX(LatencyMax, Latency);
+			Latencies++;
+
+			if (State->EdgeCycles) {
+				uint64_t Error = ((State->EdgeCycles > Expected.Items[i].Cycles) ?
+				                  (State->EdgeCycles - Expected.Items[i].Cycles) :
+				                  (Expected.Items[i].Cycles - State->EdgeCycles));
+
+				EdgeErrorSum += Error;
+				EdgeErrorMax  = MAX(EdgeErrorMax, Error);
+				EdgeTimes++;
+			}
+		}
+
+		Lost   += CountLost(&Expected, Matched, i);
+		Matched = (i + 1);
+	}
+
+	Lost += CountLost(&Expected, Matched, Expected.Count);
+
+	if (GetFeatureReport(HID_REPORTID_Stats, Stats, sizeof(Stats)) < 50) {
+		fprintf(stderr, "metrics: cannot read the statistics feature report\n");
+		exit(EXIT_FAILURE);
+	}
+
+	Sent       = (Stats[1] | (Stats[2] << 8));
+	Suppressed = (Stats[3] | (Stats[4] << 8));
+
+	/* After the latency histogram and the ADC load */
+	DialEmitted  = (Stats[46] | (Stats[47] << 8));
+	DialFiltered = (Stats[48] | (Stats[49] << 8));
+
+	fprintf(stderr, "metrics:\n");
+	fprintf(stderr, "  duration            %.3f s\n", Seconds);
+
+	for (uint8_t EndpointNumber = 1; EndpointNumber <= HOST_MAX_ENDPOINTS; EndpointNumber++) {
+		if (Host_USBIsINEndpoint(EndpointNumber))
+			fprintf(stderr, "  EP%d reports/s       %.1f\n", EndpointNumber, (Reports[EndpointNumber] / Seconds));
+	}
+
+	fprintf(stderr, "  reports built       %u sent, %u suppressed (%.1f%% sent)\n", Sent, Suppressed,
+	        ((Sent + Suppressed) ? ((100.0 * Sent) / (Sent + Suppressed)) : 0.0));
+	fprintf(stderr, "  joystick states     %" PRIu32 " required, %" PRIu32 " received, %" PRIu32 " lost, %" PRIu32 " unexpected\n",
+	        Required, Received.Count, Lost, Unexpected);
+
+	if (Latencies) {
+		fprintf(stderr, "  state latency       %.0f us mean, %" PRIu64 " us max\n",
+		        ((double)HOST_CYCLES_TO_US(LatencySum) / Latencies), HOST_CYCLES_TO_US(LatencyMax));
+	}
+
+#if defined(EDGE_TIMESTAMP)
+	/* The edge times reported against the first edges of the trace */
+	fprintf(stderr, "  edge timestamps     %" PRIu32 " of %" PRIu32 " states, %.1f us mean error, %.1f us max\n",
+	        EdgeTimes, Latencies, (EdgeTimes ? ((double)EdgeErrorSum / EdgeTimes / (F_CPU / 1000000UL)) : 0.0),
+	        ((double)EdgeErrorMax / (F_CPU / 1000000UL)));
+#endif
+
+	fprintf(stderr, "  dial steps          %" PRId32 " net, %" PRIu32 " total expected; %" PRId32 " net, %" PRIu32 " total received (gain %d)\n",
+	        DialTruth, DialTruthTotal, DialReceived, DialReceivedTotal, DialGain);
+	fprintf(stderr, "  dial reports        %u emitted, %u filtered (hysteresis %u, dwell %u us)\n",
+	        DialEmitted, DialFiltered, DialHysteresis, DialDwellUS);
+	fprintf(stderr, "  queue overflows     %u\n", Stats[7]);
+
+	if (Suspended) {
+		SuspendedCycles += (Cycles - SuspendStart);
+		MissedWakeups   += (SuspendInput && !SuspendWoken);
+	}
+
+	if (Suspends) {
+		fprintf(stderr, "  suspends            %" PRIu32 ", %" PRIu32 " remote wakeups, %" PRIu32 " with inputs not woken, %.1f%% powered down\n",
+		        Suspends, RemoteWakeups, MissedWakeups,
+		        (SuspendedCycles ? ((100.0 * Host_PowerDownCycles) / SuspendedCycles) : 0.0));
+		fprintf(stderr, "  wakeup latency      %" PRIu64 " us input to remote wakeup, %" PRIu64 " us first frame to report (max)\n",
+		        HOST_CYCLES_TO_US(WakeupLatencyMax), HOST_CYCLES_TO_US(ResumeLatencyMax));
+	}
+
+#if defined(RAW_STREAM)
+	fprintf(stderr, "  raw stream          %" PRIu64 " samples at %u Hz, %" PRIu64 " wrong, %" PRIu64 " lost, %" PRIu32 " malformed reports\n",
+	        StreamSamples, STREAM_SAMPLE_HZ, StreamWrong, StreamLost, StreamMalformed);
+
+	free(Sampled.Items);
+#endif
+
+	if (GetFeatureReport(HID_REPORTID_Boot, Boot, sizeof(Boot)) == sizeof(Boot)) {
+		static const char* const Names[BOOT_STAGES] = {
+			"clock", "usb init", "input init", "connect", "bus reset", "configured", "first report"
+		};
+
+		fprintf(stderr, "  boot stages (us)   ");
+		for (uint8_t i = 0; i < BOOT_STAGES; i++) {
+			uint8_t* Time = &Boot[3 + (4 * i)];
+
+			if (Boot[2] & (1 << i))
+				fprintf(stderr, " %s %" PRIu32 "%s", Names[i],
+				        (uint32_t)(Time[0] | (Time[1] << 8) | (Time[2] << 16) | ((uint32_t)Time[3] << 24)),
+				        ((i < (BOOT_STAGES - 1)) ? "," : ""));
+		}
+		fprintf(stderr, "\n");
+	}
+
+	if (GetFeatureReport(HID_REPORTID_Tasks, Tasks, sizeof(Tasks)) == sizeof(Tasks)) {
+		static const char* const Names[SCHEDULER_TASKS] = {"reports", "usb", "settings", "housekeeping"};
+
+		for (uint8_t i = 0; i < SCHEDULER_TASKS; i++) {
+			uint8_t* Load = &Tasks[1 + (8 * i)];
+
+			fprintf(stderr, "  task %-14s %u runs, %.1f%% load, %u us max, %u deadline misses\n", Names[i],
+			        (Load[0] | (Load[1] << 8)), ((Load[2] | (Load[3] << 8)) / 10.0),
+			        (Load[4] | (Load[5] << 8)), (Load[6] | (Load[7] << 8)));
+		}
+	}
+
+	free(Expected.Items);
+}
@@ -0,0 +1,454 @@
+/** \file
+ *
+ *  Host harness for the firmware. The firmware's own main() runs unmodified; every main loop
+ *  iteration ends in USB_USBTask(), which yields here to advance the simulated time. The harness
+ *  enumerates the device, checks its descriptors, replays a pin trace read from stdin and polls
+ *  the IN endpoints once per frame like the host controller, printing every report received.
+ *
+ *  Each trace line holds a time in microseconds and the PIND, PINB and PINF values (hexadecimal)
+ *  from that time on, optionally followed by the voltages on ADC0 and ADC1 in millivolts (decimal,
+ *  2500 until set), lines starting with '#' are comments. A time followed by "suspend" stops the
+ *  frames, the device suspends 3ms later; "resume" has the host resume the bus. The host enables
+ *  remote wakeup when the configuration descriptor offers it, and resumes the bus 1ms after the
+ *  device signals it:
+ *
+ *  \code
+ *  # time_us  PIND PINB PINF [ADC0_mV ADC1_mV]
+ *  0          ff   00   ff
+ *  1500       fe   00   ff
+ *  3000       ff   00   ff   4000    2500
+ *  5000       suspend
+ *  90000      fe   00   ff
+ *  \endcode
+ *
+ *  The reference traces in Traces/ come from a binary coded dial. HOST_OPTS='-D HOST_GRAY_ENCODER'
+ *  converts the dial position of each line, Port B0-B6, to Gray code as a Gray coded encoder
+ *  outputs it, to replay them on a DIAL_GRAY_CODED build; a capture of such a board is replayed
+ *  without it.
+ *
+ *  Reports are printed on stdout as the receive time in microseconds, the endpoint and the
+ *  payload bytes, diagnostics and a summary go to stderr. The summary includes the share of the
+ *  simulated time the CPU was awake, which only drops below 100% if the firmware sleeps, and the
+ *  metrics of HostMetrics.c, which compare the reports with the ground truth of the trace.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/sleep.h>
+
+#include "Host.h"
+
+/** CPU cycles taken by one iteration of the firmware main loop. */
+#if !defined(HOST_LOOP_CYCLES)
+#define HOST_LOOP_CYCLES      160
+#endif
+
+/** Dial position bits of Port B. */
+#define HOST_DIAL_MASK        0x7F
+
+/** Skips the IN polls of every Nth frame, as a busy host controller may, zero to poll every frame. */
+#if !defined(HOST_SKIP_POLL_EVERY)
+#define HOST_SKIP_POLL_EVERY  0
+#endif
+
+/** Bus idle time after which the device detects a suspend, in microseconds. */
+#define HOST_SUSPEND_US       3000
+
+/** Resume signalling by the host before the frames restart, in microseconds. */
+#define HOST_RESUME_US        20000
+
+/** Time the host takes to resume the bus after a remote wakeup, in microseconds. */
+#define HOST_REMOTE_WAKEUP_US 1000
+
+/** Granularity of the simulated time while the CPU sleeps, in cycles. */
+#define HOST_SLEEP_STEP_CYCLES 16
+
+/** Time simulated after the last trace line before the harness exits, in microseconds. */
+#define HOST_TAIL_US          20000
+
+#define HOST_FRAME_CYCLES     HOST_US_TO_CYCLES(1000)
+#define HOST_NEVER            UINT64_MAX
+
+typedef struct {
+	uint64_t Cycles;
+	uint8_t  PinD;
+	uint8_t  PinB;
+	uint8_t  PinF;
+	bool     HasAnalog;
+	uint16_t Millivolts[HOST_ADC_CHANNELS];
+	uint8_t  Bus;        /**< Bus event of the line, the pins are left as they are if not HOST_BUS_None */
+} Host_TraceLine_t;
+
+static Host_TraceLine_t NextLine;
+static bool             TraceEnded;
+static uint64_t         LastLineCycles;
+
+static bool             Enumerated;
+static uint64_t         NextFrameCycles;
+static uint64_t         NextPollCycles;
+static uint64_t         NextBusCycles = HOST_NEVER;
+static uint8_t          NextBusEvent;
+static bool             RemoteWakeup;
+static uint32_t         Frames;
+static uint32_t         Reports[HOST_MAX_ENDPOINTS + 1];
+static uint64_t         StartCycles;
+static uint64_t         SleepCycles;
+
+static void ReadNextLine(void)
+{
+	char Line[256];
+
+	while (fgets(Line, sizeof(Line), stdin) != NULL) {
+		unsigned long long Time;
+		unsigned int       PinD, PinB, PinF;
+		unsigned int       Millivolts0, Millivolts1;
+		char               Word[16];
+		int                Fields;
+
+		if (Line[0] == '#')
+			continue;
+
+		if (sscanf(Line, "%llu %15s", &Time, Word) == 2) {
+			uint8_t Bus = (!strcmp(Word, "suspend") ? HOST_BUS_Suspend :
+			               (!strcmp(Word, "resume") ? HOST_BUS_Resume : HOST_BUS_None));
+
+			if (Bus != HOST_BUS_None) {
+				NextLine       = (Host_TraceLine_t){.Cycles = HOST_US_TO_CYCLES(Time), .Bus = Bus};
+				LastLineCycles = NextLine.Cycles;
+				return;
+			}
+		}
+
+		Fields = sscanf(Line, "%llu %x %x %x %u %u", &Time, &PinD, &PinB, &PinF, &Millivolts0, &Millivolts1);
+		if ((Fields != 4) && (Fields != 6))
+			continue;
+
+#if defined(HOST_GRAY_ENCODER)
+		PinB ^= ((PinB & HOST_DIAL_MASK) >> 1);
+#endif
+
+		NextLine = (Host_TraceLine_t){
+			.Cycles     = HOST_US_TO_CYCLES(Time),
+			.PinD       = PinD,
+			.PinB       = PinB,
+			.PinF       = PinF,
+			.HasAnalog  = (Fields == 6),
+			.Millivolts = {Millivolts0, Millivolts1},
+		};
+		LastLineCycles = NextLine.Cycles;
+		return;
+	}
+
+	TraceEnded = true;
+}
+
+/** Sets the idle pin levels, all inputs pulled up, before the firmware samples them. */
+static void __attribute__((constructor)) Host_TraceInit(void)
+{
+	PIND = 0xFF;
+	PINB = 0xFF;
+	PINF = 0xFF;
+
+	ReadNextLine();
+
+	if (!TraceEnded && (NextLine.Cycles == 0) && (NextLine.Bus == HOST_BUS_None)) {
+		PIND = NextLine.PinD;
+		PINB = NextLine.PinB;
+		PINF = NextLine.PinF;
+		if (NextLine.HasAnalog)
+			Host_SetAnalog(NextLine.Millivolts[0], NextLine.Millivolts[1]);
+		ReadNextLine();
+	}
+
+	Host_MetricsPins(0, PIND, PINB, PINF);
+}
+
+static uint16_t GetDescriptor(const uint8_t Recipient,
+                              const uint8_t Type,
+                              const uint8_t Index,
+                              const uint16_t wIndex,
+                              uint8_t* const Buffer,
+                              const uint16_t Length)
+{
+	USB_Request_Header_t Request = {
+		.bmRequestType = (REQDIR_DEVICETOHOST | REQTYPE_STANDARD | Recipient),
+		.bRequest      = 0x06,
+		.wValue        = ((Type << 8) | Index),
+		.wIndex        = wIndex,
+		.wLength       = Length,
+	};
+
+	int16_t Received = Host_USBControlRequest(&Request, Buffer);
+
+	return ((Received < 0) ? 0 : Received);
+}
+
+static void DescriptorError(const char* const Message)
+{
+	fprintf(stderr, "descriptor error: %s\n", Message);
+	exit(EXIT_FAILURE);
+}
+
+static void CheckString(const uint8_t Index)
+{
+	uint8_t  Buffer[256];
+	uint16_t Length;
+
+	if (Index == NO_DESCRIPTOR)
+		return;
+
+	Length = GetDescriptor(REQREC_DEVICE, DTYPE_String, Index, 0, Buffer, sizeof(Buffer));
+
+	if ((Length < 2) || (Length != Buffer[0]) || (Buffer[1] != DTYPE_String))
+		DescriptorError("bad string descriptor");
+
+	fprintf(stderr, "string %d: \"", Index);
+	for (uint16_t i = 2; i + 1 < Length; i += 2)
+		fputc(Buffer[i + 1] ? '?' : Buffer[i], stderr);
+	fprintf(stderr, "\"\n");
+}
+
+/** Fetches every descriptor through CALLBACK_USB_GetDescriptor() and checks their sizes against
+ *  the lengths announced by their parents, as a host would during enumeration.
+ */
+static void CheckDescriptors(void)
+{
+	uint8_t  Device[64];
+	uint8_t  Config[512];
+	uint8_t  Report[512];
+	uint16_t Length;
+	uint8_t  Interface = 0;
+
+	Length = GetDescriptor(REQREC_DEVICE, DTYPE_Device, 0, 0, Device, sizeof(Device));
+	if ((Length != sizeof(USB_Descriptor_Device_t)) || (Device[0] != Length) || (Device[1] != DTYPE_Device))
+		DescriptorError("bad device descriptor");
+
+	fprintf(stderr, "device %04X:%04X\n", (Device[9] << 8) | Device[8], (Device[11] << 8) | Device[10]);
+
+	CheckString(0);
+	CheckString(Device[14]);
+	CheckString(Device[15]);
+	CheckString(Device[16]);
+
+	Length = GetDescriptor(REQREC_DEVICE, DTYPE_Configuration, 0, 0, Config, sizeof(Config));
+	if ((Length < sizeof(USB_Descriptor_Configuration_Header_t)) || (Length != ((Config[3] << 8) | Config[2])))
+		DescriptorError("configuration descriptor length does not match wTotalLength");
+
+	RemoteWakeup = ((Config[7] & USB_CONFIG_ATTR_REMOTEWAKEUP) != 0);
+	fprintf(stderr, "configuration: %d interfaces, remote wakeup %s\n", Config[4], (RemoteWakeup ? "on" : "off"));
+
+	for (uint16_t Offset = 0; Offset < Length; Offset += Config[Offset]) {
+		uint8_t* Descriptor = &Config[Offset];
+
+		if ((Descriptor[0] < 2) || (Offset + Descriptor[0] > Length))
+			DescriptorError("truncated configuration descriptor");
+
+		switch (Descriptor[1]) {
+		case DTYPE_Interface:
+			Interface = Descriptor[2];
+			break;
+
+		case DTYPE_Endpoint:
+			fprintf(stderr, "interface %d: endpoint %02X, %d bytes, %d ms\n", Interface,
+			        Descriptor[2], (Descriptor[5] << 8) | Descriptor[4], Descriptor[6]);
+			break;
+
+		case HID_DTYPE_HID:
+		{
+			uint16_t Expected = ((Descriptor[8] << 8) | Descriptor[7]);
+			uint8_t  HID[16];
+
+			if (GetDescriptor(REQREC_INTERFACE, HID_DTYPE_HID, 0, Interface, HID, sizeof(HID)) != Descriptor[0] ||
+			    memcmp(HID, Descriptor, Descriptor[0]))
+				DescriptorError("HID descriptor differs from the configuration descriptor");
+
+			if (GetDescriptor(REQREC_INTERFACE, HID_DTYPE_Report, 0, Interface, Report, sizeof(Report)) != Expected)
+				DescriptorError("HID report descriptor length does not match the HID descriptor");
+
+			fprintf(stderr, "interface %d: HID report descriptor, %d bytes\n", Interface, Expected);
+			break;
+		}
+		}
+	}
+}
+
+static void PollEndpoints(void)
+{
+	uint64_t Time = HOST_CYCLES_TO_US(Host_Cycles);
+
+	for (uint8_t EndpointNumber = 1; EndpointNumber <= HOST_MAX_ENDPOINTS; EndpointNumber++) {
+		uint8_t  Buffer[HOST_MAX_ENDPOINT_SIZE];
+		uint16_t Length;
+
+		if (!Host_USBIsINEndpoint(EndpointNumber) || !(Length = Host_USBReadIN(EndpointNumber, Buffer)))
+			continue;
+
+		Reports[EndpointNumber]++;
+		Host_MetricsReport(Host_Cycles, EndpointNumber, Buffer, Length);
+
+		printf("%" PRIu64 " EP%d", Time, EndpointNumber);
+		for (uint16_t i = 0; i < Length; i++)
+			printf(" %02X", Buffer[i]);
+		printf("\n");
+	}
+}
+
+static void Finish(void)
+{
+	uint64_t Cycles = (Host_Cycles - StartCycles);
+
+	fprintf(stderr, "%" PRIu32 " frames\n", Frames);
+	fprintf(stderr, "CPU active %.1f%%\n", (Cycles ? ((100.0 * (Cycles - SleepCycles)) / Cycles) : 100.0));
+	fprintf(stderr, "CPU powered down %.1f%%\n", (Cycles ? ((100.0 * Host_PowerDownCycles) / Cycles) : 0.0));
+
+	for (uint8_t EndpointNumber = 1; EndpointNumber <= HOST_MAX_ENDPOINTS; EndpointNumber++) {
+		if (Host_USBIsINEndpoint(EndpointNumber))
+			fprintf(stderr, "EP%d: %" PRIu32 " reports\n", EndpointNumber, Reports[EndpointNumber]);
+	}
+
+	Host_MetricsFinish(Host_Cycles);
+
+	exit(EXIT_SUCCESS);
+}
+
+/** Has the host resume the bus: the device wakes up at once, the frames restart after the resume
+ *  signalling.
+ */
+static void Resume(void)
+{
+	NextBusCycles = HOST_NEVER;
+
+	/* Within 3ms of the last frame the device has not suspended yet, the frames just go on */
+	if (USB_DeviceState != DEVICE_STATE_Suspended) {
+		if (NextFrameCycles == HOST_NEVER)
+			NextFrameCycles = Host_Cycles;
+		return;
+	}
+
+	NextFrameCycles = (Host_Cycles + HOST_US_TO_CYCLES(HOST_RESUME_US));
+
+	Host_MetricsBus(NextFrameCycles, HOST_BUS_Resume);
+	Host_USBResume();
+}
+
+/** Applies the bus event of a trace line. */
+static void BusEvent(const uint8_t Event)
+{
+	if (Event == HOST_BUS_Suspend) {
+		/* A bus the device was not woken from stays suspended */
+		if (USB_DeviceState == DEVICE_STATE_Suspended)
+			return;
+
+		NextFrameCycles = HOST_NEVER;
+		NextPollCycles  = HOST_NEVER;
+		NextBusCycles   = (Host_Cycles + HOST_US_TO_CYCLES(HOST_SUSPEND_US));
+		NextBusEvent    = HOST_BUS_Suspend;
+	} else {
+		Resume();
+	}
+}
+
+/** Runs the harness up to the given cycle count: pin changes, bus events, frames and IN polls. */
+static void RunUntil(const uint64_t Target)
+{
+	if (!Enumerated) {
+		Enumerated = true;
+
+		CheckDescriptors();
+		Host_USBConnect();
+
+		/* SET_FEATURE(DEVICE_REMOTE_WAKEUP), which the host sends when the configuration offers it */
+#if !defined(HOST_NO_REMOTE_WAKEUP)
+		USB_Device_RemoteWakeupEnabled = RemoteWakeup;
+#endif
+		Host_MetricsStart();
+
+		NextFrameCycles = Host_Cycles;
+		NextPollCycles  = HOST_NEVER;
+		StartCycles     = Host_Cycles;
+	}
+
+	for (;;) {
+		uint64_t NextPinCycles;
+		uint64_t Next;
+
+		if (Host_USBTakeRemoteWakeup()) {
+			Host_MetricsBus(Host_Cycles, HOST_BUS_RemoteWakeup);
+
+			NextBusCycles = (Host_Cycles + HOST_US_TO_CYCLES(HOST_REMOTE_WAKEUP_US));
+			NextBusEvent  = HOST_BUS_Resume;
+		}
+
+		NextPinCycles = (TraceEnded ? HOST_NEVER : NextLine.Cycles);
+		Next          = MIN(MIN(NextPinCycles, NextBusCycles), MIN(NextFrameCycles, NextPollCycles));
+
+		if (Next > Target)
+			break;
+
+		if (Next > Host_Cycles)
+			Host_AdvanceCycles(Next - Host_Cycles);
+
+		if (Next == NextBusCycles) {
+			NextBusCycles = HOST_NEVER;
+
+			if (NextBusEvent == HOST_BUS_Suspend) {
+				Host_MetricsBus(Host_Cycles, HOST_BUS_Suspend);
+				Host_USBSuspend();
+			} else {
+				Resume();
+			}
+		} else if ((Next == NextPinCycles) && (NextLine.Bus != HOST_BUS_None)) {
+			BusEvent(NextLine.Bus);
+			ReadNextLine();
+		} else if (Next == NextPinCycles) {
+			if (NextLine.HasAnalog)
+				Host_SetAnalog(NextLine.Millivolts[0], NextLine.Millivolts[1]);
+			Host_SetPins(NextLine.PinD, NextLine.PinB, NextLine.PinF);
+			Host_MetricsPins(Host_Cycles, NextLine.PinD, NextLine.PinB, NextLine.PinF);
+			ReadNextLine();
+		} else if (Next == NextFrameCycles) {
+			Frames++;
+			NextPollCycles   = (NextFrameCycles + HOST_US_TO_CYCLES(HOST_IN_OFFSET_US));
+			if (HOST_SKIP_POLL_EVERY && !(Frames % HOST_SKIP_POLL_EVERY))
+				NextPollCycles = HOST_NEVER;
+			NextFrameCycles += HOST_FRAME_CYCLES;
+			Host_USBStartOfFrame();
+		} else {
+			NextPollCycles = HOST_NEVER;
+			PollEndpoints();
+		}
+	}
+
+	Host_AdvanceCycles(Target - Host_Cycles);
+
+	if (TraceEnded && (Host_Cycles > (LastLineCycles + HOST_US_TO_CYCLES(HOST_TAIL_US))))
+		Finish();
+}
+
+void Host_Yield(void)
+{
+	RunUntil(Host_Cycles + HOST_LOOP_CYCLES);
+}
+
+/** Sleeps until an interrupt or USB event is serviced, in steps of \ref HOST_SLEEP_STEP_CYCLES.
+ *  The sleep instruction does nothing unless the firmware enabled sleeping.
+ */
+void Host_Sleep(void)
+{
+	uint32_t Wakeups = Host_Wakeups;
+	uint64_t Start   = Host_Cycles;
+
+	if (!(SMCR & (1 << SE)))
+		return;
+
+	/* An interrupt pending when sleep is entered wakes the CPU at once */
+	Host_DispatchInterrupts();
+
+	while (Host_Wakeups == Wakeups)
+		RunUntil(Host_Cycles + HOST_SLEEP_STEP_CYCLES);
+
+	SleepCycles += (Host_Cycles - Start);
+}
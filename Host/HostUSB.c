@@ -0,0 +1,371 @@
+/** \file
+ *
+ *  Fake LUFA USB device stack and HID device class driver for the host build. The HID class
+ *  driver logic mirrors LUFA 110528 so that report generation and change suppression behave as on
+ *  the device; endpoints are plain memory banks which the harness drains as the host would.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Host.h"
+
+/* Events are optional in LUFA, the firmware only implements the ones it needs */
+void EVENT_USB_Device_Connect(void) ATTR_WEAK;
+void EVENT_USB_Device_Disconnect(void) ATTR_WEAK;
+void EVENT_USB_Device_ConfigurationChanged(void) ATTR_WEAK;
+void EVENT_USB_Device_ControlRequest(void) ATTR_WEAK;
+void EVENT_USB_Device_StartOfFrame(void) ATTR_WEAK;
+void EVENT_USB_Device_Suspend(void) ATTR_WEAK;
+void EVENT_USB_Device_WakeUp(void) ATTR_WEAK;
+void EVENT_USB_Device_Reset(void) ATTR_WEAK;
+
+#define RAISE_EVENT(Event)  do { if (Event) Event(); } while (0)
+
+volatile uint8_t     USB_DeviceState;
+USB_Request_Header_t USB_ControlRequest;
+bool                 USB_Device_RemoteWakeupEnabled;
+
+typedef struct {
+	bool     Configured;
+	uint8_t  Banks;
+	uint16_t Size;
+	uint8_t  Pending;
+	uint8_t  First;
+	uint16_t Length[2];
+	uint8_t  Data[2][HOST_MAX_ENDPOINT_SIZE];
+} Host_Endpoint_t;
+
+static Host_Endpoint_t Endpoints[HOST_MAX_ENDPOINTS + 1];
+static bool            SOFEventsEnabled;
+static bool            RemoteWakeupSignalled;
+
+/* Control transfer in progress, see Host_USBControlRequest() */
+static uint8_t*        ControlData;
+static int16_t         ControlLength;
+static bool            ControlHandled;
+
+void USB_Init(void)
+{
+	USB_DeviceState = DEVICE_STATE_Unattached;
+	memset(Endpoints, 0, sizeof(Endpoints));
+}
+
+void USB_USBTask(void)
+{
+	Host_Yield();
+}
+
+void USB_Device_EnableSOFEvents(void)
+{
+	SOFEventsEnabled = true;
+}
+
+void USB_Device_DisableSOFEvents(void)
+{
+	SOFEventsEnabled = false;
+}
+
+static bool EndpointHasFreeBank(const uint8_t EndpointNumber)
+{
+	Host_Endpoint_t* Endpoint = &Endpoints[EndpointNumber];
+
+	return (Endpoint->Configured && (Endpoint->Pending < Endpoint->Banks));
+}
+
+static void EndpointCommitIN(const uint8_t EndpointNumber,
+                             const uint8_t ReportID,
+                             const void* const Data,
+                             const uint16_t Length)
+{
+	Host_Endpoint_t* Endpoint = &Endpoints[EndpointNumber];
+	uint8_t          Bank     = ((Endpoint->First + Endpoint->Pending) % Endpoint->Banks);
+	uint8_t*         Buffer   = Endpoint->Data[Bank];
+	uint16_t         Total    = 0;
+
+	if (ReportID)
+		Buffer[Total++] = ReportID;
+
+	memcpy(&Buffer[Total], Data, MIN(Length, (uint16_t)(HOST_MAX_ENDPOINT_SIZE - Total)));
+	Total += Length;
+
+	if (Total > Endpoint->Size)
+		fprintf(stderr, "EP%d: %d byte report exceeds the %d byte endpoint\n", EndpointNumber, Total, Endpoint->Size);
+
+	Endpoint->Length[Bank] = MIN(Total, HOST_MAX_ENDPOINT_SIZE);
+	Endpoint->Pending++;
+}
+
+bool HID_Device_ConfigureEndpoints(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo)
+{
+	uint8_t          EndpointNumber = HIDInterfaceInfo->Config.ReportINEndpointNumber;
+	Host_Endpoint_t* Endpoint       = &Endpoints[EndpointNumber];
+
+	memset(&HIDInterfaceInfo->State, 0x00, sizeof(HIDInterfaceInfo->State));
+	HIDInterfaceInfo->State.UsingReportProtocol = true;
+	HIDInterfaceInfo->State.IdleCount           = 500;
+
+	if ((EndpointNumber == 0) || (EndpointNumber > HOST_MAX_ENDPOINTS) ||
+	    (HIDInterfaceInfo->Config.ReportINEndpointSize > HOST_MAX_ENDPOINT_SIZE))
+		return false;
+
+	memset(Endpoint, 0x00, sizeof(Host_Endpoint_t));
+	Endpoint->Configured = true;
+	Endpoint->Banks      = (HIDInterfaceInfo->Config.ReportINEndpointDoubleBank ? 2 : 1);
+	Endpoint->Size       = HIDInterfaceInfo->Config.ReportINEndpointSize;
+
+	return true;
+}
+
+void HID_Device_ProcessControlRequest(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo)
+{
+	if (USB_ControlRequest.wIndex != HIDInterfaceInfo->Config.InterfaceNumber)
+		return;
+
+	switch (USB_ControlRequest.bRequest) {
+	case HID_REQ_GetReport:
+		if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE)) {
+			uint16_t ReportSize = 0;
+			uint8_t  ReportID   = (USB_ControlRequest.wValue & 0xFF);
+			uint8_t  ReportType = (USB_ControlRequest.wValue >> 8) - 1;
+			uint8_t  ReportData[HIDInterfaceInfo->Config.PrevReportINBufferSize];
+
+			memset(ReportData, 0, sizeof(ReportData));
+
+			CALLBACK_HID_Device_CreateHIDReport(HIDInterfaceInfo, &ReportID, ReportType, ReportData, &ReportSize);
+
+			if (HIDInterfaceInfo->Config.PrevReportINBuffer != NULL)
+				memcpy(HIDInterfaceInfo->Config.PrevReportINBuffer, ReportData, HIDInterfaceInfo->Config.PrevReportINBufferSize);
+
+			ControlHandled = true;
+			ControlLength  = MIN(ReportSize, USB_ControlRequest.wLength);
+			memcpy(ControlData, ReportData, ControlLength);
+		}
+		break;
+
+	case HID_REQ_SetReport:
+		if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE)) {
+			uint16_t ReportSize = USB_ControlRequest.wLength;
+			uint8_t  ReportID   = (USB_ControlRequest.wValue & 0xFF);
+			uint8_t  ReportType = (USB_ControlRequest.wValue >> 8) - 1;
+
+			ControlHandled = true;
+			ControlLength  = ReportSize;
+
+			CALLBACK_HID_Device_ProcessHIDReport(HIDInterfaceInfo, ReportID, ReportType,
+			                                     &ControlData[ReportID ? 1 : 0], ReportSize - (ReportID ? 1 : 0));
+		}
+		break;
+
+	case HID_REQ_GetProtocol:
+		if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE)) {
+			ControlHandled = true;
+			ControlLength  = 1;
+			ControlData[0] = HIDInterfaceInfo->State.UsingReportProtocol;
+		}
+		break;
+
+	case HID_REQ_SetProtocol:
+		if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE)) {
+			ControlHandled = true;
+			ControlLength  = 0;
+			HIDInterfaceInfo->State.UsingReportProtocol = ((USB_ControlRequest.wValue & 0xFF) != 0x00);
+		}
+		break;
+
+	case HID_REQ_SetIdle:
+		if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE)) {
+			ControlHandled = true;
+			ControlLength  = 0;
+			HIDInterfaceInfo->State.IdleCount = ((USB_ControlRequest.wValue & 0xFF00) >> 6);
+		}
+		break;
+
+	case HID_REQ_GetIdle:
+		if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE)) {
+			ControlHandled = true;
+			ControlLength  = 1;
+			ControlData[0] = (HIDInterfaceInfo->State.IdleCount >> 2);
+		}
+		break;
+	}
+}
+
+void HID_Device_USBTask(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo)
+{
+	if (USB_DeviceState != DEVICE_STATE_Configured)
+		return;
+
+	if (EndpointHasFreeBank(HIDInterfaceInfo->Config.ReportINEndpointNumber)) {
+		uint8_t  ReportINData[HIDInterfaceInfo->Config.PrevReportINBufferSize];
+		uint8_t  ReportID     = 0;
+		uint16_t ReportINSize = 0;
+
+		memset(ReportINData, 0, sizeof(ReportINData));
+
+		bool ForceSend         = CALLBACK_HID_Device_CreateHIDReport(HIDInterfaceInfo, &ReportID, HID_REPORT_ITEM_In,
+		                                                             ReportINData, &ReportINSize);
+		bool StatesChanged     = false;
+		bool IdlePeriodElapsed = (HIDInterfaceInfo->State.IdleCount && !(HIDInterfaceInfo->State.IdleMSRemaining));
+
+		if (HIDInterfaceInfo->Config.PrevReportINBuffer != NULL) {
+			StatesChanged = (memcmp(ReportINData, HIDInterfaceInfo->Config.PrevReportINBuffer, ReportINSize) != 0);
+			memcpy(HIDInterfaceInfo->Config.PrevReportINBuffer, ReportINData, HIDInterfaceInfo->Config.PrevReportINBufferSize);
+		}
+
+		if (ReportINSize && (ForceSend || StatesChanged || IdlePeriodElapsed)) {
+			HIDInterfaceInfo->State.IdleMSRemaining = HIDInterfaceInfo->State.IdleCount;
+
+			EndpointCommitIN(HIDInterfaceInfo->Config.ReportINEndpointNumber, ReportID, ReportINData, ReportINSize);
+		}
+	}
+}
+
+void HID_Device_MillisecondElapsed(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo)
+{
+	if (HIDInterfaceInfo->State.IdleMSRemaining)
+		HIDInterfaceInfo->State.IdleMSRemaining--;
+}
+
+/** Attaches the device and runs the host side of the enumeration up to SET_CONFIGURATION. */
+void Host_USBConnect(void)
+{
+	USB_DeviceState = DEVICE_STATE_Powered;
+	RAISE_EVENT(EVENT_USB_Device_Connect);
+
+	USB_DeviceState = DEVICE_STATE_Default;
+	RAISE_EVENT(EVENT_USB_Device_Reset);
+
+	USB_DeviceState = DEVICE_STATE_Addressed;
+
+	USB_DeviceState = DEVICE_STATE_Configured;
+	RAISE_EVENT(EVENT_USB_Device_ConfigurationChanged);
+}
+
+/** Raises a USB controller interrupt event, which wakes the CPU from any sleep mode. */
+static void RaiseInterruptEvent(void (*const Event)(void))
+{
+	uint8_t SavedSREG = SREG;
+
+	SREG &= ~(1 << SREG_I);
+	Host_Wakeups++;
+	RAISE_EVENT(Event);
+	SREG = SavedSREG;
+}
+
+void USB_Device_SendRemoteWakeup(void)
+{
+	RemoteWakeupSignalled = true;
+}
+
+/** Suspends the configured device, as the suspend interrupt does after 3ms without bus activity. */
+void Host_USBSuspend(void)
+{
+	if (USB_DeviceState != DEVICE_STATE_Configured)
+		return;
+
+	USB_DeviceState = DEVICE_STATE_Suspended;
+	RaiseInterruptEvent(EVENT_USB_Device_Suspend);
+}
+
+/** Resumes the suspended device, as the wakeup interrupt does at the first resume signalling. */
+void Host_USBResume(void)
+{
+	if (USB_DeviceState != DEVICE_STATE_Suspended)
+		return;
+
+	USB_DeviceState = DEVICE_STATE_Configured;
+	RaiseInterruptEvent(EVENT_USB_Device_WakeUp);
+}
+
+/** Returns whether the device signalled remote wakeup since the last call. */
+bool Host_USBTakeRemoteWakeup(void)
+{
+	bool Signalled = RemoteWakeupSignalled;
+
+	RemoteWakeupSignalled = false;
+	return Signalled;
+}
+
+/** Raises the start of frame event, as the USB controller interrupt would once per millisecond. */
+void Host_USBStartOfFrame(void)
+{
+	if (SOFEventsEnabled && (SREG & (1 << SREG_I))) {
+		uint8_t SavedSREG = SREG;
+
+		SREG &= ~(1 << SREG_I);
+		Host_Wakeups++;
+		RAISE_EVENT(EVENT_USB_Device_StartOfFrame);
+		SREG = SavedSREG;
+	}
+}
+
+/** Issues a control request to the device, standard GET_DESCRIPTOR requests are answered through
+ *  CALLBACK_USB_GetDescriptor() like the LUFA core does.
+ *
+ *  \param[in]     Request  SETUP packet of the request
+ *  \param[in,out] Data     Data stage buffer, at least wLength bytes
+ *
+ *  \return Number of bytes transferred in the data stage, or -1 if the request was stalled
+ */
+int16_t Host_USBControlRequest(const USB_Request_Header_t* const Request,
+                               void* const Data)
+{
+	USB_ControlRequest = *Request;
+	ControlData        = Data;
+	ControlLength      = -1;
+	ControlHandled     = false;
+
+#if defined(INTERRUPT_CONTROL_ENDPOINT)
+	/* Control requests are processed in the USB controller interrupt */
+	uint8_t SavedSREG = SREG;
+
+	SREG &= ~(1 << SREG_I);
+	Host_Wakeups++;
+	RAISE_EVENT(EVENT_USB_Device_ControlRequest);
+	SREG = SavedSREG;
+#else
+	RAISE_EVENT(EVENT_USB_Device_ControlRequest);
+#endif
+
+	if (!ControlHandled && (Request->bRequest == 0x06) &&
+	    ((Request->bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_STANDARD | REQREC_DEVICE)) ||
+	     (Request->bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_STANDARD | REQREC_INTERFACE)))) {
+		const void* Address = NULL;
+		uint16_t    Size    = CALLBACK_USB_GetDescriptor(Request->wValue, (Request->wIndex & 0xFF), &Address);
+
+		if ((Size != NO_DESCRIPTOR) && (Address != NULL)) {
+			ControlLength = MIN(Size, Request->wLength);
+			memcpy(Data, Address, ControlLength);
+		}
+	}
+
+	return ControlLength;
+}
+
+/** Performs an IN transaction on the given endpoint, as the host does once per polling interval.
+ *
+ *  \return Length of the packet read, zero if the endpoint had no data (NAK)
+ */
+uint16_t Host_USBReadIN(const uint8_t EndpointNumber,
+                        uint8_t* const Buffer)
+{
+	Host_Endpoint_t* Endpoint = &Endpoints[EndpointNumber];
+	uint16_t         Length;
+
+	if (!Endpoint->Configured || !Endpoint->Pending)
+		return 0;
+
+	Length = Endpoint->Length[Endpoint->First];
+	memcpy(Buffer, Endpoint->Data[Endpoint->First], Length);
+
+	Endpoint->First = ((Endpoint->First + 1) % Endpoint->Banks);
+	Endpoint->Pending--;
+
+	return Length;
+}
+
+bool Host_USBIsINEndpoint(const uint8_t EndpointNumber)
+{
+	return Endpoints[EndpointNumber].Configured;
+}
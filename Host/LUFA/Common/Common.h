@@ -0,0 +1,42 @@
+/** \file
+ *
+ *  Host replacement for the LUFA common definitions header.
+ */
+
+#ifndef _HOST_LUFA_COMMON_H_
+#define _HOST_LUFA_COMMON_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define ARCH_AVR8                    0
+#define BOARD_USER                   0
+#define BOARD_NONE                   1
+
+#define ATTR_WARN_UNUSED_RESULT      __attribute__((warn_unused_result))
+#define ATTR_NON_NULL_PTR_ARG(...)   __attribute__((nonnull(__VA_ARGS__)))
+#define ATTR_NO_RETURN               __attribute__((noreturn))
+#define ATTR_ALWAYS_INLINE           __attribute__((always_inline))
+#define ATTR_CONST                   __attribute__((const))
+#define ATTR_PURE                    __attribute__((pure))
+#define ATTR_WEAK                    __attribute__((weak))
+#define ATTR_PACKED                  __attribute__((packed))
+#define ATTR_NO_INIT
+#define ATTR_INIT_SECTION(x)
+
+#if !defined(MIN)
+#define MIN(x, y)                    (((x) < (y)) ? (x) : (y))
+#endif
+
+#if !defined(MAX)
+#define MAX(x, y)                    (((x) > (y)) ? (x) : (y))
+#endif
+
+#define CPU_TO_LE16(x)               (x)
+#define LE16_TO_CPU(x)               (x)
+
+#define GCC_MEMORY_BARRIER()         __asm__ __volatile__("" ::: "memory")
+
+#endif
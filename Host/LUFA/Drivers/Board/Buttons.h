@@ -0,0 +1,15 @@
+/** \file
+ *
+ *  Host replacement for the LUFA Buttons board driver dispatch header, always selects the
+ *  application's own driver in Board/Buttons.h.
+ */
+
+#ifndef _HOST_LUFA_BUTTONS_H_
+#define _HOST_LUFA_BUTTONS_H_
+
+#define __INCLUDE_FROM_BUTTONS_H
+
+#include <LUFA/Common/Common.h>
+#include <Board/Buttons.h>
+
+#endif
@@ -0,0 +1,15 @@
+/** \file
+ *
+ *  Host replacement for the LUFA Joystick board driver dispatch header, always selects the
+ *  application's own driver in Board/Joystick.h.
+ */
+
+#ifndef _HOST_LUFA_JOYSTICK_H_
+#define _HOST_LUFA_JOYSTICK_H_
+
+#define __INCLUDE_FROM_JOYSTICK_H
+
+#include <LUFA/Common/Common.h>
+#include <Board/Joystick.h>
+
+#endif
@@ -0,0 +1,32 @@
+/** \file
+ *
+ *  Host replacement for the LUFA LEDs board driver dispatch header, always selects the
+ *  application's own driver in Board/LEDs.h.
+ */
+
+#ifndef _HOST_LUFA_LEDS_H_
+#define _HOST_LUFA_LEDS_H_
+
+#define __INCLUDE_FROM_LEDS_H
+
+#include <LUFA/Common/Common.h>
+#include <Board/LEDs.h>
+
+/* As in LUFA, LEDs missing on the board map to an empty mask */
+#if !defined(LEDS_LED1)
+#define LEDS_LED1  0
+#endif
+
+#if !defined(LEDS_LED2)
+#define LEDS_LED2  0
+#endif
+
+#if !defined(LEDS_LED3)
+#define LEDS_LED3  0
+#endif
+
+#if !defined(LEDS_LED4)
+#define LEDS_LED4  0
+#endif
+
+#endif
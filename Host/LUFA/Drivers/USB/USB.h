@@ -0,0 +1,381 @@
+/** \file
+ *
+ *  Host replacement for the LUFA USB core and HID device class driver headers. The types and
+ *  macros follow LUFA 110528 closely enough that Descriptors.c and Joystick.c compile unchanged,
+ *  the functions are implemented by the fake device stack in HostUSB.c.
+ */
+
+#ifndef _HOST_LUFA_USB_H_
+#define _HOST_LUFA_USB_H_
+
+#include <stddef.h>
+#include <wchar.h>
+
+#include <LUFA/Common/Common.h>
+
+/* Standard descriptors */
+#define NO_DESCRIPTOR                     0
+
+#define USB_CONFIG_POWER_MA(mA)           ((mA) >> 1)
+#define USB_STRING_LEN(UnicodeChars)      (sizeof(USB_Descriptor_Header_t) + ((UnicodeChars) << 1))
+
+#define VERSION_TENS(x)                   (int)((x) / 10)
+#define VERSION_ONES(x)                   (int)((x) - (10 * VERSION_TENS(x)))
+#define VERSION_TENTHS(x)                 (int)(((x) - (int)(x)) * 10)
+#define VERSION_HUNDREDTHS(x)             (int)((((x) - (int)(x)) * 100) - (10 * VERSION_TENTHS(x)))
+#define VERSION_BCD(x)                    ((VERSION_TENS(x) << 12) | (VERSION_ONES(x) << 8) | \
+                                           (VERSION_TENTHS(x) << 4) | (VERSION_HUNDREDTHS(x) << 0))
+
+#define LANGUAGE_ID_ENG                   0x0409
+
+#define USB_CONFIG_ATTR_BUSPOWERED        0x80
+#define USB_CONFIG_ATTR_SELFPOWERED       0x40
+#define USB_CONFIG_ATTR_REMOTEWAKEUP      0x20
+
+#define ENDPOINT_ATTR_NO_SYNC             (0 << 2)
+#define ENDPOINT_USAGE_DATA               (0 << 4)
+
+#define ENDPOINT_DESCRIPTOR_DIR_IN        0x80
+#define ENDPOINT_DESCRIPTOR_DIR_OUT       0x00
+
+#define EP_TYPE_CONTROL                   0x00
+#define EP_TYPE_ISOCHRONOUS               0x01
+#define EP_TYPE_BULK                      0x02
+#define EP_TYPE_INTERRUPT                 0x03
+
+#define ENDPOINT_CONTROLEP                0
+
+#define USB_CSCP_NoDeviceClass            0x00
+#define USB_CSCP_NoDeviceSubclass         0x00
+#define USB_CSCP_NoDeviceProtocol         0x00
+#define USB_CSCP_VendorSpecificClass      0xFF
+
+enum USB_DescriptorTypes_t {
+	DTYPE_Device          = 0x01,
+	DTYPE_Configuration   = 0x02,
+	DTYPE_String          = 0x03,
+	DTYPE_Interface       = 0x04,
+	DTYPE_Endpoint        = 0x05,
+};
+
+typedef struct {
+	uint8_t Size;
+	uint8_t Type;
+} ATTR_PACKED USB_Descriptor_Header_t;
+
+typedef struct {
+	USB_Descriptor_Header_t Header;
+
+	uint16_t USBSpecification;
+	uint8_t  Class;
+	uint8_t  SubClass;
+	uint8_t  Protocol;
+	uint8_t  Endpoint0Size;
+	uint16_t VendorID;
+	uint16_t ProductID;
+	uint16_t ReleaseNumber;
+	uint8_t  ManufacturerStrIndex;
+	uint8_t  ProductStrIndex;
+	uint8_t  SerialNumStrIndex;
+	uint8_t  NumberOfConfigurations;
+} ATTR_PACKED USB_Descriptor_Device_t;
+
+typedef struct {
+	USB_Descriptor_Header_t Header;
+
+	uint16_t TotalConfigurationSize;
+	uint8_t  TotalInterfaces;
+	uint8_t  ConfigurationNumber;
+	uint8_t  ConfigurationStrIndex;
+	uint8_t  ConfigAttributes;
+	uint8_t  MaxPowerConsumption;
+} ATTR_PACKED USB_Descriptor_Configuration_Header_t;
+
+typedef struct {
+	USB_Descriptor_Header_t Header;
+
+	uint8_t InterfaceNumber;
+	uint8_t AlternateSetting;
+	uint8_t TotalEndpoints;
+	uint8_t Class;
+	uint8_t SubClass;
+	uint8_t Protocol;
+	uint8_t InterfaceStrIndex;
+} ATTR_PACKED USB_Descriptor_Interface_t;
+
+typedef struct {
+	USB_Descriptor_Header_t Header;
+
+	uint8_t  EndpointAddress;
+	uint8_t  Attributes;
+	uint16_t EndpointSize;
+	uint8_t  PollingIntervalMS;
+} ATTR_PACKED USB_Descriptor_Endpoint_t;
+
+/* The host build uses -fshort-wchar so that L"" literals have the 16-bit code units of the AVR */
+typedef struct {
+	USB_Descriptor_Header_t Header;
+
+	wchar_t UnicodeString[];
+} ATTR_PACKED USB_Descriptor_String_t;
+
+/* Control requests */
+#define REQDIR_HOSTTODEVICE               (0 << 7)
+#define REQDIR_DEVICETOHOST               (1 << 7)
+#define REQTYPE_STANDARD                  (0 << 5)
+#define REQTYPE_CLASS                     (1 << 5)
+#define REQTYPE_VENDOR                    (2 << 5)
+#define REQREC_DEVICE                     (0 << 0)
+#define REQREC_INTERFACE                  (1 << 0)
+#define REQREC_ENDPOINT                   (2 << 0)
+
+typedef struct {
+	uint8_t  bmRequestType;
+	uint8_t  bRequest;
+	uint16_t wValue;
+	uint16_t wIndex;
+	uint16_t wLength;
+} ATTR_PACKED USB_Request_Header_t;
+
+/* Device state */
+enum USB_Device_States_t {
+	DEVICE_STATE_Unattached = 0,
+	DEVICE_STATE_Powered    = 1,
+	DEVICE_STATE_Default    = 2,
+	DEVICE_STATE_Addressed  = 3,
+	DEVICE_STATE_Configured = 4,
+	DEVICE_STATE_Suspended  = 5,
+};
+
+extern volatile uint8_t     USB_DeviceState;
+extern USB_Request_Header_t USB_ControlRequest;
+extern bool                 USB_Device_RemoteWakeupEnabled;
+
+/* USB options, USE_STATIC_OPTIONS of the firmware makefile */
+#define USB_OPT_MANUAL_PLL                (1 << 2)
+#define USB_OPT_AUTO_PLL                  (0 << 2)
+#define USB_Options                       USB_OPT_AUTO_PLL
+
+void USB_Init(void);
+void USB_USBTask(void);
+void USB_Device_EnableSOFEvents(void);
+void USB_Device_DisableSOFEvents(void);
+void USB_Device_SendRemoteWakeup(void);
+
+/* The simulated USB controller has no clock or PLL to stop, LUFA keeps these private */
+static inline void USB_CLK_Freeze(void) {}
+static inline void USB_PLL_Off(void) {}
+
+/* HID class */
+#define HID_CSCP_HIDClass                 0x03
+#define HID_CSCP_NonBootSubclass          0x00
+#define HID_CSCP_BootSubclass             0x01
+#define HID_CSCP_NonBootProtocol          0x00
+#define HID_CSCP_KeyboardBootProtocol     0x01
+#define HID_CSCP_MouseBootProtocol        0x02
+
+#define HID_DTYPE_HID                     0x21
+#define HID_DTYPE_Report                  0x22
+
+#define HID_REQ_GetReport                 0x01
+#define HID_REQ_GetIdle                   0x02
+#define HID_REQ_GetProtocol               0x03
+#define HID_REQ_SetReport                 0x09
+#define HID_REQ_SetIdle                   0x0A
+#define HID_REQ_SetProtocol               0x0B
+
+#define HID_REPORT_ITEM_In                0
+#define HID_REPORT_ITEM_Out               1
+#define HID_REPORT_ITEM_Feature           2
+
+typedef uint8_t USB_Descriptor_HIDReport_Datatype_t;
+
+typedef struct {
+	USB_Descriptor_Header_t Header;
+
+	uint16_t HIDSpec;
+	uint8_t  CountryCode;
+	uint8_t  TotalReportDescriptors;
+	uint8_t  HIDReportType;
+	uint16_t HIDReportLength;
+} ATTR_PACKED USB_HID_Descriptor_HID_t;
+
+typedef struct {
+	uint8_t Button;
+	int8_t  X;
+	int8_t  Y;
+} ATTR_PACKED USB_MouseReport_Data_t;
+
+typedef struct {
+	const struct {
+		uint8_t  InterfaceNumber;
+
+		uint8_t  ReportINEndpointNumber;
+		uint16_t ReportINEndpointSize;
+		bool     ReportINEndpointDoubleBank;
+
+		void*    PrevReportINBuffer;
+		uint8_t  PrevReportINBufferSize;
+	} ATTR_PACKED Config;
+	struct {
+		bool     UsingReportProtocol;
+		uint16_t IdleCount;
+		uint16_t IdleMSRemaining;
+	} ATTR_PACKED State;
+} ATTR_PACKED USB_ClassInfo_HID_Device_t;
+
+bool HID_Device_ConfigureEndpoints(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo);
+void HID_Device_ProcessControlRequest(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo);
+void HID_Device_USBTask(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo);
+void HID_Device_MillisecondElapsed(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo);
+
+/* HID report descriptor items */
+#define HID_RI_DATA_SIZE_MASK             0x03
+#define HID_RI_TYPE_MASK                  0x0C
+#define HID_RI_TAG_MASK                   0xF0
+
+#define HID_RI_TYPE_MAIN                  0x00
+#define HID_RI_TYPE_GLOBAL                0x04
+#define HID_RI_TYPE_LOCAL                 0x08
+
+#define HID_RI_DATA_BITS_0                0x00
+#define HID_RI_DATA_BITS_8                0x01
+#define HID_RI_DATA_BITS_16               0x02
+#define HID_RI_DATA_BITS_32               0x03
+#define HID_RI_DATA_BITS(DataBits)        HID_RI_DATA_BITS_ ## DataBits
+
+#define _HID_RI_ENCODE_0(Data)
+#define _HID_RI_ENCODE_8(Data)            , (Data & 0xFF)
+#define _HID_RI_ENCODE_16(Data)           _HID_RI_ENCODE_8(Data)  _HID_RI_ENCODE_8(Data >> 8)
+#define _HID_RI_ENCODE_32(Data)           _HID_RI_ENCODE_16(Data) _HID_RI_ENCODE_16(Data >> 16)
+#define _HID_RI_ENCODE(DataBits, ...)     _HID_RI_ENCODE_ ## DataBits(__VA_ARGS__)
+
+#define _HID_RI_ENTRY(Type, Tag, DataBits, ...) \
+	(Type | Tag | HID_RI_DATA_BITS(DataBits)) _HID_RI_ENCODE(DataBits, (__VA_ARGS__))
+
+#define HID_IOF_CONSTANT                  (1 << 0)
+#define HID_IOF_DATA                      (0 << 0)
+#define HID_IOF_VARIABLE                  (1 << 1)
+#define HID_IOF_ARRAY                     (0 << 1)
+#define HID_IOF_RELATIVE                  (1 << 2)
+#define HID_IOF_ABSOLUTE                  (0 << 2)
+#define HID_IOF_WRAP                      (1 << 3)
+#define HID_IOF_NO_WRAP                   (0 << 3)
+#define HID_IOF_NON_LINEAR                (1 << 4)
+#define HID_IOF_LINEAR                    (0 << 4)
+#define HID_IOF_NO_PREFERRED_STATE        (1 << 5)
+#define HID_IOF_PREFERRED_STATE           (0 << 5)
+#define HID_IOF_NULLSTATE                 (1 << 6)
+#define HID_IOF_NO_NULL_POSITION          (0 << 6)
+#define HID_IOF_VOLATILE                  (1 << 7)
+#define HID_IOF_NON_VOLATILE              (0 << 7)
+#define HID_IOF_BUFFERED_BYTES            (1 << 8)
+#define HID_IOF_BITFIELD                  (0 << 8)
+
+#define HID_RI_INPUT(DataBits, ...)             _HID_RI_ENTRY(HID_RI_TYPE_MAIN  , 0x80, DataBits, __VA_ARGS__)
+#define HID_RI_OUTPUT(DataBits, ...)            _HID_RI_ENTRY(HID_RI_TYPE_MAIN  , 0x90, DataBits, __VA_ARGS__)
+#define HID_RI_COLLECTION(DataBits, ...)        _HID_RI_ENTRY(HID_RI_TYPE_MAIN  , 0xA0, DataBits, __VA_ARGS__)
+#define HID_RI_FEATURE(DataBits, ...)           _HID_RI_ENTRY(HID_RI_TYPE_MAIN  , 0xB0, DataBits, __VA_ARGS__)
+#define HID_RI_END_COLLECTION(DataBits, ...)    _HID_RI_ENTRY(HID_RI_TYPE_MAIN  , 0xC0, DataBits, __VA_ARGS__)
+#define HID_RI_USAGE_PAGE(DataBits, ...)        _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0x00, DataBits, __VA_ARGS__)
+#define HID_RI_LOGICAL_MINIMUM(DataBits, ...)   _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0x10, DataBits, __VA_ARGS__)
+#define HID_RI_LOGICAL_MAXIMUM(DataBits, ...)   _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0x20, DataBits, __VA_ARGS__)
+#define HID_RI_PHYSICAL_MINIMUM(DataBits, ...)  _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0x30, DataBits, __VA_ARGS__)
+#define HID_RI_PHYSICAL_MAXIMUM(DataBits, ...)  _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0x40, DataBits, __VA_ARGS__)
+#define HID_RI_UNIT_EXPONENT(DataBits, ...)     _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0x50, DataBits, __VA_ARGS__)
+#define HID_RI_UNIT(DataBits, ...)              _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0x60, DataBits, __VA_ARGS__)
+#define HID_RI_REPORT_SIZE(DataBits, ...)       _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0x70, DataBits, __VA_ARGS__)
+#define HID_RI_REPORT_ID(DataBits, ...)         _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0x80, DataBits, __VA_ARGS__)
+#define HID_RI_REPORT_COUNT(DataBits, ...)      _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0x90, DataBits, __VA_ARGS__)
+#define HID_RI_PUSH(DataBits, ...)              _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0xA0, DataBits, __VA_ARGS__)
+#define HID_RI_POP(DataBits, ...)               _HID_RI_ENTRY(HID_RI_TYPE_GLOBAL, 0xB0, DataBits, __VA_ARGS__)
+#define HID_RI_USAGE(DataBits, ...)             _HID_RI_ENTRY(HID_RI_TYPE_LOCAL , 0x00, DataBits, __VA_ARGS__)
+#define HID_RI_USAGE_MINIMUM(DataBits, ...)     _HID_RI_ENTRY(HID_RI_TYPE_LOCAL , 0x10, DataBits, __VA_ARGS__)
+#define HID_RI_USAGE_MAXIMUM(DataBits, ...)     _HID_RI_ENTRY(HID_RI_TYPE_LOCAL , 0x20, DataBits, __VA_ARGS__)
+
+#define HID_DESCRIPTOR_JOYSTICK(MinAxisVal, MaxAxisVal, MinPhysicalVal, MaxPhysicalVal, Buttons) \
+	HID_RI_USAGE_PAGE(8, 0x01),                                                      \
+	HID_RI_USAGE(8, 0x04),                                                           \
+	HID_RI_COLLECTION(8, 0x01),                                                      \
+		HID_RI_USAGE(8, 0x01),                                                       \
+		HID_RI_COLLECTION(8, 0x00),                                                  \
+			HID_RI_USAGE(8, 0x30),                                                   \
+			HID_RI_USAGE(8, 0x31),                                                   \
+			HID_RI_LOGICAL_MINIMUM(16, MinAxisVal),                                  \
+			HID_RI_LOGICAL_MAXIMUM(16, MaxAxisVal),                                  \
+			HID_RI_PHYSICAL_MINIMUM(16, MinPhysicalVal),                             \
+			HID_RI_PHYSICAL_MAXIMUM(16, MaxPhysicalVal),                             \
+			HID_RI_REPORT_COUNT(8, 0x02),                                            \
+			HID_RI_REPORT_SIZE(8, (((MinAxisVal >= -0xFF) && (MaxAxisVal <= 0xFF)) ? 8 : 16)), \
+			HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),     \
+		HID_RI_END_COLLECTION(0),                                                    \
+		HID_RI_USAGE_PAGE(8, 0x09),                                                  \
+		HID_RI_USAGE_MINIMUM(8, 0x01),                                               \
+		HID_RI_USAGE_MAXIMUM(8, Buttons),                                            \
+		HID_RI_LOGICAL_MINIMUM(8, 0x00),                                             \
+		HID_RI_LOGICAL_MAXIMUM(8, 0x01),                                             \
+		HID_RI_REPORT_SIZE(8, 0x01),                                                 \
+		HID_RI_REPORT_COUNT(8, Buttons),                                             \
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),         \
+		HID_RI_REPORT_SIZE(8, ((Buttons % 8) ? (8 - (Buttons % 8)) : 0)),            \
+		HID_RI_REPORT_COUNT(8, 0x01),                                                \
+		HID_RI_INPUT(8, HID_IOF_CONSTANT),                                           \
+	HID_RI_END_COLLECTION(0)
+
+#define HID_DESCRIPTOR_MOUSE(MinAxisVal, MaxAxisVal, MinPhysicalVal, MaxPhysicalVal, Buttons, AbsoluteCoords) \
+	HID_RI_USAGE_PAGE(8, 0x01),                                                      \
+	HID_RI_USAGE(8, 0x02),                                                           \
+	HID_RI_COLLECTION(8, 0x01),                                                      \
+		HID_RI_USAGE(8, 0x01),                                                       \
+		HID_RI_COLLECTION(8, 0x00),                                                  \
+			HID_RI_USAGE_PAGE(8, 0x09),                                              \
+			HID_RI_USAGE_MINIMUM(8, 0x01),                                           \
+			HID_RI_USAGE_MAXIMUM(8, Buttons),                                        \
+			HID_RI_LOGICAL_MINIMUM(8, 0x00),                                         \
+			HID_RI_LOGICAL_MAXIMUM(8, 0x01),                                         \
+			HID_RI_REPORT_COUNT(8, Buttons),                                         \
+			HID_RI_REPORT_SIZE(8, 0x01),                                             \
+			HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),     \
+			HID_RI_REPORT_COUNT(8, 0x01),                                            \
+			HID_RI_REPORT_SIZE(8, ((Buttons % 8) ? (8 - (Buttons % 8)) : 0)),        \
+			HID_RI_INPUT(8, HID_IOF_CONSTANT),                                       \
+			HID_RI_USAGE_PAGE(8, 0x01),                                              \
+			HID_RI_USAGE(8, 0x30),                                                   \
+			HID_RI_USAGE(8, 0x31),                                                   \
+			HID_RI_LOGICAL_MINIMUM(16, MinAxisVal),                                  \
+			HID_RI_LOGICAL_MAXIMUM(16, MaxAxisVal),                                  \
+			HID_RI_PHYSICAL_MINIMUM(16, MinPhysicalVal),                             \
+			HID_RI_PHYSICAL_MAXIMUM(16, MaxPhysicalVal),                             \
+			HID_RI_REPORT_COUNT(8, 0x02),                                            \
+			HID_RI_REPORT_SIZE(8, (((MinAxisVal >= -0xFF) && (MaxAxisVal <= 0xFF)) ? 8 : 16)), \
+			HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE |                        \
+			                (AbsoluteCoords ? HID_IOF_ABSOLUTE : HID_IOF_RELATIVE)), \
+		HID_RI_END_COLLECTION(0),                                                    \
+	HID_RI_END_COLLECTION(0)
+
+/* Application callbacks and events */
+uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
+                                    const uint8_t wIndex,
+                                    const void** const DescriptorAddress);
+
+bool CALLBACK_HID_Device_CreateHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+                                         uint8_t* const ReportID,
+                                         const uint8_t ReportType,
+                                         void* ReportData,
+                                         uint16_t* const ReportSize);
+void CALLBACK_HID_Device_ProcessHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+                                          const uint8_t ReportID,
+                                          const uint8_t ReportType,
+                                          const void* ReportData,
+                                          const uint16_t ReportSize);
+
+void EVENT_USB_Device_Connect(void);
+void EVENT_USB_Device_Disconnect(void);
+void EVENT_USB_Device_ConfigurationChanged(void);
+void EVENT_USB_Device_ControlRequest(void);
+void EVENT_USB_Device_StartOfFrame(void);
+void EVENT_USB_Device_Suspend(void);
+void EVENT_USB_Device_WakeUp(void);
+void EVENT_USB_Device_Reset(void);
+
+#endif
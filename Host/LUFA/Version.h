@@ -0,0 +1,12 @@
+/** \file
+ *
+ *  Host replacement for the LUFA version header.
+ */
+
+#ifndef _HOST_LUFA_VERSION_H_
+#define _HOST_LUFA_VERSION_H_
+
+#define LUFA_VERSION_INTEGER  0x110528
+#define LUFA_VERSION_STRING   "110528"
+
+#endif
@@ -0,0 +1,47 @@
+/** \file
+ *
+ *  Host replacement for <avr/eeprom.h>. EEMEM variables are ordinary memory on the host, which
+ *  starts out zeroed rather than erased. Each byte write keeps the EEPROM busy for the 3.4ms an
+ *  ATmega32U4 EEPROM write takes, in simulated time.
+ */
+
+#ifndef _HOST_AVR_EEPROM_H_
+#define _HOST_AVR_EEPROM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+
+/** Simulated cycle count at which the EEPROM write in progress completes, defined in HostIO.c. */
+extern uint64_t Host_EEPROMReadyCycles;
+extern uint64_t Host_Cycles;
+
+#define HOST_EEPROM_WRITE_CYCLES  ((uint64_t)F_CPU * 34 / 10000)
+
+static inline bool eeprom_is_ready(void)
+{
+	return (Host_Cycles >= Host_EEPROMReadyCycles);
+}
+
+static inline uint8_t eeprom_read_byte(const uint8_t* Address)
+{
+	return *Address;
+}
+
+static inline void eeprom_read_block(void* Destination, const void* Source, size_t Length)
+{
+	memcpy(Destination, Source, Length);
+}
+
+static inline void eeprom_update_byte(uint8_t* Address, uint8_t Value)
+{
+	if (*Address == Value)
+		return;
+
+	*Address = Value;
+	Host_EEPROMReadyCycles = (Host_Cycles + HOST_EEPROM_WRITE_CYCLES);
+}
+
+#endif
@@ -0,0 +1,18 @@
+/** \file
+ *
+ *  Host replacement for <avr/interrupt.h>. Interrupt service routines become plain functions named
+ *  after their vector, which the simulator in HostIO.c calls when the matching flag and enable bits
+ *  are set and the global interrupt flag in SREG is set.
+ */
+
+#ifndef _HOST_AVR_INTERRUPT_H_
+#define _HOST_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define ISR(vector, ...)  void vector(void); void vector(void)
+
+#define sei()  do { SREG |=  (1 << SREG_I); } while (0)
+#define cli()  do { SREG &= ~(1 << SREG_I); } while (0)
+
+#endif
@@ -0,0 +1,165 @@
+/** \file
+ *
+ *  Host replacement for the avr-libc I/O register definitions. Every register the firmware touches
+ *  is a plain variable, defined in HostIO.c, that the host harness can inspect and inject values into.
+ */
+
+#ifndef _HOST_AVR_IO_H_
+#define _HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+#include <avr/sfr_defs.h>
+
+/** 8-bit registers of the ATmega32U4 used by the firmware. */
+#define HOST_REGISTERS_8(X)                                          \
+	X(SREG)   X(MCUSR)  X(SMCR)   X(CLKPR)  X(GPIOR0) X(WDTCSR)     \
+	X(PINB)   X(DDRB)   X(PORTB)                                     \
+	X(PINC)   X(DDRC)   X(PORTC)                                     \
+	X(PIND)   X(DDRD)   X(PORTD)                                     \
+	X(PINE)   X(DDRE)   X(PORTE)                                     \
+	X(PINF)   X(DDRF)   X(PORTF)                                     \
+	X(EICRA)  X(EICRB)  X(EIMSK)  X(EIFR)                            \
+	X(PCICR)  X(PCIFR)  X(PCMSK0)                                    \
+	X(TCCR1A) X(TCCR1B) X(TCCR1C) X(TIMSK1) X(TIFR1)                 \
+	X(ADMUX)  X(ADCSRA) X(ADCSRB) X(DIDR0)  X(DIDR2)                 \
+	X(PRR0)   X(PRR1)   X(ACSR)
+
+/** 16-bit registers of the ATmega32U4 used by the firmware. */
+#define HOST_REGISTERS_16(X)                                         \
+	X(TCNT1)  X(OCR1A)  X(OCR1B)  X(OCR1C)  X(ICR1)                 \
+	X(ADC)
+
+#define HOST_DECLARE_REGISTER_8(Reg)   extern volatile uint8_t Reg;
+#define HOST_DECLARE_REGISTER_16(Reg)  extern volatile uint16_t Reg;
+
+HOST_REGISTERS_8(HOST_DECLARE_REGISTER_8)
+HOST_REGISTERS_16(HOST_DECLARE_REGISTER_16)
+
+/* SREG */
+#define SREG_I    7
+
+/* MCUSR */
+#define PORF      0
+#define EXTRF     1
+#define BORF      2
+#define WDRF      3
+#define JTRF      4
+
+/* WDTCSR */
+#define WDP0      0
+#define WDP1      1
+#define WDP2      2
+#define WDE       3
+#define WDCE      4
+#define WDP3      5
+#define WDIE      6
+#define WDIF      7
+
+/* PRR0 */
+#define PRADC     0
+#define PRSPI     2
+#define PRTIM1    3
+#define PRTIM0    5
+#define PRTWI     7
+
+/* PRR1 */
+#define PRUSART1  0
+#define PRTIM3    3
+#define PRTIM4    4
+#define PRUSB     7
+
+/* ACSR */
+#define ACD       7
+
+/* CLKPR */
+#define CLKPS0    0
+#define CLKPS1    1
+#define CLKPS2    2
+#define CLKPS3    3
+#define CLKPCE    7
+
+/* EICRA */
+#define ISC00     0
+#define ISC01     1
+#define ISC10     2
+#define ISC11     3
+#define ISC20     4
+#define ISC21     5
+#define ISC30     6
+#define ISC31     7
+
+/* EIMSK / EIFR */
+#define INT0      0
+#define INT1      1
+#define INT2      2
+#define INT3      3
+#define INT6      6
+#define INTF0     0
+#define INTF1     1
+#define INTF2     2
+#define INTF3     3
+#define INTF6     6
+
+/* PCICR / PCIFR */
+#define PCIE0     0
+#define PCIF0     0
+
+/* TCCR1B */
+#define CS10      0
+#define CS11      1
+#define CS12      2
+#define WGM12     3
+#define WGM13     4
+
+/* TIMSK1 / TIFR1 */
+#define TOIE1     0
+#define OCIE1A    1
+#define OCIE1B    2
+#define OCIE1C    3
+#define TOV1      0
+#define OCF1A     1
+#define OCF1B     2
+#define OCF1C     3
+
+/* Port F */
+#define PF0       0
+#define PF1       1
+
+/* ADMUX */
+#define MUX0      0
+#define MUX1      1
+#define MUX2      2
+#define MUX3      3
+#define MUX4      4
+#define ADLAR     5
+#define REFS0     6
+#define REFS1     7
+
+/* ADCSRA */
+#define ADPS0     0
+#define ADPS1     1
+#define ADPS2     2
+#define ADIE      3
+#define ADIF      4
+#define ADATE     5
+#define ADSC      6
+#define ADEN      7
+
+/* ADCSRB */
+#define ADTS0     0
+#define ADTS1     1
+#define ADTS2     2
+#define ADTS3     3
+#define MUX5      5
+#define ADHSM     7
+
+/* DIDR0 */
+#define ADC0D     0
+#define ADC1D     1
+#define ADC4D     4
+#define ADC5D     5
+#define ADC6D     6
+#define ADC7D     7
+
+#endif
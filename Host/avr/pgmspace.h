@@ -0,0 +1,22 @@
+/** \file
+ *
+ *  Host replacement for <avr/pgmspace.h>, program memory is ordinary memory on the host.
+ */
+
+#ifndef _HOST_AVR_PGMSPACE_H_
+#define _HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)                 (s)
+
+#define pgm_read_byte(addr)     (*(const uint8_t*)(addr))
+#define pgm_read_word(addr)     (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr)    (*(const uint32_t*)(addr))
+#define pgm_read_ptr(addr)      (*(void* const*)(addr))
+
+#define memcpy_P(dst, src, n)   memcpy((dst), (src), (n))
+
+#endif
@@ -0,0 +1,20 @@
+/** \file
+ *
+ *  Host replacement for <avr/power.h>.
+ */
+
+#ifndef _HOST_AVR_POWER_H_
+#define _HOST_AVR_POWER_H_
+
+#include <avr/io.h>
+
+typedef enum {
+	clock_div_1 = 0,
+	clock_div_2 = 1,
+	clock_div_4 = 2,
+	clock_div_8 = 3,
+} clock_div_t;
+
+#define clock_prescale_set(x)  do { CLKPR = (x); } while (0)
+
+#endif
@@ -0,0 +1,13 @@
+/** \file
+ *
+ *  Host replacement for <avr/sfr_defs.h>.
+ */
+
+#ifndef _HOST_AVR_SFR_DEFS_H_
+#define _HOST_AVR_SFR_DEFS_H_
+
+#define _BV(bit)                (1 << (bit))
+#define bit_is_set(sfr, bit)    ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit)  (!((sfr) & _BV(bit)))
+
+#endif
@@ -0,0 +1,33 @@
+/** \file
+ *
+ *  Host replacement for <avr/sleep.h>. Sleeping hands the simulated time over to the harness
+ *  until the next interrupt or USB event wakes the CPU.
+ */
+
+#ifndef _HOST_AVR_SLEEP_H_
+#define _HOST_AVR_SLEEP_H_
+
+#include <avr/io.h>
+
+/* SMCR */
+#define SE                    0
+#define SM0                   1
+#define SM1                   2
+#define SM2                   3
+
+#define SLEEP_MODE_IDLE       (0)
+#define SLEEP_MODE_ADC        (1 << SM0)
+#define SLEEP_MODE_PWR_DOWN   (1 << SM1)
+#define SLEEP_MODE_PWR_SAVE   ((1 << SM0) | (1 << SM1))
+#define SLEEP_MODE_STANDBY    ((1 << SM1) | (1 << SM2))
+#define SLEEP_MODE_EXT_STANDBY ((1 << SM0) | (1 << SM1) | (1 << SM2))
+
+#define set_sleep_mode(mode)  do { SMCR = ((SMCR & ~((1 << SM0) | (1 << SM1) | (1 << SM2))) | (mode)); } while (0)
+#define sleep_enable()        do { SMCR |=  (1 << SE); } while (0)
+#define sleep_disable()       do { SMCR &= ~(1 << SE); } while (0)
+#define sleep_cpu()           Host_Sleep()
+
+/** Provided by the harness, returns once an interrupt has been serviced. */
+void Host_Sleep(void);
+
+#endif
@@ -0,0 +1,16 @@
+/** \file
+ *
+ *  Host replacement for <avr/wdt.h>. The simulated watchdog only has the interrupt mode, which
+ *  the firmware sets up through WDTCSR, it never resets the device.
+ */
+
+#ifndef _HOST_AVR_WDT_H_
+#define _HOST_AVR_WDT_H_
+
+#include <avr/io.h>
+
+#define wdt_reset()      do { } while (0)
+#define wdt_disable()    do { WDTCSR = 0; } while (0)
+#define wdt_enable(t)    do { (void)(t); } while (0)
+
+#endif
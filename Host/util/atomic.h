@@ -0,0 +1,32 @@
+/** \file
+ *
+ *  Host replacement for <util/atomic.h>. The simulator only delivers interrupts between main loop
+ *  iterations, so atomic blocks just have to keep the global interrupt flag consistent, and bring the
+ *  interrupt flag registers up to date for the firmware reading them inside the block.
+ */
+
+#ifndef _HOST_UTIL_ATOMIC_H_
+#define _HOST_UTIL_ATOMIC_H_
+
+#include <avr/io.h>
+
+void Host_SyncFlags(void);
+
+static inline uint8_t __host_iCliRetVal(void)
+{
+	Host_SyncFlags();
+	SREG &= ~(1 << SREG_I);
+	return 1;
+}
+
+static inline void __host_iRestore(const uint8_t* const __s)
+{
+	SREG = *__s;
+}
+
+#define ATOMIC_RESTORESTATE  uint8_t sreg_save __attribute__((__cleanup__(__host_iRestore))) = SREG
+#define ATOMIC_FORCEON       uint8_t sreg_save __attribute__((__cleanup__(__host_iRestore))) = (1 << SREG_I)
+
+#define ATOMIC_BLOCK(type)   for (type, __ToDo = __host_iCliRetVal(); __ToDo; __ToDo = 0)
+
+#endif
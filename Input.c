@@ -0,0 +1,363 @@
+/** \file
+ *
+ *  Interrupt driven input sampling. Every transition of the joystick (Port D0-D3) and the buttons
+ *  (Port F5-F7) is debounced in a fixed rate Timer1 compare interrupt, every transition of the dial
+ *  (Port B0-B6, PCINT0-PCINT6) is captured as it happens. The transitions are stored with their
+ *  Timer1 timestamp in ring buffers, which the report builders drain from the main loop. The
+ *  joystick edge interrupts (INT0-INT3) only timestamp the first edge of a debounced transition,
+ *  Port F has no pin change interrupts so button edges are timestamped at the first sample.
+ *
+ *  With INPUT_PLAYERS=2 the inputs of player 2 are sampled with player 1's into one wider state,
+ *  so a single debouncer run and a single queue serve both. Player 2's pins have no edge
+ *  interrupts, its edges are timestamped at the first sample like the buttons.
+ *
+ *  Once per USB frame, timed against the Start Of Frame events, the Timer1 compare B interrupt
+ *  snapshots all three ports and cuts both queues, as late as possible before the next frame. In
+ *  the ANALOG_AXES build it also copies the last complete round of the analog axes.
+ */
+
+#include "Input.h"
+
+/** Joystick and buttons transitions, see \ref InputState_t for the state layout. */
+InputQueue_t Input_DigitalQueue;
+
+/** Dial transitions, the state is the raw dial position. */
+InputQueue_t Input_DialQueue;
+
+/** Number of transitions merged into the newest queued event because a queue was full. */
+volatile uint8_t Input_Overflows;
+
+/** Longest run of the debouncer interrupt seen so far, in Timer1 ticks. */
+volatile uint8_t Input_DebounceTicksMax;
+
+/** Measured USB frame period in Timer1 ticks, tracked against the Start Of Frame events. */
+volatile uint16_t Input_FramePeriod = INPUT_FRAME_TICKS;
+
+/** Number of snapshots replaced by the next one before the main loop took them. */
+volatile uint16_t Input_FramesMissed;
+
+/** Latest port snapshot, valid while Input_SnapshotPending is set. */
+InputSnapshot_t  Input_Snapshot;
+volatile bool    Input_SnapshotPending;
+
+/** Interval in Timer1 ticks at which the debouncer samples the digital inputs. */
+static uint16_t DebounceTicks = ((INPUT_DEBOUNCE_US / 4) * INPUT_TICKS_PER_US);
+
+/** Number of frames per snapshot, and the frames left until the next one. */
+static uint8_t SnapshotInterval = 1;
+static uint8_t FramesToSnapshot;
+
+/** Frame period with four fractional bits, and the Timer1 count of the last Start Of Frame. */
+static uint16_t FramePeriodFiltered = (INPUT_FRAME_TICKS << 4);
+static uint16_t LastFrameTimestamp;
+
+/** Debounced digital state and the two bits of each input's vertical counter, only accessed from
+ *  interrupt context.
+ */
+static InputState_t DebouncedState;
+static InputState_t CounterLow;
+static InputState_t CounterHigh;
+
+/** Timestamp of the first edge of a digital transition in progress, if EdgePending is set. */
+static uint16_t EdgeTimestamp;
+static bool     EdgePending;
+
+/** Last dial state pushed to the dial queue, only accessed from interrupt context. */
+static uint8_t LastDialState;
+
+/** Appends an event to the given queue. When the queue is full the newest queued event is updated
+ *  instead, so that the consumer always ends up with the current state. Must be called with
+ *  interrupts disabled.
+ */
+static void PushEvent(InputQueue_t* const Queue,
+                      const uint16_t Timestamp,
+                      const InputState_t State)
+{
+	uint8_t Head = Queue->Head;
+
+	if ((uint8_t)(Head - Queue->Tail) == INPUT_QUEUE_SIZE) {
+		Queue->Events[(Head - 1) & (INPUT_QUEUE_SIZE - 1)].State = State;
+		Input_Overflows++;
+		return;
+	}
+
+	Queue->Events[Head & (INPUT_QUEUE_SIZE - 1)] = (InputEvent_t){
+		.Timestamp = Timestamp,
+		.State     = State
+	};
+	Queue->Head = Head + 1;
+}
+
+static inline InputState_t ReadDigitalState(void)
+{
+	InputState_t State = (Joystick_GetStatus() | Buttons_GetStatus());
+
+#if (INPUT_PLAYERS > 1)
+	State |= ((InputState_t)(Joystick_GetPlayerStatus(1) | Buttons_GetPlayerStatus(1)) << 8);
+#endif
+
+	return State;
+}
+
+/** Runs one step of the debouncer over all digital inputs in parallel. Each input has a 2-bit
+ *  vertical counter, spread over CounterLow and CounterHigh, that is reset while the input matches
+ *  its debounced state and otherwise counts the samples in which it differs. The debounced state
+ *  of an input toggles when its counter rolls over, after four consecutive differing samples.
+ *
+ *  \return Mask of the inputs whose debounced state changed
+ */
+static inline InputState_t Debounce(const InputState_t Sample)
+{
+	InputState_t Changed = (DebouncedState ^ Sample);
+
+	CounterLow  = ~(CounterLow & Changed);
+	CounterHigh = (CounterLow ^ (CounterHigh & Changed));
+	Changed    &= (CounterLow & CounterHigh);
+
+	DebouncedState ^= Changed;
+
+	return Changed;
+}
+
+static inline void CaptureEdge(void)
+{
+	if (!EdgePending) {
+		EdgeTimestamp = Input_GetTimestamp();
+		EdgePending   = true;
+	}
+}
+
+/** Starts Timer1 free-running at F_CPU/8, the time base of the input timestamps. The boot timing
+ *  starts it at the top of main(), long before the inputs are initialized.
+ */
+void Input_InitTimer(void)
+{
+	TCCR1A = 0;
+	TCCR1B = (1 << CS11);
+}
+
+/** Configures the input interrupts. The board drivers must have been initialized first so that the
+ *  pull-ups are enabled, and the Timer1 time base started with \ref Input_InitTimer(). Must be
+ *  called before interrupts are enabled.
+ */
+void Input_Init(void)
+{
+	DebouncedState = ReadDigitalState();
+	CounterLow     = (InputState_t)~0;
+	CounterHigh    = (InputState_t)~0;
+	LastDialState  = Joystick_GetDial();
+
+	/* The report builders start from all inputs released, the inputs held from power-on are their
+	 * first transition */
+	PushEvent(&Input_DigitalQueue, Input_GetTimestamp(), DebouncedState);
+
+	/* Compare A runs the debouncer */
+	OCR1A   = TCNT1 + DebounceTicks;
+	TIFR1   = (1 << OCF1A);
+	TIMSK1 |= (1 << OCIE1A);
+
+	/* Joystick: INT0-INT3 on any logical change */
+	EICRA  = (1 << ISC00) | (1 << ISC10) | (1 << ISC20) | (1 << ISC30);
+	EIFR   = (1 << INTF0) | (1 << INTF1) | (1 << INTF2) | (1 << INTF3);
+	EIMSK  = (1 << INT0) | (1 << INT1) | (1 << INT2) | (1 << INT3);
+
+	/* Dial: PCINT0-PCINT6 */
+	PCMSK0 = DIAL_MASK;
+	PCIFR  = (1 << PCIF0);
+	PCICR  = (1 << PCIE0);
+}
+
+/** Returns whether the digital inputs read their debounced state, with no transition in progress.
+ *  The inputs without edge interrupts are sampled here, so that a change can be seen while the
+ *  debouncer is stopped.
+ */
+bool Input_IsSettled(void)
+{
+	bool Settled;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Settled = (!EdgePending && (ReadDigitalState() == DebouncedState));
+	}
+
+	return Settled;
+}
+
+/** Schedules the port snapshot of the next frame, must be called from the Start Of Frame event.
+ *  Timer1 measures the host's frame period, so that the snapshot lands \ref INPUT_SNAPSHOT_LEAD_US
+ *  before the next Start Of Frame regardless of the tolerance of either clock.
+ */
+void Input_StartOfFrame(void)
+{
+	uint16_t Now    = Input_GetTimestamp();
+	uint16_t Period = (Now - LastFrameTimestamp);
+
+	LastFrameTimestamp = Now;
+
+	/* Periods away from nominal by more than 1/64 are missed or resumed frames, not clock drift */
+	if ((Period > (INPUT_FRAME_TICKS - (INPUT_FRAME_TICKS / 64))) &&
+	    (Period < (INPUT_FRAME_TICKS + (INPUT_FRAME_TICKS / 64))))
+	{
+		FramePeriodFiltered += (Period - (FramePeriodFiltered >> 4));
+		Input_FramePeriod    = (FramePeriodFiltered >> 4);
+	}
+
+	if (FramesToSnapshot > 1) {
+		FramesToSnapshot--;
+		return;
+	}
+
+	FramesToSnapshot = SnapshotInterval;
+
+	OCR1B   = (Now + Input_FramePeriod - INPUT_SNAPSHOT_LEAD_TICKS);
+	TIFR1   = (1 << OCF1B);
+	TIMSK1 |= (1 << OCIE1B);
+}
+
+/** Sets the time a digital input must be stable before a change is reported, from the next
+ *  debouncer run on.
+ *
+ *  \param[in] Microseconds  Debounce window, the inputs are sampled four times within it
+ */
+void Input_SetDebounce(const uint16_t Microseconds)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		DebounceTicks = ((Microseconds / 4) * INPUT_TICKS_PER_US);
+	}
+}
+
+/** Sets the number of frames per input snapshot, so that the changes within that many frames are
+ *  reported together.
+ *
+ *  \param[in] Frames  Frames per snapshot, at least one
+ */
+void Input_SetSnapshotInterval(const uint8_t Frames)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		SnapshotInterval = Frames;
+	}
+}
+
+ISR(INT0_vect)
+{
+	PROFILE_ENTER(PROFILE_JoystickEdge);
+	CaptureEdge();
+	PROFILE_LEAVE(PROFILE_JoystickEdge);
+}
+
+ISR(INT1_vect)
+{
+	PROFILE_ENTER(PROFILE_JoystickEdge);
+	CaptureEdge();
+	PROFILE_LEAVE(PROFILE_JoystickEdge);
+}
+
+ISR(INT2_vect)
+{
+	PROFILE_ENTER(PROFILE_JoystickEdge);
+	CaptureEdge();
+	PROFILE_LEAVE(PROFILE_JoystickEdge);
+}
+
+ISR(INT3_vect)
+{
+	PROFILE_ENTER(PROFILE_JoystickEdge);
+	CaptureEdge();
+	PROFILE_LEAVE(PROFILE_JoystickEdge);
+}
+
+ISR(PCINT0_vect)
+{
+	uint16_t Timestamp;
+	uint8_t  State;
+
+	PROFILE_ENTER(PROFILE_DialEdge);
+
+	Timestamp = Input_GetTimestamp();
+	State     = Joystick_GetDial();
+
+	if (State != LastDialState) {
+		LastDialState = State;
+		PushEvent(&Input_DialQueue, Timestamp, State);
+	}
+
+	PROFILE_LEAVE(PROFILE_DialEdge);
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+	uint16_t     Now;
+	InputState_t Sample;
+	uint8_t      Ticks;
+
+	PROFILE_ENTER(PROFILE_Debounce);
+
+	Now    = Input_GetTimestamp();
+	Sample = ReadDigitalState();
+
+	OCR1A += DebounceTicks;
+
+	if (Debounce(Sample)) {
+		PushEvent(&Input_DigitalQueue, (EdgePending ? EdgeTimestamp : Now), DebouncedState);
+		EdgePending = false;
+	}
+
+	/* Forget edges of bounces that settled back to the debounced state */
+	if (Sample == DebouncedState)
+		EdgePending = false;
+	else
+		CaptureEdge();
+
+	Ticks = (Input_GetTimestamp() - Now);
+	if (Ticks > Input_DebounceTicksMax)
+		Input_DebounceTicksMax = Ticks;
+
+	PROFILE_LEAVE(PROFILE_Debounce);
+}
+
+static void TakeSnapshot(void)
+{
+	/* Read the ports back to back first, the queue heads cannot move while interrupts are disabled */
+	Input_Snapshot.PinD        = PIND;
+	Input_Snapshot.PinB        = PINB;
+	Input_Snapshot.PinF        = PINF;
+	Input_Snapshot.Timestamp   = Input_GetTimestamp();
+	Input_Snapshot.DigitalHead = Input_DigitalQueue.Head;
+	Input_Snapshot.DialHead    = Input_DialQueue.Head;
+#if defined(EDGE_TIMESTAMP)
+	Input_Snapshot.FrameTimestamp = (LastFrameTimestamp + Input_FramePeriod);
+#endif
+#if defined(ANALOG_AXES)
+	Analog_GetAxes(&Input_Snapshot.Axes);
+#endif
+
+	if (Input_SnapshotPending)
+		Input_FramesMissed++;
+
+	Input_SnapshotPending = true;
+}
+
+ISR(TIMER1_COMPB_vect)
+{
+	PROFILE_ENTER(PROFILE_Snapshot);
+
+	TakeSnapshot();
+
+	/* One snapshot per frame, the next Start Of Frame rearms the compare */
+	TIMSK1 &= ~(1 << OCIE1B);
+
+	PROFILE_LEAVE(PROFILE_Snapshot);
+}
+
+/** Snapshots the ports at once instead of before the next frame, so that the reports built from it
+ *  are committed in time for the host's first poll after the device is configured.
+ */
+void Input_RequestSnapshot(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		TakeSnapshot();
+	}
+}
@@ -0,0 +1,215 @@
+/** \file
+ *
+ *  Header file for Input.c.
+ */
+
+#ifndef _INPUT_H_
+#define _INPUT_H_
+
+/* Includes: */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <stdbool.h>
+
+#include <LUFA/Common/Common.h>
+#include <LUFA/Drivers/Board/Joystick.h>
+#include <LUFA/Drivers/Board/Buttons.h>
+
+#include "Analog.h"
+#include "Profile.h"
+
+/* Macros: */
+/** Number of Timer1 ticks per microsecond, Timer1 free-runs from the system clock divided by 8. */
+#define INPUT_TICKS_PER_US       (F_CPU / 8000000UL)
+
+/** Default time in microseconds a digital input must be stable before a change is reported, the
+ *  inputs are sampled four times within this window. Set at runtime by \ref Input_SetDebounce().
+ */
+#if !defined(INPUT_DEBOUNCE_US)
+#define INPUT_DEBOUNCE_US        2000
+#endif
+
+/** Nominal USB frame period in Timer1 ticks, the measured period is kept in \ref Input_FramePeriod. */
+#define INPUT_FRAME_TICKS        (1000 * INPUT_TICKS_PER_US)
+
+/** Time in microseconds before the predicted next Start Of Frame at which the ports are snapshotted.
+ *  It must cover the snapshot interrupt, the report builders and the endpoint write, so that the
+ *  report is committed before the host's IN token early in the next frame.
+ */
+#if !defined(INPUT_SNAPSHOT_LEAD_US)
+#define INPUT_SNAPSHOT_LEAD_US   100
+#endif
+
+/** Lead time of the snapshot in Timer1 ticks, see \ref INPUT_SNAPSHOT_LEAD_US. */
+#define INPUT_SNAPSHOT_LEAD_TICKS (INPUT_SNAPSHOT_LEAD_US * INPUT_TICKS_PER_US)
+
+/** Number of events each input queue can hold, must be a power of two. */
+#define INPUT_QUEUE_SIZE         16
+
+/** Number of players, 1 or 2. Each has a joystick and three buttons on the pins the board drivers map
+ *  for it, the dial belongs to player 1.
+ */
+#if !defined(INPUT_PLAYERS)
+#define INPUT_PLAYERS            1
+#endif
+
+#if (INPUT_PLAYERS < 1) || (INPUT_PLAYERS > 2)
+	#error INPUT_PLAYERS must be 1 or 2, the board has pins for two players.
+#endif
+
+#if (INPUT_PLAYERS > 1) && defined(ANALOG_AXES)
+	#error INPUT_PLAYERS=2 takes Port F0 and F1 for the buttons of player 2, they cannot be the ANALOG_AXES inputs.
+#endif
+
+/** Mask of the digital input state bits of a player, joystick directions in the low nibble and the
+ *  buttons in the high bits as returned by \ref Joystick_GetPlayerStatus() and
+ *  \ref Buttons_GetPlayerStatus().
+ */
+#define INPUT_DIGITAL_MASK       (JOY_UP | JOY_DOWN | JOY_LEFT | JOY_RIGHT | BUTTONS_MASK)
+
+/** Returns the \ref INPUT_DIGITAL_MASK state bits of a player from an \ref InputState_t. */
+#define INPUT_PLAYER_STATE(State, Player)  ((uint8_t)((State) >> (8 * (Player))))
+
+/* Type Defines: */
+/** Digital input state of all players, a byte of \ref INPUT_DIGITAL_MASK bits per player. The
+ *  debouncer and the event queue handle the players together, in a single word.
+ */
+#if (INPUT_PLAYERS > 1)
+typedef uint16_t InputState_t;
+#else
+typedef uint8_t  InputState_t;
+#endif
+
+/** Single input transition, as captured by one of the input interrupts. */
+typedef struct {
+	uint16_t     Timestamp; /**< Timer1 count of the first edge of the transition */
+	InputState_t State;     /**< Input state after the edge */
+} InputEvent_t;
+
+/** Lock-free single producer (interrupt context), single consumer (main loop) event ring buffer. */
+typedef struct {
+	InputEvent_t     Events[INPUT_QUEUE_SIZE];
+	volatile uint8_t Head; /**< Free-running write index, only modified by the producer */
+	volatile uint8_t Tail; /**< Free-running read index, only modified by the consumer */
+} InputQueue_t;
+
+/** Once per frame snapshot of the input ports, taken back to back in the Timer1 compare B interrupt.
+ *  The queue heads cut both event queues at the same instant, the report builders only consume the
+ *  events queued before the snapshot so that the dial, joystick and buttons they report are consistent.
+ */
+typedef struct {
+	uint16_t Timestamp;   /**< Timer1 count when the ports were read */
+#if defined(EDGE_TIMESTAMP)
+	uint16_t FrameTimestamp; /**< Timer1 count of the Start Of Frame the snapshot was taken for, predicted
+	                              from the last one */
+#endif
+	uint8_t  PinD;        /**< Raw joystick port */
+	uint8_t  PinB;        /**< Raw dial port */
+	uint8_t  PinF;        /**< Raw buttons port */
+	uint8_t  DigitalHead; /**< Head of \ref Input_DigitalQueue at the snapshot */
+	uint8_t  DialHead;    /**< Head of \ref Input_DialQueue at the snapshot */
+#if defined(ANALOG_AXES)
+	AnalogAxes_t Axes;    /**< Analog axes of the last complete ADC round */
+#endif
+} InputSnapshot_t;
+
+/* External Variables: */
+extern InputQueue_t      Input_DigitalQueue;
+extern InputQueue_t      Input_DialQueue;
+extern volatile uint8_t  Input_Overflows;
+extern volatile uint8_t  Input_DebounceTicksMax;
+extern volatile uint16_t Input_FramePeriod;
+extern volatile uint16_t Input_FramesMissed;
+extern volatile bool     Input_SnapshotPending;
+extern InputSnapshot_t   Input_Snapshot;
+
+/* Inline Functions: */
+/** Returns the current Timer1 count, used as the timestamp base of all input events. */
+static inline uint16_t Input_GetTimestamp(void) ATTR_WARN_UNUSED_RESULT;
+static inline uint16_t Input_GetTimestamp(void)
+{
+	return TCNT1;
+}
+
+/** Removes the oldest event from the given queue, if it was queued before the given head.
+ *
+ *  \param[in,out] Queue  Queue to read from
+ *  \param[in]     Head   Queue head to stop at, usually cut by an \ref InputSnapshot_t
+ *  \param[out]    Event  Where the removed event is stored
+ *
+ *  \return Boolean true if an event was removed, false if no event was queued before the head
+ */
+static inline bool Input_PopEvent(InputQueue_t* const Queue,
+                                  const uint8_t Head,
+                                  InputEvent_t* const Event)
+{
+	uint8_t Tail = Queue->Tail;
+
+	if (Tail == Head)
+		return false;
+
+	*Event = Queue->Events[Tail & (INPUT_QUEUE_SIZE - 1)];
+	Queue->Tail = Tail + 1;
+
+	return true;
+}
+
+/** Removes the oldest debounced joystick and buttons transition queued before the snapshot, with
+ *  the \ref InputState_t of all players.
+ */
+static inline bool Input_GetDigitalEvent(const InputSnapshot_t* const Snapshot,
+                                         InputEvent_t* const Event)
+{
+	return Input_PopEvent(&Input_DigitalQueue, Snapshot->DigitalHead, Event);
+}
+
+/** Returns true if joystick and buttons transitions queued before the snapshot are left. */
+static inline bool Input_HasDigitalEvent(const InputSnapshot_t* const Snapshot)
+{
+	return (Input_DigitalQueue.Tail != Snapshot->DigitalHead);
+}
+
+/** Removes the oldest dial transition queued before the snapshot, with the raw dial position as state. */
+static inline bool Input_GetDialEvent(const InputSnapshot_t* const Snapshot,
+                                      InputEvent_t* const Event)
+{
+	return Input_PopEvent(&Input_DialQueue, Snapshot->DialHead, Event);
+}
+
+/** Returns the raw dial position at the snapshot, as \ref Joystick_GetDial() would have. */
+static inline uint8_t Input_GetSnapshotDial(const InputSnapshot_t* const Snapshot)
+{
+	return (Snapshot->PinB & DIAL_MASK);
+}
+
+/** Takes the snapshot of the current frame, if one was taken since the last call.
+ *
+ *  \param[out] Snapshot  Where the snapshot is stored
+ *
+ *  \return Boolean true if a new snapshot was taken, false otherwise
+ */
+static inline bool Input_TakeSnapshot(InputSnapshot_t* const Snapshot)
+{
+	if (!Input_SnapshotPending)
+		return false;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		*Snapshot             = Input_Snapshot;
+		Input_SnapshotPending = false;
+	}
+
+	return true;
+}
+
+/* Function Prototypes: */
+void Input_InitTimer(void);
+void Input_Init(void);
+bool Input_IsSettled(void);
+void Input_StartOfFrame(void);
+void Input_RequestSnapshot(void);
+void Input_SetDebounce(const uint16_t Microseconds);
+void Input_SetSnapshotInterval(const uint8_t Frames);
+
+#endif
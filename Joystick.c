@@ -30,48 +30,300 @@
 
 #include "Joystick.h"
 
-static uint8_t PrevJoystickHIDReportBuffer[sizeof(USB_JoystickReport_Data_t)];
-
-USB_ClassInfo_HID_Device_t Mouse_HID_Interface = {
-	.Config =
-	{
-		.InterfaceNumber              = 0,
+#if defined(KEYBOARD_REPORT)
+/** Input masks of the player inputs in the order of their keys in \ref Settings_t::KeyMap. */
+static const uint8_t PROGMEM KeyInputs[SETTINGS_PLAYER_KEYS] = {
+	JOY_UP, JOY_DOWN, JOY_LEFT, JOY_RIGHT, BUTTONS_BUTTON1, BUTTONS_BUTTON2, BUTTONS_BUTTON3,
+};
+#endif
 
-		.ReportINEndpointNumber       = MOUSE_EPNUM,
-		.ReportINEndpointSize         = HID_EPSIZE,
-		.ReportINEndpointDoubleBank   = false,
+#if defined(CYCLE_PROFILE)
+#define HID_INTERFACE_PROFILE_REGION(Name, ...)  [INTERFACE_##Name] = PROFILE_##Name##Report,
 
-		.PrevReportINBufferSize       = sizeof(USB_MouseReport_Data_t),
-	},
+/** Profiling region of the IN report callback of each interface, see Profile.h. */
+static const uint8_t PROGMEM ReportRegions[INTERFACE_COUNT] = {
+	HID_INTERFACES(HID_INTERFACE_PROFILE_REGION)
 };
 
-USB_ClassInfo_HID_Device_t Joystick_HID_Interface = {
-	.Config =
-	{
-		.InterfaceNumber              = 1,
+#define PROFILE_INTERFACE_REPORT(Interface)  pgm_read_byte(&ReportRegions[(Interface)->Config.InterfaceNumber])
+#endif
+
+/** Port snapshot of the current frame, consumed by the report builders. */
+static InputSnapshot_t Snapshot;
+
+/** Timestamp of the oldest input edge carried by the IN report being built, if ReportHasEdge is set. */
+static uint16_t ReportEdgeTimestamp;
+static bool     ReportHasEdge;
+
+/** Set from the configuration or the resume until the joystick report carrying the initial input
+ *  state is built. The USB events run in the USB interrupt with SLEEP_BETWEEN_FRAMES or
+ *  INTERRUPT_CONTROL_ENDPOINT, so it is only taken by TakeInitialReport().
+ */
+static volatile bool InitialReportPending;
+
+/** Outcome of the IN report built by the last callback, recorded in the statistics once the class
+ *  driver has written the report to the endpoint.
+ */
+static bool ReportBuilt;
+static bool ReportSent;
+static bool ReportIsInitial;
+
+/** Set while the class drivers process a control request, whose GET_REPORT requests for input
+ *  reports are served from the last reports sent rather than built from the input queues.
+ */
+static bool InControlRequest;
+
+/** Set when a control request is processed, to tell the USB task's runs that did work from the
+ *  passes in which it only polled the control endpoint.
+ */
+static volatile bool ControlRequestTaken;
+
+#if defined(COMBINED_REPORT)
+typedef USB_ControllerReport_Data_t StateReport_t;
+#elif defined(KEYBOARD_REPORT)
+typedef USB_KeyboardReport_NKRO_Data_t StateReport_t;
+#else
+typedef USB_JoystickReport_Players_t StateReport_t;
+#endif
+
+/** Last input state report sent, the joystick, controller or keyboard report of the build. A report
+ *  is only sent when it differs from this one, when the host's idle period elapsed or when the
+ *  initial state is pending. The class drivers have no previous report buffers, so that the
+ *  feature reports built in the class driver's buffer never take part in the comparison. It is
+ *  also the input report GET_REPORT returns, and is only updated atomically as that may be
+ *  served from the control endpoint interrupt.
+ */
+static StateReport_t LastStateReport;
+
+#if defined(RAW_STREAM)
+/** Set by the Start Of Frame event, cleared when the USB task drains the raw stream. */
+static volatile bool StreamFramePending;
+#endif
+
+/** USB status shown on the LEDs, set by the USB events and applied by the housekeeping task. */
+static volatile uint8_t StatusLEDs = LEDMASK_USB_NOTREADY;
+
+/** Sizes of the statistics, settings, boot timing and task load feature reports, the report ID is
+ *  written by the application. The class driver builds the reports in a buffer of PrevReportINBufferSize
+ *  bytes on its stack, which must be large enough to hold the largest of them.
+ */
+#define STATS_FEATURE_REPORT_SIZE    (1 + sizeof(Stats_Report_t))
+#define SETTINGS_FEATURE_REPORT_SIZE (1 + sizeof(Settings_t))
+#define BOOT_FEATURE_REPORT_SIZE     (1 + sizeof(Boot_Report_t))
+#define TASKS_FEATURE_REPORT_SIZE    (1 + sizeof(Scheduler_Report_t))
+#define FEATURE_REPORT_SIZE          MAX(MAX(STATS_FEATURE_REPORT_SIZE, SETTINGS_FEATURE_REPORT_SIZE), \
+                                         MAX(BOOT_FEATURE_REPORT_SIZE, TASKS_FEATURE_REPORT_SIZE))
+
+/** Class driver instance of an entry of \ref HID_INTERFACES. The application decides which IN
+ *  reports are sent, see \ref LastStateReport, the buffer size only sizes the class driver's report
+ *  buffer for the IN report and the feature reports of the interface carrying them.
+ */
+#define HID_INTERFACE_INFO(Name, EndpointNumber, EndpointSize, ReportType, FeatureReports)                   \
+	USB_ClassInfo_HID_Device_t Name##_HID_Interface = {                                                      \
+		.Config =                                                                                            \
+		{                                                                                                    \
+			.InterfaceNumber              = INTERFACE_##Name,                                                \
+                                                                                                             \
+			.ReportINEndpointNumber       = (EndpointNumber),                                                \
+			.ReportINEndpointSize         = (EndpointSize),                                                  \
+			.ReportINEndpointDoubleBank   = true,                                                            \
+                                                                                                             \
+			.PrevReportINBuffer           = NULL,                                                            \
+			.PrevReportINBufferSize       = MAX(sizeof(ReportType), ((FeatureReports) * FEATURE_REPORT_SIZE)), \
+		},                                                                                                   \
+	};
+
+HID_INTERFACES(HID_INTERFACE_INFO)
+
+#define HID_INTERFACE_FEATURE_BIT(Name, EndpointNumber, EndpointSize, ReportType, FeatureReports) \
+	| ((FeatureReports) << INTERFACE_##Name)
+
+/** Interface numbers of the interfaces carrying the feature reports, as a bit mask. */
+#define FEATURE_INTERFACES           (0 HID_INTERFACES(HID_INTERFACE_FEATURE_BIT))
+
+#define HID_INTERFACE_USB_TASK(Name, ...)           RunHIDTask(&Name##_HID_Interface);
+#define HID_INTERFACE_CONFIGURE_ENDPOINTS(Name, ...) ConfigSuccess &= HID_Device_ConfigureEndpoints(&Name##_HID_Interface);
+#define HID_INTERFACE_CONTROL_REQUEST(Name, ...)    HID_Device_ProcessControlRequest(&Name##_HID_Interface);
+#define HID_INTERFACE_MILLISECOND(Name, ...)        HID_Device_MillisecondElapsed(&Name##_HID_Interface);
+
+/** Runs the class driver of an interface, which builds and writes an IN report if its endpoint has
+ *  a free bank, then records the report in the statistics. The latency is measured here, once the
+ *  report is in the endpoint bank.
+ */
+static void RunHIDTask(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo)
+{
+	ReportBuilt = false;
+
+	HID_Device_USBTask(HIDInterfaceInfo);
+
+	if (!(ReportBuilt))
+		return;
+
+	Stats_RecordReport(ReportSent);
+	if (!(ReportSent))
+		return;
+
+	Boot_Record(BOOT_STAGE_FirstReport);
+	/* Timer1 stops in power-down, so the latency of the edges carried by the first report after a
+	 * resume cannot be measured */
+	if (ReportHasEdge && !ReportIsInitial)
+		Stats_RecordLatency(ReportEdgeTimestamp);
+}
+
+/** Builds and commits the IN reports of the profile's interfaces whose endpoint has a free bank.
+ *  While the host has not taken both banks of an endpoint the transitions wait in the input queue,
+ *  the report pipeline, so none is merged or overwritten.
+ */
+static void RunHIDTasks(void)
+{
+	HID_REPORT_INTERFACES(HID_INTERFACE_USB_TASK)
+}
+
+#if defined(SLEEP_BETWEEN_FRAMES)
+/** Puts the CPU in idle sleep until the next interrupt, unless a snapshot is already waiting for
+ *  the report builders. The Start Of Frame, input, Timer1 and control endpoint interrupts all wake
+ *  the CPU, and at least the Start Of Frame or debouncer interrupt does so every millisecond, so the
+ *  main loop tasks still run once per frame and the reports are built right after the snapshot.
+ */
+static void SleepUntilInterrupt(void)
+{
+	uint16_t SleepStart;
+
+	set_sleep_mode(SLEEP_MODE_IDLE);
+
+	/* Interrupts stay disabled from the check until the sleep instruction, sei() takes effect
+	 * after the instruction that follows it, so a snapshot cannot be missed */
+	cli();
+	if (!(Input_SnapshotPending)) {
+		SleepStart = Input_GetTimestamp();
+
+		PROFILE_ENTER(PROFILE_Sleep);
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+		PROFILE_LEAVE(PROFILE_Sleep);
+
+		Stats_RecordSleep(SleepStart, Input_GetTimestamp());
+	}
+	sei();
+}
+#endif
+
+/** Releases the reports task when the frame's input snapshot is taken, at the time of the snapshot. */
+static bool SnapshotTaken(uint16_t* const Release)
+{
+	if (!(Input_TakeSnapshot(&Snapshot)))
+		return false;
+
+	*Release = Snapshot.Timestamp;
+	return true;
+}
+
+/** Builds the reports once per frame, right after the snapshot. The endpoints are double banked, so
+ *  a second joystick transition queued before the snapshot is committed behind the first one and
+ *  sent at the next poll instead of waiting for the next snapshot.
+ */
+static void ReportsTask(void)
+{
+	RunHIDTasks();
+	if (Input_HasDigitalEvent(&Snapshot))
+		RunHIDTasks();
+}
+
+/** Runs the LUFA device management and control endpoint, then drains the raw stream once per USB
+ *  frame, whatever the input snapshot interval: the host takes a stream report every frame, and the
+ *  sample buffer only holds 8ms at the default rate. The task runs on every pass, the passes without
+ *  a control request or stream report are left out of its load.
+ */
+static void USBTask(void)
+{
+	bool Idle;
+
+	ControlRequestTaken = false;
+	USB_USBTask();
+	Idle = !(ControlRequestTaken);
+
+#if defined(RAW_STREAM)
+	if (StreamFramePending) {
+		StreamFramePending = false;
+		HID_Device_USBTask(&Stream_HID_Interface);
+		Idle = false;
+	}
+#endif
+
+	if (Idle)
+		Scheduler_MarkIdle();
+}
+
+static void HousekeepingTask(void)
+{
+	LEDs_SetAllLEDs(StatusLEDs);
+}
+
+/** Turns the LEDs off and powers the device down until the bus is resumed, then restarts the main
+ *  loop tasks and the duty cycle measurement, whose time base stopped meanwhile, and restores the LEDs.
+ */
+static void Suspend(void)
+{
+	LEDs_SetAllLEDs(LEDS_NO_LEDS);
+
+	Power_Suspend();
 
-		.ReportINEndpointNumber       = JOYSTICK_EPNUM,
-		.ReportINEndpointSize         = HID_EPSIZE,
-		.ReportINEndpointDoubleBank   = false,
+	Scheduler_Init();
+	Stats_Init();
+	HousekeepingTask();
+}
 
-		.PrevReportINBuffer           = PrevJoystickHIDReportBuffer,
-		.PrevReportINBufferSize       = sizeof(PrevJoystickHIDReportBuffer),
+/** Main loop tasks. The reports must be committed before the host's IN token, within the snapshot
+ *  lead time. An EEPROM byte write takes 3.4ms, the settings task gets to write the next one each
+ *  4ms, and the LEDs only need to follow the USB state at a rate the eye can see.
+ */
+const Scheduler_Task_t Scheduler_Tasks[SCHEDULER_TASKS] = {
+	[SCHEDULER_TASK_Reports] = {
+		.Event         = SnapshotTaken,
+		.Run           = ReportsTask,
+		.DeadlineTicks = INPUT_SNAPSHOT_LEAD_TICKS,
+	},
+	[SCHEDULER_TASK_USB] = {
+		.Run           = USBTask,
+	},
+	[SCHEDULER_TASK_Settings] = {
+		.Run           = Settings_Task,
+		.PeriodTicks   = SCHEDULER_US(4000),
+		.DeadlineTicks = SCHEDULER_US(4000),
+	},
+	[SCHEDULER_TASK_Housekeeping] = {
+		.Run           = HousekeepingTask,
+		.PeriodTicks   = SCHEDULER_US(50000),
+		.DeadlineTicks = SCHEDULER_US(50000),
 	},
 };
 
 
 int main(void)
 {
+	Boot_Init();
 	SetupHardware();
+	Scheduler_Init();
 
 	LEDs_SetAllLEDs(LEDMASK_USB_NOTREADY);
 	sei();
 
 	for (;;)
 	{
-		HID_Device_USBTask(&Mouse_HID_Interface);
-		HID_Device_USBTask(&Joystick_HID_Interface);
-		USB_USBTask();
+		PROFILE_ENTER(PROFILE_MainLoop);
+
+		Scheduler_Run();
+
+		if (USB_DeviceState == DEVICE_STATE_Suspended)
+			Suspend();
+#if defined(SLEEP_BETWEEN_FRAMES)
+		else
+			SleepUntilInterrupt();
+#endif
+
+		PROFILE_LEAVE(PROFILE_MainLoop);
 	}
 }
 
@@ -83,70 +335,324 @@ void SetupHardware(void)
 
 	/* Disable clock division */
 	clock_prescale_set(clock_div_1);
+	Boot_Record(BOOT_STAGE_Clock);
+
+	/* Attach first, the host waits at least 100ms after the attach before it resets the bus, and
+	 * the inputs are initialized in that time. Interrupts stay disabled until main() enables them,
+	 * so no USB event runs before the inputs are ready. */
+	USB_Init();
+	Boot_Record(BOOT_STAGE_USBInit);
 
 	/* Hardware Initialization */
 	Joystick_Init();
 	LEDs_Init();
 	Buttons_Init();
-	USB_Init();
+	Settings_Init();
+	Input_Init();
+#if defined(ANALOG_AXES)
+	Analog_Init();
+#endif
+	Dial_Init();
+#if defined(RAW_STREAM)
+	Stream_Init();
+#endif
+	Power_Init();
+	Stats_Init();
+	Boot_Record(BOOT_STAGE_InputInit);
 }
 
 void EVENT_USB_Device_Connect(void)
 {
-	LEDs_SetAllLEDs(LEDMASK_USB_ENUMERATING);
+	Boot_Record(BOOT_STAGE_Connect);
+
+	StatusLEDs = LEDMASK_USB_ENUMERATING;
+}
+
+void EVENT_USB_Device_Reset(void)
+{
+	Boot_Record(BOOT_STAGE_BusReset);
 }
 
 void EVENT_USB_Device_Disconnect(void)
 {
-	LEDs_SetAllLEDs(LEDMASK_USB_NOTREADY);
+	StatusLEDs = LEDMASK_USB_NOTREADY;
 }
 
 void EVENT_USB_Device_ConfigurationChanged(void)
 {
 	bool ConfigSuccess = true;
 
-	ConfigSuccess &= HID_Device_ConfigureEndpoints(&Mouse_HID_Interface);
-	ConfigSuccess &= HID_Device_ConfigureEndpoints(&Joystick_HID_Interface);
+	HID_INTERFACES(HID_INTERFACE_CONFIGURE_ENDPOINTS)
 
 	USB_Device_EnableSOFEvents();
 
-	LEDs_SetAllLEDs(ConfigSuccess ? LEDMASK_USB_READY : LEDMASK_USB_ERROR);
+	/* Send the input state at once rather than at the first change, from a snapshot taken now
+	 * rather than before the next frame */
+	InitialReportPending = true;
+	Input_RequestSnapshot();
+	Boot_Record(BOOT_STAGE_Configured);
+
+	StatusLEDs = (ConfigSuccess ? LEDMASK_USB_READY : LEDMASK_USB_ERROR);
+}
+
+/** The host resumed the bus, on its own or after a remote wakeup. The input that woke it is sent at
+ *  once, from a snapshot taken now, so that it is read at the first poll after the resume.
+ */
+void EVENT_USB_Device_WakeUp(void)
+{
+	InitialReportPending = true;
+	Input_RequestSnapshot();
 }
 
 void EVENT_USB_Device_ControlRequest(void)
 {
-	HID_Device_ProcessControlRequest(&Mouse_HID_Interface);
-	HID_Device_ProcessControlRequest(&Joystick_HID_Interface);
+	InControlRequest = true;
+	HID_INTERFACES(HID_INTERFACE_CONTROL_REQUEST)
+	InControlRequest = false;
+
+	ControlRequestTaken = true;
 }
 
 void EVENT_USB_Device_StartOfFrame(void)
 {
-	HID_Device_MillisecondElapsed(&Mouse_HID_Interface);
-	HID_Device_MillisecondElapsed(&Joystick_HID_Interface);
+	PROFILE_ENTER(PROFILE_StartOfFrame);
+
+	Input_StartOfFrame();
+
+	HID_INTERFACES(HID_INTERFACE_MILLISECOND)
+
+#if defined(RAW_STREAM)
+	StreamFramePending = true;
+#endif
+
+	PROFILE_LEAVE(PROFILE_StartOfFrame);
+}
+
+/** Keeps the timestamp of the first input edge taken into the report being built. */
+static void TrackEdge(const InputEvent_t* const Event)
+{
+	if (!(ReportHasEdge)) {
+		ReportEdgeTimestamp = Event->Timestamp;
+		ReportHasEdge       = true;
+	}
+}
+
+#if defined(EDGE_TIMESTAMP)
+/** Sets the edge time of a joystick or combined report that is going to be sent: the time from its
+ *  earliest input edge to the Start Of Frame its snapshot was taken for, in microseconds. The field
+ *  is zero while the report is compared with the previous one, so that the edge time alone never
+ *  makes a report differ from it.
+ */
+static void SetEdgeTime(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo, void* ReportData)
+{
+	uint16_t EdgeUS = ((uint16_t)(Snapshot.FrameTimestamp - ReportEdgeTimestamp) / INPUT_TICKS_PER_US);
+
+#if defined(COMBINED_REPORT)
+	((USB_ControllerReport_Data_t*)ReportData)->EdgeUS = EdgeUS;
+#else
+	if (HIDInterfaceInfo == &Joystick_HID_Interface)
+		((USB_JoystickReport_Players_t*)ReportData)->EdgeUS = EdgeUS;
+#endif
+}
+#endif
+
+/** Takes the pending initial report atomically, so that a configuration or resume signalled while a
+ *  report is built is not cleared with it.
+ *
+ *  \return Boolean true if the report to build carries the initial input state
+ */
+static bool TakeInitialReport(void)
+{
+	bool Pending;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Pending = InitialReportPending;
+		InitialReportPending = false;
+	}
+
+	return Pending;
+}
+
+/** Decides whether an input state report is sent: at once for the initial state, when it differs
+ *  from the last report sent, or when the host's idle period elapsed. The report to send becomes the
+ *  last report, the suppressed one is replaced by an empty report.
+ *
+ *  \return Boolean true if the report is sent, false if it is suppressed
+ */
+static bool
+SendStateReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+                const bool ForceSend,
+                const void* ReportData,
+                uint16_t* const ReportSize)
+{
+	if (!(ForceSend || memcmp(ReportData, &LastStateReport, sizeof(LastStateReport)) ||
+	      (HIDInterfaceInfo->State.IdleCount && !(HIDInterfaceInfo->State.IdleMSRemaining))))
+	{
+		*ReportSize = 0;
+		return false;
+	}
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memcpy(&LastStateReport, ReportData, sizeof(LastStateReport));
+
+#if defined(COMBINED_REPORT)
+		/* The dial is relative, a report without dial motion must only be sent when the joystick
+		 * or buttons changed, so the last report's dial is not part of the comparison */
+		LastStateReport.Dial = 0;
+#endif
+	}
+
+	return true;
+}
+
+/** Builds the input report of a GET_REPORT request: the last input state report sent, without dial
+ *  motion, or an empty report for the raw stream. The input queues belong to the main loop and are
+ *  not touched, the request may be served from the control endpoint interrupt.
+ */
+static uint16_t
+CreateRequestedReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+                      uint8_t *ReportData)
+{
+#if defined(RAW_STREAM)
+	if (HIDInterfaceInfo == &Stream_HID_Interface)
+		return 0;
+#endif
+
+#if !defined(COMBINED_REPORT)
+	if (HIDInterfaceInfo == &Mouse_HID_Interface) {
+		memset(ReportData, 0, sizeof(USB_MouseReport_Data_t));
+		return sizeof(USB_MouseReport_Data_t);
+	}
+#endif
+
+	/* GET_REPORT sends the buffer as is, the report ID is written by the application. The interface
+	 * carries the feature reports, so its buffer is larger than the input report with its ID */
+#if defined(COMBINED_REPORT)
+	ReportData[0] = HID_REPORTID_Controller;
+#elif defined(KEYBOARD_REPORT)
+	ReportData[0] = HID_REPORTID_Keyboard;
+#else
+	ReportData[0] = HID_REPORTID_Joystick;
+#endif
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memcpy(&ReportData[1], &LastStateReport, sizeof(LastStateReport));
+	}
+
+	return (1 + sizeof(LastStateReport));
+}
+
+static uint16_t
+CreateFeatureReport(const uint8_t ReportID, uint8_t *ReportData)
+{
+	/* GET_REPORT sends the buffer as is, unlike the IN reports it does not start with the ID */
+	ReportData[0] = ReportID;
+
+	switch (ReportID) {
+	case HID_REPORTID_Stats:
+		Stats_GetReport((Stats_Report_t*)&ReportData[1]);
+		return STATS_FEATURE_REPORT_SIZE;
+
+	case HID_REPORTID_Settings:
+		memcpy(&ReportData[1], &Settings, sizeof(Settings_t));
+		return SETTINGS_FEATURE_REPORT_SIZE;
+
+	case HID_REPORTID_Boot:
+		Boot_GetReport((Boot_Report_t*)&ReportData[1]);
+		return BOOT_FEATURE_REPORT_SIZE;
+
+	case HID_REPORTID_Tasks:
+		Scheduler_GetReport((Scheduler_Report_t*)&ReportData[1]);
+		return TASKS_FEATURE_REPORT_SIZE;
+	}
+
+	return 0;
 }
 
+#if !defined(COMBINED_REPORT)
 static uint16_t
 CreateMouseReport(USB_MouseReport_Data_t *MouseReport)
 {
-	static uint8_t last_pos = 0;
-	uint8_t DialPos = Joystick_GetDial();
+	InputEvent_t Event;
+	int8_t       Delta;
+
+	while (Input_GetDialEvent(&Snapshot, &Event)) {
+		TrackEdge(&Event);
+		Dial_Update(Event.State, Event.Timestamp);
+	}
+	Dial_Update(Input_GetSnapshotDial(&Snapshot), Snapshot.Timestamp);
 
-	if (DialPos == last_pos)
+	if (!(Delta = Dial_TakeDelta()))
 		return 0;
 
-	MouseReport->Y = DialPos - last_pos;
+	MouseReport->Y = Delta;
 	MouseReport->X = 0;
 	MouseReport->Button = 0;
-	last_pos = DialPos;
 
 	return (sizeof(*MouseReport));
 }
+#endif
 
+/** Returns the digital input state to report, advanced by a single transition per report so that
+ *  short taps are not merged away.
+ */
+static InputState_t
+TakeDigitalState(void)
+{
+	static InputState_t InputState = 0;
+	InputEvent_t Event;
+
+	while (Input_GetDigitalEvent(&Snapshot, &Event)) {
+		if (Event.State != InputState) {
+			InputState = Event.State;
+			TrackEdge(&Event);
+			break;
+		}
+	}
+
+	return InputState;
+}
+
+#if defined(KEYBOARD_REPORT)
+/** Fills the NKRO keyboard report with the keys of the inputs held by all players. */
 static uint16_t
-CreateJoystickReport(USB_JoystickReport_Data_t *JoystickReport)
+CreateKeyboardReport(USB_KeyboardReport_NKRO_Data_t *KeyboardReport)
+{
+	InputState_t   InputState = TakeDigitalState();
+	const uint8_t* Key        = Settings.KeyMap;
+
+	memset(KeyboardReport, 0, sizeof(*KeyboardReport));
+
+	for (uint8_t Player = 0; Player < INPUT_PLAYERS; Player++) {
+		uint8_t PlayerState = INPUT_PLAYER_STATE(InputState, Player);
+
+		for (uint8_t i = 0; i < SETTINGS_PLAYER_KEYS; i++, Key++) {
+			if (!(PlayerState & pgm_read_byte(&KeyInputs[i])) || !(*Key))
+				continue;
+
+			if (*Key >= SETTINGS_KEYCODE_MODIFIER_MIN)
+				KeyboardReport->Modifier |= (1 << (*Key - SETTINGS_KEYCODE_MODIFIER_MIN));
+			else
+				KeyboardReport->Keys[*Key / 8] |= (1 << (*Key % 8));
+		}
+	}
+
+	return (sizeof(*KeyboardReport));
+}
+#else
+static void
+CreatePlayerReport(USB_JoystickReport_Data_t *JoystickReport, const uint8_t PlayerState)
 {
-	uint8_t JoyStatus_LCL    = Joystick_GetStatus();
-	uint8_t ButtonStatus_LCL = Buttons_GetStatus();
+	uint8_t ButtonStatus_LCL = PlayerState;
+
+#if defined(ANALOG_AXES)
+	/* The stick is analog, the axes come from the same snapshot as the buttons */
+	JoystickReport->Joystick = Snapshot.Axes;
+#else
+	uint8_t JoyStatus_LCL    = PlayerState;
 
 	if (JoyStatus_LCL & JOY_UP)
 		JoystickReport->Joystick.Y = -1;
@@ -161,17 +667,54 @@ CreateJoystickReport(USB_JoystickReport_Data_t *JoystickReport)
 		JoystickReport->Joystick.X = 1;
 	else
 		JoystickReport->Joystick.X = 0;
+#endif
 
 	JoystickReport->Button = 0;
-	if (ButtonStatus_LCL & BUTTONS_BUTTON1)
+	if (ButtonStatus_LCL & Settings.ButtonMap[0])
 		JoystickReport->Button |= (1 << 0);
-	if (ButtonStatus_LCL & BUTTONS_BUTTON2)
+	if (ButtonStatus_LCL & Settings.ButtonMap[1])
 		JoystickReport->Button |= (1 << 1);
-	if (ButtonStatus_LCL & BUTTONS_BUTTON3)
+	if (ButtonStatus_LCL & Settings.ButtonMap[2])
 		JoystickReport->Button |= (1 << 2);
+}
+
+/** Fills the joystick report of all players. The transitions of all players share one queue, so
+ *  taking the next one costs the same for any number of players.
+ */
+static void
+CreateJoystickReport(USB_JoystickReport_Data_t *JoystickReport)
+{
+	InputState_t InputState = TakeDigitalState();
+
+	CreatePlayerReport(&JoystickReport[0], INPUT_PLAYER_STATE(InputState, 0));
+#if (INPUT_PLAYERS > 1)
+	CreatePlayerReport(&JoystickReport[1], INPUT_PLAYER_STATE(InputState, 1));
+#endif
+}
+#endif
+
+#if defined(COMBINED_REPORT)
+static uint16_t
+CreateControllerReport(USB_ControllerReport_Data_t *ControllerReport)
+{
+	InputEvent_t Event;
+
+	while (Input_GetDialEvent(&Snapshot, &Event)) {
+		TrackEdge(&Event);
+		Dial_Update(Event.State, Event.Timestamp);
+	}
+	Dial_Update(Input_GetSnapshotDial(&Snapshot), Snapshot.Timestamp);
+
+	CreateJoystickReport(ControllerReport->Joystick);
+	ControllerReport->Dial = Dial_TakeDelta();
+
+#if defined(EDGE_TIMESTAMP)
+	ControllerReport->EdgeUS = 0;
+#endif
 
-	return (sizeof(*JoystickReport));
+	return (sizeof(*ControllerReport));
 }
+#endif
 
 /** HID class driver callback function for the creation of HID reports to the host.
  *
@@ -189,15 +732,81 @@ bool CALLBACK_HID_Device_CreateHIDReport(USB_ClassInfo_HID_Device_t* const HIDIn
                                          void* ReportData,
                                          uint16_t* const ReportSize)
 {
+	bool ForceSend = false;
+
+	if (ReportType == HID_REPORT_ITEM_Feature) {
+		if (FEATURE_INTERFACES & (1 << HIDInterfaceInfo->Config.InterfaceNumber))
+			*ReportSize = CreateFeatureReport(*ReportID, ReportData);
+
+		return false;
+	}
+
+	if (InControlRequest) {
+		*ReportSize = CreateRequestedReport(HIDInterfaceInfo, ReportData);
+		return false;
+	}
+
+	PROFILE_ENTER(PROFILE_INTERFACE_REPORT(HIDInterfaceInfo));
+
+#if defined(RAW_STREAM)
+	/* The raw stream is sent whenever it has samples, it does not touch the input queues and is
+	 * not counted in the statistics of the input reports */
+	if (HIDInterfaceInfo == &Stream_HID_Interface) {
+		*ReportSize = Stream_CreateReport(ReportData);
+
+		PROFILE_LEAVE(PROFILE_StreamReport);
+		return (*ReportSize != 0);
+	}
+#endif
+
+	ReportHasEdge   = false;
+#if defined(COMBINED_REPORT)
+	ReportIsInitial = TakeInitialReport();
+#else
+	ReportIsInitial = ((HIDInterfaceInfo != &Mouse_HID_Interface) && TakeInitialReport());
+#endif
+
+#if defined(COMBINED_REPORT)
+	*ReportID   = HID_REPORTID_Controller;
+	*ReportSize = CreateControllerReport(ReportData);
+	ForceSend   = ((((USB_ControllerReport_Data_t*)ReportData)->Dial != 0) || ReportIsInitial);
+	ForceSend   = SendStateReport(HIDInterfaceInfo, ForceSend, ReportData, ReportSize);
+#else
 	if (HIDInterfaceInfo == &Mouse_HID_Interface) {
 		*ReportSize = CreateMouseReport(ReportData);
-		if (*ReportSize != 0)
-			return true;
+		ForceSend   = (*ReportSize != 0);
+#if defined(KEYBOARD_REPORT)
+	} else if (HIDInterfaceInfo == &Keyboard_HID_Interface) {
+		*ReportID   = HID_REPORTID_Keyboard;
+		*ReportSize = CreateKeyboardReport(ReportData);
+		ForceSend   = SendStateReport(HIDInterfaceInfo, ReportIsInitial, ReportData, ReportSize);
+	}
+#else
 	} else if (HIDInterfaceInfo == &Joystick_HID_Interface) {
-		*ReportSize = CreateJoystickReport(ReportData);
+		*ReportID   = HID_REPORTID_Joystick;
+		CreateJoystickReport(((USB_JoystickReport_Players_t*)ReportData)->Player);
+		*ReportSize = sizeof(USB_JoystickReport_Players_t);
+
+#if defined(EDGE_TIMESTAMP)
+		((USB_JoystickReport_Players_t*)ReportData)->EdgeUS = 0;
+#endif
+
+		ForceSend   = SendStateReport(HIDInterfaceInfo, ReportIsInitial, ReportData, ReportSize);
 	}
+#endif
+#endif
 
-	return false;
+	ReportBuilt = true;
+	ReportSent  = ForceSend;
+
+#if defined(EDGE_TIMESTAMP)
+	if (ForceSend && ReportHasEdge && !ReportIsInitial)
+		SetEdgeTime(HIDInterfaceInfo, ReportData);
+#endif
+
+	PROFILE_LEAVE(PROFILE_INTERFACE_REPORT(HIDInterfaceInfo));
+
+	return ForceSend;
 }
 
 void CALLBACK_HID_Device_ProcessHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
@@ -206,6 +815,15 @@ void CALLBACK_HID_Device_ProcessHIDReport(USB_ClassInfo_HID_Device_t* const HIDI
                                           const void* ReportData,
                                           const uint16_t ReportSize)
 {
-	// Unused (but mandatory for the HID class driver) in this demo, since there are no Host->Device reports
+	/* The host writes the settings feature report of the interface carrying the feature reports,
+	 * invalid settings are ignored */
+	if (!(FEATURE_INTERFACES & (1 << HIDInterfaceInfo->Config.InterfaceNumber)))
+		return;
+
+	if ((ReportType == HID_REPORT_ITEM_Feature) && (ReportID == HID_REPORTID_Settings) &&
+	    (ReportSize == sizeof(Settings_t)))
+	{
+		Settings_Set(ReportData);
+	}
 }
 
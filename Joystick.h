@@ -38,9 +38,19 @@
 #include <avr/wdt.h>
 #include <avr/power.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
 #include <string.h>
 
 #include "Descriptors.h"
+#include "Input.h"
+#include "Analog.h"
+#include "Dial.h"
+#include "Stats.h"
+#include "Settings.h"
+#include "Boot.h"
+#include "Scheduler.h"
+#include "Power.h"
+#include "Stream.h"
 
 #include <LUFA/Version.h>
 #include <LUFA/Drivers/Board/Joystick.h>
@@ -48,14 +58,64 @@
 #include <LUFA/Drivers/Board/Buttons.h>
 #include <LUFA/Drivers/USB/USB.h>
 
+/** Joystick and buttons of one player. The joystick report holds one per player, packed in player
+ *  order after the \ref HID_REPORTID_Joystick ID byte.
+ */
 typedef struct {
+#if defined(ANALOG_AXES)
+	AnalogAxes_t Joystick;
+#else
 	struct {
 		int X : 8;
 		int Y : 8;
 	} Joystick;
+#endif
 	uint8_t Button;
 } USB_JoystickReport_Data_t;
 
+/** Joystick report of all players. */
+typedef struct {
+	USB_JoystickReport_Data_t Player[INPUT_PLAYERS];
+#if defined(EDGE_TIMESTAMP)
+	uint16_t                  EdgeUS; /**< Time from the report's earliest input edge to its Start Of Frame, 0 for none */
+#endif
+} USB_JoystickReport_Players_t;
+
+/** Combined report of the \c COMBINED_REPORT build, sent after the \ref HID_REPORTID_Controller ID byte. */
+typedef struct {
+	USB_JoystickReport_Data_t Joystick[INPUT_PLAYERS];
+	int8_t                    Dial;
+#if defined(EDGE_TIMESTAMP)
+	uint16_t                  EdgeUS; /**< Time from the report's earliest input edge to its Start Of Frame, 0 for none */
+#endif
+} USB_ControllerReport_Data_t;
+
+/** NKRO keyboard report of the \c KEYBOARD_REPORT build, sent after the \ref HID_REPORTID_Keyboard ID byte. */
+typedef struct {
+	uint8_t Modifier;                  /**< Bit n is set while modifier usage 0xE0 + n is held */
+	uint8_t Keys[KEYBOARD_KEYS / 8];   /**< Bit n of byte i is set while usage 8i + n is held */
+} USB_KeyboardReport_NKRO_Data_t;
+
+#if defined(EDGE_TIMESTAMP)
+	#if defined(KEYBOARD_REPORT)
+		#error EDGE_TIMESTAMP extends the joystick or combined report, the KEYBOARD_REPORT has no room for it.
+	#endif
+
+	#if (INPUT_PLAYERS > 1) || (defined(COMBINED_REPORT) && defined(ANALOG_AXES))
+		#error EDGE_TIMESTAMP does not fit in the HID_EPSIZE endpoint with this report layout.
+	#endif
+#endif
+
+#if defined(KEYBOARD_REPORT)
+	#if defined(COMBINED_REPORT)
+		#error KEYBOARD_REPORT and COMBINED_REPORT are alternative interface profiles, define only one.
+	#endif
+
+	#if defined(ANALOG_AXES)
+		#error KEYBOARD_REPORT maps the digital joystick to keys, the ANALOG_AXES cannot be reported.
+	#endif
+#endif
+
 #define LEDMASK_USB_NOTREADY      LEDS_LED1
 
 #define LEDMASK_USB_ENUMERATING  (LEDS_LED2 | LEDS_LED3)
@@ -66,11 +126,19 @@ typedef struct {
 
 void SetupHardware(void);
 
+#if defined(SLEEP_BETWEEN_FRAMES)
+	#if !defined(INTERRUPT_CONTROL_ENDPOINT)
+		#error SLEEP_BETWEEN_FRAMES requires INTERRUPT_CONTROL_ENDPOINT in LUFA_OPTS, so that control requests wake the CPU.
+	#endif
+#endif
+
 void EVENT_USB_Device_Connect(void);
 void EVENT_USB_Device_Disconnect(void);
+void EVENT_USB_Device_Reset(void);
 void EVENT_USB_Device_ConfigurationChanged(void);
 void EVENT_USB_Device_ControlRequest(void);
 void EVENT_USB_Device_StartOfFrame(void);
+void EVENT_USB_Device_WakeUp(void);
 
 bool CALLBACK_HID_Device_CreateHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
 					 uint8_t* const ReportID,
@@ -0,0 +1,134 @@
+/** \file
+ *
+ *  Power management. The peripherals the firmware never uses are gated at startup. While the host
+ *  keeps the bus suspended the CPU sleeps in power-down, from which the USB controller, the joystick
+ *  edge interrupts (INT0-INT3) and the dial pin change interrupt (PCINT0) wake it. The buttons on
+ *  Port F and the joystick of player 2 have no pin interrupts, so when the host enabled remote
+ *  wakeup the watchdog also wakes the CPU every 16ms to sample them. A digital input that changed is
+ *  debounced in idle sleep, where Timer1 and the debouncer run, and the first debounced transition or
+ *  dial step signals remote wakeup. The transitions stay queued, and are reported once the host
+ *  resumed the bus.
+ */
+
+#include "Power.h"
+
+/** Watchdog periods since the suspend or since the remote wakeup was signalled, saturating. */
+static volatile uint8_t WatchdogPeriods;
+
+/** Starts the watchdog in interrupt mode with its shortest period, 16ms. */
+static void StartWatchdog(void)
+{
+	WatchdogPeriods = 0;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		wdt_reset();
+		WDTCSR = ((1 << WDCE) | (1 << WDE));
+		WDTCSR = (1 << WDIE);
+	}
+}
+
+/** Sleeps in the given mode until the next interrupt, unless the bus has been resumed already. */
+static void Sleep(const uint8_t Mode)
+{
+	set_sleep_mode(Mode);
+
+	/* As in SleepUntilInterrupt(), a resume between the check and the sleep instruction still wakes the CPU */
+	cli();
+	if (USB_DeviceState == DEVICE_STATE_Suspended) {
+		PROFILE_ENTER(PROFILE_Sleep);
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+		PROFILE_LEAVE(PROFILE_Sleep);
+	}
+	sei();
+}
+
+/** Gates the clocks of the peripherals the firmware does not use: the TWI, SPI and USART, Timer0
+ *  and Timer3, the analog comparator and, unless the axes are analog, the ADC.
+ */
+void Power_Init(void)
+{
+	ACSR = (1 << ACD);
+
+#if defined(ANALOG_AXES)
+	PRR0 = ((1 << PRTWI) | (1 << PRTIM0) | (1 << PRSPI));
+#else
+	PRR0 = ((1 << PRTWI) | (1 << PRTIM0) | (1 << PRSPI) | (1 << PRADC));
+#endif
+	PRR1 = ((1 << PRTIM3) | (1 << PRUSART1));
+}
+
+/** Sleeps for as long as the host keeps the bus suspended, and signals remote wakeup on the first
+ *  input change if the host enabled it. Must be called from the main loop once the device is
+ *  suspended, the LUFA suspend interrupt has already stopped the USB clock and the PLL. Timer1
+ *  stops in power-down, so the main loop's time base skips the suspended time.
+ */
+void Power_Suspend(void)
+{
+	uint8_t DigitalHead = Input_DigitalQueue.Head;
+	uint8_t DialHead    = Input_DialQueue.Head;
+	bool    Signalled   = false;
+
+#if defined(ANALOG_AXES)
+	Analog_Stop();
+	PRR0 |= (1 << PRADC);
+#endif
+#if defined(RAW_STREAM)
+	/* The sampling interrupt would wake the CPU from idle sleep */
+	Stream_Stop();
+#endif
+
+	if (USB_Device_RemoteWakeupEnabled)
+		StartWatchdog();
+
+	while (USB_DeviceState == DEVICE_STATE_Suspended) {
+		bool InputChanged = ((Input_DigitalQueue.Head != DigitalHead) || (Input_DialQueue.Head != DialHead));
+
+		/* Settings written just before the suspend are still saved */
+		Settings_Task();
+
+		/* The device must leave the bus idle for 5ms before it signals remote wakeup, the first
+		 * watchdog period counts from 3ms into the idle bus */
+		if (!Signalled && InputChanged && WatchdogPeriods && USB_Device_RemoteWakeupEnabled) {
+			USB_Device_SendRemoteWakeup();
+
+			Signalled       = true;
+			WatchdogPeriods = 0;
+		} else if (Signalled && (WatchdogPeriods >= POWER_RESUME_TIMEOUT)) {
+			/* The host did not resume the bus, stop the USB clock and the PLL again as the suspend
+			 * interrupt did, and wait for the next change */
+			USB_CLK_Freeze();
+
+			if (!(USB_Options & USB_OPT_MANUAL_PLL))
+				USB_PLL_Off();
+
+			Signalled   = false;
+			DigitalHead = Input_DigitalQueue.Head;
+			DialHead    = Input_DialQueue.Head;
+		}
+
+		if (Signalled || Settings_IsWritePending() || !(Input_IsSettled()))
+			Sleep(SLEEP_MODE_IDLE);
+		else
+			Sleep(SLEEP_MODE_PWR_DOWN);
+	}
+
+	wdt_disable();
+
+#if defined(ANALOG_AXES)
+	PRR0 &= ~(1 << PRADC);
+	Analog_Init();
+#endif
+#if defined(RAW_STREAM)
+	Stream_Init();
+#endif
+}
+
+ISR(WDT_vect)
+{
+	if (WatchdogPeriods != 0xFF)
+		WatchdogPeriods++;
+}
@@ -0,0 +1,35 @@
+/** \file
+ *
+ *  Header file for Power.c.
+ */
+
+#ifndef _POWER_H_
+#define _POWER_H_
+
+/* Includes: */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <LUFA/Drivers/USB/USB.h>
+
+#include "Input.h"
+#include "Analog.h"
+#include "Settings.h"
+#include "Stream.h"
+
+/* Macros: */
+/** Watchdog periods of 16ms the host is given to resume the bus after a remote wakeup, after
+ *  which the device suspends again and waits for the next input change.
+ */
+#define POWER_RESUME_TIMEOUT     8
+
+/* Function Prototypes: */
+void Power_Init(void);
+void Power_Suspend(void);
+
+#endif
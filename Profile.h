@@ -0,0 +1,47 @@
+/** \file
+ *
+ *  Cycle profiling markers for the simavr benchmark in Sim/. With CYCLE_PROFILE defined, the code
+ *  regions below write their ID to GPIOR0 on entry and the ID with \ref PROFILE_LEAVE_FLAG on exit,
+ *  a single OUT instruction each. The simulator watches the register and charges the cycles between
+ *  the two writes to the region, less the cycles of the regions nested in it, i.e. the interrupts
+ *  taken meanwhile. Without CYCLE_PROFILE the markers compile to nothing.
+ *
+ *  The region IDs are shared with the simulator, so this header must not include any AVR header;
+ *  the files using the markers include <avr/io.h> themselves.
+ */
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+/* Macros: */
+/** Profiled code regions. */
+#define PROFILE_MainLoop          0x01 /**< One main loop iteration, less the sleep */
+#define PROFILE_Sleep             0x02 /**< Idle sleep between frames, SLEEP_BETWEEN_FRAMES, and sleep in USB suspend */
+#define PROFILE_MouseReport       0x03 /**< CALLBACK_HID_Device_CreateHIDReport() of the mouse interface */
+#define PROFILE_JoystickReport    0x04 /**< CALLBACK_HID_Device_CreateHIDReport() of the joystick interface */
+#define PROFILE_ControllerReport  0x05 /**< CALLBACK_HID_Device_CreateHIDReport() of the COMBINED_REPORT interface */
+#define PROFILE_StartOfFrame      0x06 /**< EVENT_USB_Device_StartOfFrame() */
+#define PROFILE_Debounce          0x07 /**< Timer1 compare A interrupt, the debouncer */
+#define PROFILE_Snapshot          0x08 /**< Timer1 compare B interrupt, the frame's port snapshot */
+#define PROFILE_JoystickEdge      0x09 /**< INT0-INT3 interrupts, joystick edge timestamps */
+#define PROFILE_DialEdge          0x0A /**< PCINT0 interrupt, dial transitions */
+#define PROFILE_Analog            0x0B /**< ADC interrupt, ANALOG_AXES */
+#define PROFILE_KeyboardReport    0x0C /**< CALLBACK_HID_Device_CreateHIDReport() of the KEYBOARD_REPORT interface */
+#define PROFILE_StreamReport      0x0D /**< CALLBACK_HID_Device_CreateHIDReport() of the RAW_STREAM interface */
+#define PROFILE_StreamSample      0x0E /**< Timer1 compare C interrupt, RAW_STREAM port sampling */
+
+/** Number of region IDs, including the unused ID 0. */
+#define PROFILE_REGIONS           0x0F
+
+/** Set in the marker written when a region is left. */
+#define PROFILE_LEAVE_FLAG        0x80
+
+#if defined(CYCLE_PROFILE)
+	#define PROFILE_ENTER(Region)  do { GPIOR0 = (Region); } while (0)
+	#define PROFILE_LEAVE(Region)  do { GPIOR0 = ((Region) | PROFILE_LEAVE_FLAG); } while (0)
+#else
+	#define PROFILE_ENTER(Region)  do { } while (0)
+	#define PROFILE_LEAVE(Region)  do { } while (0)
+#endif
+
+#endif
@@ -0,0 +1,182 @@
+/** \file
+ *
+ *  Cooperative main loop scheduler. The application's \ref Scheduler_Tasks are run to completion, in
+ *  priority order, when their event fires or their period elapses. The scheduler keeps time in
+ *  Timer1 ticks, extended to 32 bits by the overflow interrupt, see \ref Boot_GetTimerTicks(), so
+ *  that a task or a pass running longer than the 32.768ms Timer1 period is timed in full. The time
+ *  each task runs is summed over a one second window into its CPU share, and a run completed later
+ *  than the task's deadline after its release counts as a miss. The windows after the scheduler is
+ *  started are shorter, so that the shares are known 125ms after power-on or a resume. A task run
+ *  on every pass marks the passes in which it only polled with \ref Scheduler_MarkIdle(), and they
+ *  are left out of its runs and share, which would otherwise take up the time the loop spins.
+ *
+ *  The inputs are not sampled by tasks: the joystick and buttons are debounced in the Timer1
+ *  compare A interrupt, and every dial transition is captured by the pin change interrupt, so a
+ *  fast spin cannot alias however busy the main loop is.
+ */
+
+#include "Scheduler.h"
+
+/** Scheduler time, the Timer1 count extended to 32 bits when it was last updated. */
+static uint32_t Now;
+
+/** Next release of each periodic task. */
+static uint32_t NextRelease[SCHEDULER_TASKS];
+
+/** Task load counters, and the busy time of each task in the current measurement window. */
+static Scheduler_TaskLoad_t Load[SCHEDULER_TASKS];
+static uint32_t             WindowBusyTicks[SCHEDULER_TASKS];
+static uint32_t             WindowStart;
+static uint32_t             WindowLength;
+
+/** Set by \ref Scheduler_MarkIdle() during the run of the current task. */
+static bool RunIdle;
+
+/** Advances the scheduler time to the current Timer1 count, and returns the time. */
+static uint32_t UpdateTime(void)
+{
+	Now = Boot_GetTimerTicks();
+
+	return Now;
+}
+
+/** Returns whether the given task is due, and the time it was released. */
+static bool IsReleased(const Scheduler_Task_t* const Task,
+                       const uint8_t TaskID,
+                       uint32_t* const Release)
+{
+	if (Task->Event) {
+		uint16_t EventTime;
+
+		if (!(Task->Event(&EventTime)))
+			return false;
+
+		/* The low half of the time is the Timer1 count the event time was taken from */
+		*Release = (Now - (uint16_t)((uint16_t)Now - EventTime));
+		return true;
+	}
+
+	if (!(Task->PeriodTicks)) {
+		*Release = Now;
+		return true;
+	}
+
+	if ((int32_t)(Now - NextRelease[TaskID]) < 0)
+		return false;
+
+	*Release              = NextRelease[TaskID];
+	NextRelease[TaskID]  += Task->PeriodTicks;
+
+	/* Releases more than a period late are dropped rather than run back to back */
+	if ((int32_t)(Now - NextRelease[TaskID]) >= 0) {
+		NextRelease[TaskID] = (Now + Task->PeriodTicks);
+
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			Load[TaskID].DeadlineMisses++;
+		}
+	}
+
+	return true;
+}
+
+/** Ends the current load measurement window once it is complete. */
+static void UpdateLoad(void)
+{
+	uint32_t WindowTicks = (Now - WindowStart);
+
+	if (WindowTicks < WindowLength)
+		return;
+
+	for (uint8_t i = 0; i < SCHEDULER_TASKS; i++) {
+		/* The window is at least 250000 ticks long, so the share is computed in 32 bits to within
+		 * 0.4% by dividing the window first; a run started before the window may exceed it */
+		uint16_t Permille = MIN((WindowBusyTicks[i] / (WindowTicks / 1000)), 1000);
+
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			Load[i].LoadPermille = Permille;
+		}
+
+		WindowBusyTicks[i] = 0;
+	}
+
+	WindowStart = Now;
+	if (WindowLength < SCHEDULER_LOAD_WINDOW_TICKS)
+		WindowLength *= 2;
+}
+
+/** Starts the periodic tasks, the first release of each is one period from now, and a new load
+ *  measurement window of \ref SCHEDULER_LOAD_FIRST_WINDOW_TICKS. Also restarts them after the main loop stopped, as in USB suspend, so the
+ *  releases missed meanwhile are not counted as deadline misses.
+ */
+void Scheduler_Init(void)
+{
+	UpdateTime();
+	WindowStart  = Now;
+	WindowLength = SCHEDULER_LOAD_FIRST_WINDOW_TICKS;
+
+	for (uint8_t i = 0; i < SCHEDULER_TASKS; i++) {
+		NextRelease[i]     = (Now + Scheduler_Tasks[i].PeriodTicks);
+		WindowBusyTicks[i] = 0;
+	}
+}
+
+/** Runs each task that is due once, in priority order. Must be called from the main loop. */
+void Scheduler_Run(void)
+{
+	for (uint8_t i = 0; i < SCHEDULER_TASKS; i++) {
+		const Scheduler_Task_t* Task = &Scheduler_Tasks[i];
+		uint32_t Release;
+		uint32_t Start;
+		uint32_t Ticks;
+		uint32_t RunUS;
+
+		Start = UpdateTime();
+
+		if (!(IsReleased(Task, i, &Release)))
+			continue;
+
+		RunIdle = false;
+		Task->Run();
+
+		Ticks = (UpdateTime() - Start);
+
+		if (RunIdle)
+			continue;
+
+		WindowBusyTicks[i] += Ticks;
+
+		/* The report may be read from the control endpoint interrupt */
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			Load[i].Runs++;
+
+			RunUS = (Ticks / INPUT_TICKS_PER_US);
+			if (RunUS > Load[i].RunMaxUS)
+				Load[i].RunMaxUS = MIN(RunUS, UINT16_MAX);
+
+			if (Task->DeadlineTicks && ((Now - Release) > Task->DeadlineTicks))
+				Load[i].DeadlineMisses++;
+		}
+	}
+
+	UpdateLoad();
+}
+
+/** Leaves the run of the current task out of its load: the task found nothing to do. Must be called
+ *  from a task's run.
+ */
+void Scheduler_MarkIdle(void)
+{
+	RunIdle = true;
+}
+
+/** Fills in the task load feature report. */
+void Scheduler_GetReport(Scheduler_Report_t* const Report)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		memcpy(Report->Task, Load, sizeof(Load));
+	}
+}
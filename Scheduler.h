@@ -0,0 +1,79 @@
+/** \file
+ *
+ *  Header file for Scheduler.c.
+ */
+
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+/* Includes: */
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "Input.h"
+#include "Boot.h"
+
+/* Macros: */
+/** Converts a time in microseconds to scheduler ticks, the Timer1 ticks of the input time base. */
+#define SCHEDULER_US(Microseconds)  ((uint32_t)(Microseconds) * INPUT_TICKS_PER_US)
+
+/** Length of the CPU share measurement window, in scheduler ticks (one second). */
+#define SCHEDULER_LOAD_WINDOW_TICKS SCHEDULER_US(1000000UL)
+
+/** Length of the first measurement window after \ref Scheduler_Init(), in scheduler ticks (125ms).
+ *  Each window is twice as long as the previous one, up to \ref SCHEDULER_LOAD_WINDOW_TICKS.
+ */
+#define SCHEDULER_LOAD_FIRST_WINDOW_TICKS (SCHEDULER_LOAD_WINDOW_TICKS / 8)
+
+/** Number of tasks in \ref Scheduler_Tasks and in \ref Scheduler_Report_t. */
+#define SCHEDULER_TASKS          4
+
+/* Type Defines: */
+/** Main loop tasks, in priority order: on each pass the tasks that are due run in this order. */
+enum Scheduler_TaskIDs_t
+{
+	SCHEDULER_TASK_Reports      = 0, /**< IN reports of all interfaces, once per input snapshot */
+	SCHEDULER_TASK_USB          = 1, /**< LUFA device management, control endpoint and raw stream, on every pass,
+	                                      its load only counts the passes with a control request or stream report */
+	SCHEDULER_TASK_Settings     = 2, /**< Background EEPROM write of new settings */
+	SCHEDULER_TASK_Housekeeping = 3, /**< Status LEDs */
+};
+
+/** Main loop task. A task is released by its event when it has one, else every PeriodTicks, and
+ *  must complete within DeadlineTicks of its release.
+ */
+typedef struct {
+	bool     (*Event)(uint16_t* const Release); /**< Returns true and the Timer1 time of the event to release
+	                                                 the task, NULL for a periodic task */
+	void     (*Run)(void);                      /**< Task body, must return within a few hundred microseconds */
+	uint32_t PeriodTicks;                       /**< Time between releases of a periodic task, 0 for every pass */
+	uint32_t DeadlineTicks;                     /**< Time from release to completion, 0 for no deadline */
+} Scheduler_Task_t;
+
+/** Load of one task in \ref Scheduler_Report_t, all fields little endian. */
+typedef struct {
+	uint16_t Runs;              /**< Runs of the task, wrapping around, idle runs excluded */
+	uint16_t LoadPermille;      /**< Share of the time the task ran over the last window of up to one second, in 1/1000 */
+	uint16_t RunMaxUS;          /**< Longest run, in microseconds */
+	uint16_t DeadlineMisses;    /**< Runs completed after their deadline, and periodic releases skipped */
+} Scheduler_TaskLoad_t;
+
+/** Task load feature report, one entry per task of \ref Scheduler_TaskIDs_t. The task times include
+ *  the interrupts taken while the task runs.
+ */
+typedef struct {
+	Scheduler_TaskLoad_t Task[SCHEDULER_TASKS];
+} Scheduler_Report_t;
+
+/* External Variables: */
+extern const Scheduler_Task_t Scheduler_Tasks[SCHEDULER_TASKS];
+
+/* Function Prototypes: */
+void Scheduler_Init(void);
+void Scheduler_Run(void);
+void Scheduler_MarkIdle(void);
+void Scheduler_GetReport(Scheduler_Report_t* const Report);
+
+#endif
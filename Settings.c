@@ -0,0 +1,170 @@
+/** \file
+ *
+ *  Runtime settings. The settings are loaded from EEPROM at boot, or set to the compile-time
+ *  defaults if the EEPROM holds no valid image, and applied to the input and dial modules, which
+ *  keep the derived values they need in RAM. The hot paths never read the EEPROM. New settings
+ *  from the host are handed to the settings task, which applies them at its next run and writes
+ *  them back to EEPROM in the background, one byte per run, so that the main loop never waits for
+ *  the EEPROM. The settings may arrive in the control endpoint interrupt, only the handoff is
+ *  shared with it.
+ */
+
+#include "Settings.h"
+
+/** EEPROM image of the settings. */
+typedef struct {
+	uint8_t    Magic;
+	Settings_t Settings;
+	uint8_t    Checksum;
+} SettingsImage_t;
+
+/** Current settings. */
+Settings_t Settings;
+
+static SettingsImage_t EEMEM SettingsEEPROM;
+
+/** Image being written to EEPROM, and the offset of its next byte to write, owned by the main loop. */
+static SettingsImage_t Image;
+static uint8_t         WriteOffset = sizeof(SettingsImage_t);
+
+/** Settings received from the host and not yet taken by the settings task. */
+static Settings_t    Received;
+static volatile bool ReceivedPending;
+
+static const Settings_t PROGMEM DefaultSettings = {
+	.DebounceUS     = INPUT_DEBOUNCE_US,
+	.DialGain       = 1,
+	.CoalesceFrames = 1,
+	.ButtonMap      = {BUTTONS_BUTTON1, BUTTONS_BUTTON2, BUTTONS_BUTTON3},
+
+	/* The default keys of MAME: the arrows, left control, left alt and space for player 1, and
+	 * R, F, D, G, A, S and Q for player 2 */
+	.KeyMap         = {0x52, 0x51, 0x50, 0x4F, 0xE0, 0xE2, 0x2C,
+	                   0x15, 0x09, 0x07, 0x0A, 0x04, 0x16, 0x14},
+
+	.DialHysteresis = DIAL_HYSTERESIS,
+	.DialDwellUS    = DIAL_DWELL_US,
+};
+
+static uint8_t Checksum(const SettingsImage_t* const SettingsImage)
+{
+	const uint8_t* Data = (const uint8_t*)SettingsImage;
+	uint8_t        Sum  = 0;
+
+	for (uint8_t i = 0; i < offsetof(SettingsImage_t, Checksum); i++)
+		Sum += Data[i];
+
+	return ~Sum;
+}
+
+static bool IsValid(const Settings_t* const NewSettings)
+{
+	if ((NewSettings->DebounceUS < SETTINGS_DEBOUNCE_US_MIN) || (NewSettings->DebounceUS > SETTINGS_DEBOUNCE_US_MAX))
+		return false;
+
+	if ((NewSettings->DialGain == 0) || (NewSettings->DialGain > SETTINGS_DIAL_GAIN_MAX) ||
+	    (NewSettings->DialGain < -SETTINGS_DIAL_GAIN_MAX))
+		return false;
+
+	if ((NewSettings->CoalesceFrames == 0) || (NewSettings->CoalesceFrames > SETTINGS_COALESCE_MAX))
+		return false;
+
+	if ((NewSettings->DialHysteresis > SETTINGS_DIAL_HYSTERESIS_MAX) || (NewSettings->DialDwellUS > SETTINGS_DIAL_DWELL_US_MAX))
+		return false;
+
+	for (uint8_t i = 0; i < SETTINGS_BUTTONS; i++) {
+		if (NewSettings->ButtonMap[i] & ~INPUT_DIGITAL_MASK)
+			return false;
+	}
+
+	/* Usages 1 to 3 are the keyboard error codes */
+	for (uint8_t i = 0; i < SETTINGS_KEYS; i++) {
+		uint8_t Key = NewSettings->KeyMap[i];
+
+		if (((Key > 0x00) && (Key < 0x04)) ||
+		    ((Key > SETTINGS_KEYCODE_MAX) && ((Key < SETTINGS_KEYCODE_MODIFIER_MIN) || (Key > SETTINGS_KEYCODE_MODIFIER_MAX))))
+			return false;
+	}
+
+	return true;
+}
+
+static void Apply(void)
+{
+	Input_SetDebounce(Settings.DebounceUS);
+	Input_SetSnapshotInterval(Settings.CoalesceFrames);
+	Dial_SetGain(Settings.DialGain);
+	Dial_SetFilter(Settings.DialHysteresis, Settings.DialDwellUS);
+}
+
+/** Loads the settings from EEPROM, or the defaults if the EEPROM image is missing or corrupt, and
+ *  applies them. Must run before the input and dial modules are initialized.
+ */
+void Settings_Init(void)
+{
+	eeprom_read_block(&Image, &SettingsEEPROM, sizeof(SettingsImage_t));
+
+	if ((Image.Magic == SETTINGS_MAGIC) && (Image.Checksum == Checksum(&Image)) && IsValid(&Image.Settings))
+		Settings = Image.Settings;
+	else
+		memcpy_P(&Settings, &DefaultSettings, sizeof(Settings_t));
+
+	Apply();
+}
+
+/** Validates new settings and hands them to the settings task, which applies them and writes them
+ *  to EEPROM. Settings received before the task took the previous ones replace them.
+ *
+ *  \param[in] NewSettings  Settings received from the host
+ *
+ *  \return Boolean true if the settings were accepted, false if a field is out of range
+ */
+bool Settings_Set(const Settings_t* const NewSettings)
+{
+	if (!(IsValid(NewSettings)))
+		return false;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Received        = *NewSettings;
+		ReceivedPending = true;
+	}
+
+	return true;
+}
+
+/** Applies the settings received from the host, and writes the next byte of pending settings to
+ *  EEPROM when the EEPROM is not busy with the previous one. Runs as a periodic main loop task.
+ */
+void Settings_Task(void)
+{
+	if (ReceivedPending) {
+		/* The settings feature report may be read from the control endpoint interrupt */
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			Settings        = Received;
+			ReceivedPending = false;
+		}
+
+		Apply();
+
+		Image.Magic    = SETTINGS_MAGIC;
+		Image.Settings = Settings;
+		Image.Checksum = Checksum(&Image);
+
+		/* Restarting an unfinished write leaves a bad checksum in EEPROM until it completes */
+		WriteOffset = 0;
+	}
+
+	if ((WriteOffset == sizeof(SettingsImage_t)) || !(eeprom_is_ready()))
+		return;
+
+	eeprom_update_byte((uint8_t*)&SettingsEEPROM + WriteOffset, ((uint8_t*)&Image)[WriteOffset]);
+	WriteOffset++;
+}
+
+/** Returns whether settings are still to be applied or written to EEPROM. */
+bool Settings_IsWritePending(void)
+{
+	return (ReceivedPending || (WriteOffset != sizeof(SettingsImage_t)));
+}
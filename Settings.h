@@ -0,0 +1,87 @@
+/** \file
+ *
+ *  Header file for Settings.c.
+ */
+
+#ifndef _SETTINGS_H_
+#define _SETTINGS_H_
+
+/* Includes: */
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <LUFA/Common/Common.h>
+#include <LUFA/Drivers/Board/Buttons.h>
+
+#include "Input.h"
+#include "Dial.h"
+
+/* Macros: */
+/** Identifies a valid settings image in EEPROM, change it whenever \ref Settings_t changes. */
+#define SETTINGS_MAGIC           0x73
+
+/** Number of buttons in the joystick report that can be mapped to inputs. */
+#define SETTINGS_BUTTONS         3
+
+/** Number of inputs of each player that can be mapped to a key of the KEYBOARD_REPORT build, in
+ *  the order of \ref Settings_t::KeyMap.
+ */
+#define SETTINGS_PLAYER_KEYS     7
+
+/** Number of entries of \ref Settings_t::KeyMap, fixed for two players so that the settings
+ *  report has the same layout in every build.
+ */
+#define SETTINGS_KEYS            (2 * SETTINGS_PLAYER_KEYS)
+
+/** Highest keyboard usage a key can be mapped to besides the modifiers, the keyboard report
+ *  carries a bit for each usage up to this one.
+ */
+#define SETTINGS_KEYCODE_MAX     0x6F
+
+/** Keyboard usages of the modifier keys, from left control to right GUI. */
+#define SETTINGS_KEYCODE_MODIFIER_MIN  0xE0
+#define SETTINGS_KEYCODE_MODIFIER_MAX  0xE7
+
+/** Range of \ref Settings_t::DebounceUS, the debouncer interrupt runs four times per window. */
+#define SETTINGS_DEBOUNCE_US_MIN 400
+#define SETTINGS_DEBOUNCE_US_MAX 16000
+
+/** Range of \ref Settings_t::DialGain magnitude. */
+#define SETTINGS_DIAL_GAIN_MAX   16
+
+/** Range of \ref Settings_t::CoalesceFrames. */
+#define SETTINGS_COALESCE_MAX    32
+
+/** Range of \ref Settings_t::DialHysteresis, in dial steps. */
+#define SETTINGS_DIAL_HYSTERESIS_MAX 8
+
+/** Range of \ref Settings_t::DialDwellUS, kept within the 16-bit dwell time in Timer1 ticks. */
+#define SETTINGS_DIAL_DWELL_US_MAX   16000
+
+/* Type Defines: */
+/** Runtime settings, as carried by the settings feature report, all fields little endian. */
+typedef struct {
+	uint16_t DebounceUS;                   /**< Time an input must be stable before a change is reported */
+	int8_t   DialGain;                     /**< Report steps per dial step, negative to reverse the dial */
+	uint8_t  CoalesceFrames;               /**< USB frames per input snapshot, changes within are sent together */
+	uint8_t  ButtonMap[SETTINGS_BUTTONS];  /**< Mask of the \ref INPUT_DIGITAL_MASK inputs pressing each button */
+	uint8_t  KeyMap[SETTINGS_KEYS];        /**< Keyboard usage of up, down, left, right and buttons 1 to 3 of
+	                                            player 1, then player 2, 0 for none (KEYBOARD_REPORT) */
+	uint8_t  DialHysteresis;               /**< Dial steps up to which a reversal is held by the jitter filter, 0 for none */
+	uint16_t DialDwellUS;                  /**< Time a held dial reversal must rest before it is reported */
+} Settings_t;
+
+/* External Variables: */
+extern Settings_t Settings;
+
+/* Function Prototypes: */
+void Settings_Init(void);
+bool Settings_Set(const Settings_t* const NewSettings);
+void Settings_Task(void);
+bool Settings_IsWritePending(void);
+
+#endif
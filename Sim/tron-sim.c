@@ -0,0 +1,601 @@
+/** \file
+ *
+ *  Cycle-accurate benchmark of the firmware image under simavr. The ELF built with CYCLE_PROFILE
+ *  runs on the simulated ATmega32U4; the benchmark enumerates it like a USB host, replays a pin
+ *  trace in the format of the host harness (see Host/HostTrace.c) and polls the IN endpoints once
+ *  per frame, while it times the code regions marked in Profile.h and the interrupt latencies.
+ *
+ *  \code
+ *  tron-sim [-f f_cpu] [-t name] Joystick.elf < ../Host/Traces/mixed.trace
+ *  \endcode
+ *
+ *  The results are printed on stdout as a single JSON object, labelled with the trace name given
+ *  with -t:
+ *
+ *  - "regions": for each region entered, the number of runs and the minimum, mean and maximum of
+ *    its cycles, less the cycles of the regions nested in it (the interrupts taken meanwhile), and
+ *    the maximum including them. The interrupt entry and exit sequences are outside the markers.
+ *  - "interrupts": for each vector taken, the number of runs and the mean and maximum cycles from
+ *    the interrupt flag being raised to the handler starting, which includes the time the CPU ran
+ *    with interrupts disabled and the wake-up from sleep, and the mean and maximum cycles of the
+ *    whole handler, from the vector being taken to its RETI, entry and exit sequences included.
+ *
+ *  Diagnostics go to stderr, the exit status is non-zero if the device fails to enumerate or the
+ *  core crashes.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sim_avr.h>
+#include <sim_elf.h>
+#include <sim_irq.h>
+#include <sim_interrupts.h>
+#include <avr_ioport.h>
+#include <avr_adc.h>
+#include <avr_usb.h>
+
+#include "../Profile.h"
+
+/** Processor frequency, F_CPU of the firmware build. */
+#define DEFAULT_F_CPU            16000000UL
+
+/** Data space address of GPIOR0 on the ATmega32U4, where the profiling markers are written. */
+#define GPIOR0_ADDRESS           0x3E
+
+/** Largest interrupt vector number of the ATmega32U4. */
+#define MAX_VECTORS              43
+
+/** Offset of the IN polls from the start of each frame, in microseconds, as in the host harness. */
+#define IN_OFFSET_US             50
+
+/** Time simulated after the last trace line, in microseconds. */
+#define TAIL_US                  20000
+
+/** Time a control transfer stage may be NAKed before the enumeration fails, in microseconds. */
+#define CONTROL_TIMEOUT_US       100000
+
+/** Largest descriptor read during enumeration. */
+#define MAX_DESCRIPTOR_SIZE      512
+
+/** Deepest nesting of profiled regions, the main loop and two levels of interrupts. */
+#define MAX_NESTING              8
+
+typedef struct {
+	uint64_t Runs;
+	uint64_t SelfTotal;
+	uint64_t SelfMin;
+	uint64_t SelfMax;
+	uint64_t InclusiveMax;
+} Region_t;
+
+typedef struct {
+	uint8_t  Region;
+	uint64_t Start;
+	uint64_t Nested;
+} OpenRegion_t;
+
+typedef struct {
+	bool     Pending;
+	uint64_t PendingSince;
+	uint64_t ClearedAt;
+	uint64_t Runs;
+	uint64_t LatencyTotal;
+	uint64_t LatencyMax;
+	bool     Running;
+	uint64_t RunningSince;
+	uint64_t Returns;
+	uint64_t CyclesTotal;
+	uint64_t CyclesMax;
+} Interrupt_t;
+
+static const char* const RegionNames[PROFILE_REGIONS] = {
+	[PROFILE_MainLoop]         = "main_loop",
+	[PROFILE_Sleep]            = "sleep",
+	[PROFILE_MouseReport]      = "create_report_mouse",
+	[PROFILE_JoystickReport]   = "create_report_joystick",
+	[PROFILE_ControllerReport] = "create_report_controller",
+	[PROFILE_StartOfFrame]     = "start_of_frame",
+	[PROFILE_Debounce]         = "isr_debounce",
+	[PROFILE_Snapshot]         = "isr_snapshot",
+	[PROFILE_JoystickEdge]     = "isr_joystick_edge",
+	[PROFILE_DialEdge]         = "isr_dial_edge",
+	[PROFILE_Analog]           = "isr_adc",
+	[PROFILE_KeyboardReport]   = "create_report_keyboard",
+	[PROFILE_StreamReport]     = "create_report_stream",
+	[PROFILE_StreamSample]     = "isr_stream_sample",
+};
+
+static const char* const VectorNames[MAX_VECTORS] = {
+	[1]  = "INT0",         [2]  = "INT1",         [3]  = "INT2",         [4]  = "INT3",
+	[9]  = "PCINT0",       [10] = "USB_GEN",      [11] = "USB_COM",      [12] = "WDT",
+	[16] = "TIMER1_CAPT",  [17] = "TIMER1_COMPA", [18] = "TIMER1_COMPB", [19] = "TIMER1_COMPC",
+	[20] = "TIMER1_OVF",   [29] = "ADC",          [30] = "EE_READY",     [32] = "TIMER3_COMPA",
+};
+
+static avr_t*       Avr;
+static uint32_t     Frequency = DEFAULT_F_CPU;
+
+static Region_t     Regions[PROFILE_REGIONS];
+static OpenRegion_t Open[MAX_NESTING];
+static uint8_t      Depth;
+static uint32_t     Unbalanced;
+
+static Interrupt_t  Interrupts[MAX_VECTORS];
+
+static uint8_t      ControlSize = 8;
+static uint8_t      INEndpoints[8];
+static uint8_t      INEndpointCount;
+static uint32_t     Reports[8];
+
+static uint64_t UsToCycles(const uint64_t Microseconds)
+{
+	return ((Microseconds * Frequency) / 1000000);
+}
+
+static void RunUntil(const uint64_t Cycle)
+{
+	while (Avr->cycle < Cycle) {
+		int State = avr_run(Avr);
+
+		if ((State == cpu_Done) || (State == cpu_Crashed)) {
+			fprintf(stderr, "core %s at cycle %" PRIu64 "\n", ((State == cpu_Crashed) ? "crashed" : "stopped"),
+			        (uint64_t)Avr->cycle);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/** Accounts a profiling marker written to GPIOR0. */
+static void MarkerWritten(avr_t* const Core,
+                          const avr_io_addr_t Address,
+                          const uint8_t Value,
+                          void* const Param)
+{
+	uint8_t Region = (Value & ~PROFILE_LEAVE_FLAG);
+
+	Core->data[Address] = Value;
+
+	if (!Region || (Region >= PROFILE_REGIONS)) {
+		Unbalanced++;
+		return;
+	}
+
+	if (!(Value & PROFILE_LEAVE_FLAG)) {
+		if (Depth == MAX_NESTING) {
+			Unbalanced++;
+			return;
+		}
+
+		Open[Depth++] = (OpenRegion_t){.Region = Region, .Start = Core->cycle};
+		return;
+	}
+
+	if (!Depth || (Open[Depth - 1].Region != Region)) {
+		Unbalanced++;
+		return;
+	}
+
+	OpenRegion_t* Closed    = &Open[--Depth];
+	Region_t*     Stats     = &Regions[Region];
+	uint64_t      Inclusive = (Core->cycle - Closed->Start);
+	uint64_t      Self      = (Inclusive - Closed->Nested);
+
+	if (Depth)
+		Open[Depth - 1].Nested += Inclusive;
+
+	Stats->SelfMin       = (Stats->Runs ? ((Self < Stats->SelfMin) ? Self : Stats->SelfMin) : Self);
+	Stats->SelfMax       = ((Self > Stats->SelfMax) ? Self : Stats->SelfMax);
+	Stats->InclusiveMax  = ((Inclusive > Stats->InclusiveMax) ? Inclusive : Stats->InclusiveMax);
+	Stats->SelfTotal    += Self;
+	Stats->Runs++;
+}
+
+static void InterruptPending(struct avr_irq_t* const Irq,
+                             const uint32_t Value,
+                             void* const Param)
+{
+	Interrupt_t* Interrupt = Param;
+
+	if (Value) {
+		Interrupt->Pending      = true;
+		Interrupt->PendingSince = Avr->cycle;
+	} else {
+		Interrupt->Pending      = false;
+		Interrupt->ClearedAt    = Avr->cycle;
+	}
+}
+
+static void InterruptRunning(struct avr_irq_t* const Irq,
+                             const uint32_t Value,
+                             void* const Param)
+{
+	Interrupt_t* Interrupt = Param;
+	uint64_t     Latency;
+
+	/* Lowered by the RETI, the handlers do not nest */
+	if (!Value) {
+		uint64_t Cycles = (Avr->cycle - Interrupt->RunningSince);
+
+		if (!Interrupt->Running)
+			return;
+
+		Interrupt->Running      = false;
+		Interrupt->CyclesTotal += Cycles;
+		Interrupt->CyclesMax    = ((Cycles > Interrupt->CyclesMax) ? Cycles : Interrupt->CyclesMax);
+		Interrupt->Returns++;
+		return;
+	}
+
+	Interrupt->Running      = true;
+	Interrupt->RunningSince = Avr->cycle;
+
+	/* The core clears the flag as it vectors, a flag cleared by the firmware before the handler
+	 * ran is no latency sample */
+	if (!Interrupt->Pending && (Interrupt->ClearedAt != Avr->cycle))
+		return;
+
+	Latency = (Avr->cycle - Interrupt->PendingSince);
+
+	Interrupt->Pending       = false;
+	Interrupt->LatencyTotal += Latency;
+	Interrupt->LatencyMax    = ((Latency > Interrupt->LatencyMax) ? Latency : Interrupt->LatencyMax);
+	Interrupt->Runs++;
+}
+
+/** Runs a USB transfer, running the core while the device NAKs it. */
+static bool Transfer(const uint32_t Request,
+                     struct avr_io_usb* const Packet)
+{
+	struct avr_io_usb Initial  = *Packet;
+	uint64_t          Deadline = (Avr->cycle + UsToCycles(CONTROL_TIMEOUT_US));
+
+	for (;;) {
+		uint32_t Result;
+
+		*Packet = Initial;
+		Result  = (uint32_t)avr_ioctl(Avr, Request, Packet);
+
+		if (Result == 0)
+			return true;
+
+		if ((Result != AVR_IOCTL_USB_NAK) || (Avr->cycle > Deadline))
+			return false;
+
+		RunUntil(Avr->cycle + UsToCycles(100));
+	}
+}
+
+/** Runs a control transfer on endpoint 0, returns the number of bytes read or -1 on failure. OUT
+ *  requests carry no data stage.
+ */
+static int Control(const uint8_t RequestType,
+                   const uint8_t Request,
+                   const uint16_t Value,
+                   const uint16_t Index,
+                   const uint16_t Length,
+                   uint8_t* const Data)
+{
+	uint8_t           Setup[8] = {RequestType, Request, (Value & 0xFF), (Value >> 8),
+	                              (Index & 0xFF), (Index >> 8), (Length & 0xFF), (Length >> 8)};
+	uint8_t           Status[1];
+	struct avr_io_usb Packet = {.pipe = 0, .sz = sizeof(Setup), .buf = Setup};
+	int               Received = 0;
+
+	if (!Transfer(AVR_IOCTL_USB_SETUP, &Packet))
+		return -1;
+
+	if (!(RequestType & 0x80)) {
+		Packet = (struct avr_io_usb){.pipe = 0, .sz = 0, .buf = Status};
+		return (Transfer(AVR_IOCTL_USB_READ, &Packet) ? 0 : -1);
+	}
+
+	while (Received < Length) {
+		Packet = (struct avr_io_usb){.pipe = 0, .sz = (Length - Received), .buf = &Data[Received]};
+		if (!Transfer(AVR_IOCTL_USB_READ, &Packet))
+			return -1;
+
+		Received += Packet.sz;
+		if (Packet.sz < ControlSize)
+			break;
+	}
+
+	Packet = (struct avr_io_usb){.pipe = 0, .sz = 0, .buf = Status};
+	return (Transfer(AVR_IOCTL_USB_WRITE, &Packet) ? Received : -1);
+}
+
+/** Attaches and enumerates the device up to SET_CONFIGURATION and SET_IDLE, noting its IN
+ *  endpoints, as the Linux HID driver does.
+ */
+static bool Enumerate(void)
+{
+	avr_irq_t* Attached = avr_io_getirq(Avr, AVR_IOCTL_USB_GETIRQ(), USB_IRQ_ATTACH);
+	uint8_t    Descriptor[MAX_DESCRIPTOR_SIZE];
+	uint16_t   Total;
+	int        Length = 0;
+
+	avr_ioctl(Avr, AVR_IOCTL_USB_VBUS, (void*)1);
+
+	while (!Attached->value) {
+		if (Avr->cycle > UsToCycles(1000000)) {
+			fprintf(stderr, "device did not attach\n");
+			return false;
+		}
+
+		RunUntil(Avr->cycle + UsToCycles(1000));
+	}
+
+	/* Attach debounce, then the bus reset */
+	RunUntil(Avr->cycle + UsToCycles(100000));
+	avr_ioctl(Avr, AVR_IOCTL_USB_RESET, NULL);
+	RunUntil(Avr->cycle + UsToCycles(10000));
+
+	if (Control(0x80, 0x06, 0x0100, 0, 8, Descriptor) != 8) {
+		fprintf(stderr, "GET_DESCRIPTOR(device) failed\n");
+		return false;
+	}
+
+	ControlSize = Descriptor[7];
+
+	if (Control(0x00, 0x05, 1, 0, 0, NULL) < 0) {
+		fprintf(stderr, "SET_ADDRESS failed\n");
+		return false;
+	}
+
+	if (Control(0x80, 0x06, 0x0200, 0, 9, Descriptor) != 9) {
+		fprintf(stderr, "GET_DESCRIPTOR(configuration) failed\n");
+		return false;
+	}
+
+	Total = (Descriptor[2] | (Descriptor[3] << 8));
+	if ((Total > sizeof(Descriptor)) || ((Length = Control(0x80, 0x06, 0x0200, 0, Total, Descriptor)) != Total)) {
+		fprintf(stderr, "GET_DESCRIPTOR(configuration) failed\n");
+		return false;
+	}
+
+	if (Control(0x00, 0x09, Descriptor[5], 0, 0, NULL) < 0) {
+		fprintf(stderr, "SET_CONFIGURATION failed\n");
+		return false;
+	}
+
+	for (int Offset = 0; (Offset + 2) <= Length; Offset += Descriptor[Offset]) {
+		uint8_t* Item = &Descriptor[Offset];
+
+		if (Item[0] < 2)
+			break;
+
+		if ((Item[1] == 0x04) && (Control(0x21, 0x0A, 0, Item[2], 0, NULL) < 0)) {
+			fprintf(stderr, "SET_IDLE failed\n");
+			return false;
+		}
+
+		if ((Item[1] == 0x05) && (Item[2] & 0x80) && (INEndpointCount < sizeof(INEndpoints)))
+			INEndpoints[INEndpointCount++] = (Item[2] & 0x0F);
+	}
+
+	return true;
+}
+
+static void PollEndpoints(void)
+{
+	for (uint8_t i = 0; i < INEndpointCount; i++) {
+		uint8_t           Buffer[64];
+		struct avr_io_usb Packet = {.pipe = INEndpoints[i], .sz = sizeof(Buffer), .buf = Buffer};
+
+		if (avr_ioctl(Avr, AVR_IOCTL_USB_READ, &Packet) == 0)
+			Reports[INEndpoints[i]]++;
+	}
+}
+
+static void SetPort(const char Port,
+                    const uint8_t Previous,
+                    const uint8_t Value)
+{
+	for (int Pin = 0; Pin < 8; Pin++) {
+		if ((Previous ^ Value) & (1 << Pin))
+			avr_raise_irq(avr_io_getirq(Avr, AVR_IOCTL_IOPORT_GETIRQ(Port), Pin), ((Value >> Pin) & 1));
+	}
+}
+
+static void SetAnalog(const uint32_t Millivolts0,
+                      const uint32_t Millivolts1)
+{
+	avr_raise_irq(avr_io_getirq(Avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC0), Millivolts0);
+	avr_raise_irq(avr_io_getirq(Avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC1), Millivolts1);
+}
+
+/** Replays the trace from stdin, polling the IN endpoints every frame. Returns the cycles the
+ *  trace took.
+ */
+static uint64_t Replay(void)
+{
+	uint64_t Start    = Avr->cycle;
+	uint64_t NextPoll = (Start + UsToCycles(IN_OFFSET_US));
+	uint64_t End      = Start;
+	uint8_t  Pins[3]  = {0xFF, 0xFF, 0xFF};
+	char     Line[256];
+
+	for (;;) {
+		unsigned long long Time;
+		unsigned int       PinD, PinB, PinF, Millivolts0, Millivolts1;
+		int                Fields = 0;
+		uint64_t           Cycle;
+
+		if (fgets(Line, sizeof(Line), stdin) != NULL) {
+			if (Line[0] == '#')
+				continue;
+
+			Fields = sscanf(Line, "%llu %x %x %x %u %u", &Time, &PinD, &PinB, &PinF, &Millivolts0, &Millivolts1);
+			if ((Fields != 4) && (Fields != 6))
+				continue;
+
+			Cycle = (Start + UsToCycles(Time));
+		} else {
+			Cycle = (End + UsToCycles(TAIL_US));
+		}
+
+		while (NextPoll <= Cycle) {
+			RunUntil(NextPoll);
+			PollEndpoints();
+			NextPoll += UsToCycles(1000);
+		}
+
+		RunUntil(Cycle);
+
+		if (!Fields)
+			return (Avr->cycle - Start);
+
+		SetPort('D', Pins[0], PinD);
+		SetPort('B', Pins[1], PinB);
+		SetPort('F', Pins[2], PinF);
+		Pins[0] = PinD;
+		Pins[1] = PinB;
+		Pins[2] = PinF;
+
+		if (Fields == 6)
+			SetAnalog(Millivolts0, Millivolts1);
+
+		End = Cycle;
+	}
+}
+
+static void PrintResults(const char* const Firmware,
+                         const char* const Trace,
+                         const uint64_t Cycles)
+{
+	bool First = true;
+
+	printf("{\n");
+	printf("  \"firmware\": \"%s\",\n", Firmware);
+	printf("  \"trace\": \"%s\",\n", Trace);
+	printf("  \"f_cpu\": %" PRIu32 ",\n", Frequency);
+	printf("  \"cycles\": %" PRIu64 ",\n", Cycles);
+	printf("  \"unbalanced_markers\": %" PRIu32 ",\n", Unbalanced);
+
+	printf("  \"reports\": {");
+	for (uint8_t i = 0; i < INEndpointCount; i++)
+		printf("%s\"EP%d\": %" PRIu32, (i ? ", " : ""), INEndpoints[i], Reports[INEndpoints[i]]);
+	printf("},\n");
+
+	printf("  \"regions\": {");
+	for (uint8_t i = 1; i < PROFILE_REGIONS; i++) {
+		Region_t* Region = &Regions[i];
+
+		if (!Region->Runs)
+			continue;
+
+		printf("%s\n    \"%s\": {\"runs\": %" PRIu64 ", \"min\": %" PRIu64 ", \"mean\": %.1f, \"max\": %" PRIu64
+		       ", \"max_inclusive\": %" PRIu64 "}", (First ? "" : ","), RegionNames[i], Region->Runs, Region->SelfMin,
+		       ((double)Region->SelfTotal / Region->Runs), Region->SelfMax, Region->InclusiveMax);
+		First = false;
+	}
+	printf("\n  },\n");
+
+	First = true;
+	printf("  \"interrupts\": {");
+	for (uint8_t i = 1; i < MAX_VECTORS; i++) {
+		Interrupt_t* Interrupt = &Interrupts[i];
+		char         Name[16];
+
+		if (!Interrupt->Runs || !Interrupt->Returns)
+			continue;
+
+		if (VectorNames[i])
+			snprintf(Name, sizeof(Name), "%s", VectorNames[i]);
+		else
+			snprintf(Name, sizeof(Name), "vector_%d", i);
+
+		printf("%s\n    \"%s\": {\"runs\": %" PRIu64 ", \"latency_mean\": %.1f, \"latency_max\": %" PRIu64
+		       ", \"cycles_mean\": %.1f, \"cycles_max\": %" PRIu64 "}",
+		       (First ? "" : ","), Name, Interrupt->Runs, ((double)Interrupt->LatencyTotal / Interrupt->Runs),
+		       Interrupt->LatencyMax, ((double)Interrupt->CyclesTotal / Interrupt->Returns), Interrupt->CyclesMax);
+		First = false;
+	}
+	printf("\n  }\n");
+	printf("}\n");
+}
+
+int main(int argc, char* argv[])
+{
+	elf_firmware_t Firmware = {{0}};
+	const char*    Trace    = "stdin";
+	int            Option;
+	uint64_t       Cycles;
+
+	while ((Option = getopt(argc, argv, "f:t:")) != -1) {
+		switch (Option) {
+		case 'f':
+			Frequency = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			Trace = optarg;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-f f_cpu] [-t name] Joystick.elf < trace\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind != (argc - 1)) {
+		fprintf(stderr, "usage: %s [-f f_cpu] [-t name] Joystick.elf < trace\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (elf_read_firmware(argv[optind], &Firmware) != 0) {
+		fprintf(stderr, "%s: cannot read the firmware\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	/* The LUFA makefile does not embed the MCU and frequency in the ELF */
+	if (!Firmware.mmcu[0])
+		strcpy(Firmware.mmcu, "atmega32u4");
+	if (!Firmware.frequency)
+		Firmware.frequency = Frequency;
+
+	Frequency = Firmware.frequency;
+
+	if (!(Avr = avr_make_mcu_by_name(Firmware.mmcu))) {
+		fprintf(stderr, "%s: unknown MCU\n", Firmware.mmcu);
+		return EXIT_FAILURE;
+	}
+
+	avr_init(Avr);
+	avr_load_firmware(Avr, &Firmware);
+
+	avr_register_io_write(Avr, GPIOR0_ADDRESS, MarkerWritten, NULL);
+
+	for (uint8_t i = 1; i < MAX_VECTORS; i++) {
+		avr_irq_t* Irq = avr_get_interrupt_irq(Avr, i);
+
+		if (!Irq)
+			continue;
+
+		avr_irq_register_notify(&Irq[AVR_INT_IRQ_PENDING], InterruptPending, &Interrupts[i]);
+		avr_irq_register_notify(&Irq[AVR_INT_IRQ_RUNNING], InterruptRunning, &Interrupts[i]);
+	}
+
+	/* Idle inputs, all pulled up, and the analog stick centered */
+	SetPort('D', 0x00, 0xFF);
+	SetPort('B', 0x00, 0xFF);
+	SetPort('F', 0x00, 0xFF);
+	SetAnalog(2500, 2500);
+
+	if (!Enumerate())
+		return EXIT_FAILURE;
+
+	/* Only the steady state is measured, not the boot and enumeration */
+	memset(Regions, 0, sizeof(Regions));
+	memset(Interrupts, 0, sizeof(Interrupts));
+	Unbalanced = 0;
+
+	Cycles = Replay();
+
+	PrintResults(argv[optind], Trace, Cycles);
+
+	return EXIT_SUCCESS;
+}
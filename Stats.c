@@ -0,0 +1,118 @@
+/** \file
+ *
+ *  Report statistics. The report builders record whether each IN report they build is sent and,
+ *  for the reports carrying a new input transition, the time from the transition's first edge to
+ *  the endpoint commit. The latencies are kept in a log2 bucketed histogram, so the whole 0.5us to
+ *  32ms range of the Timer1 timestamps fits in a few bytes of RAM.
+ */
+
+#include "Stats.h"
+#include "Input.h"
+#include "Dial.h"
+
+static uint16_t ReportsSent;
+static uint16_t ReportsSuppressed;
+static uint16_t Latency[STATS_LATENCY_BUCKETS];
+
+/** Awake share of the last complete duty cycle window, and the window being measured. The CPU is
+ *  always awake unless the firmware sleeps between frames.
+ */
+static uint16_t ActivePermille = 1000;
+static uint32_t WindowTicks;
+static uint32_t WindowSleepTicks;
+static uint16_t LastSleepEnd;
+
+/** Starts the CPU duty cycle measurement from now. Must be called once Timer1 runs, and again when
+ *  the main loop restarts after Timer1 stopped, before the first sleep is recorded.
+ */
+void Stats_Init(void)
+{
+	LastSleepEnd = Input_GetTimestamp();
+}
+
+/** Counts an IN report built by the application.
+ *
+ *  \param[in] Sent  Boolean true if the report is committed to the endpoint, false if it is suppressed
+ */
+void Stats_RecordReport(const bool Sent)
+{
+	if (Sent)
+		ReportsSent++;
+	else
+		ReportsSuppressed++;
+}
+
+/** Adds the latency of a report being committed now to the histogram.
+ *
+ *  \param[in] EdgeTimestamp  Timer1 timestamp of the oldest input edge carried by the report
+ */
+void Stats_RecordLatency(const uint16_t EdgeTimestamp)
+{
+	uint16_t Microseconds = ((uint16_t)(Input_GetTimestamp() - EdgeTimestamp) / INPUT_TICKS_PER_US);
+	uint8_t  Bucket       = 0;
+
+	while (Microseconds >>= 1)
+		Bucket++;
+
+	if (Latency[Bucket] != UINT16_MAX)
+		Latency[Bucket]++;
+}
+
+/** Adds a sleep period to the CPU duty cycle measurement. The time between two sleeps, and each
+ *  sleep, must be shorter than the 32.768ms Timer1 period, which the Start Of Frame and debouncer
+ *  interrupts that wake the CPU guarantee.
+ *
+ *  \param[in] SleepStart  Timer1 timestamp before the CPU went to sleep
+ *  \param[in] SleepEnd    Timer1 timestamp after the CPU woke up
+ */
+void Stats_RecordSleep(const uint16_t SleepStart,
+                       const uint16_t SleepEnd)
+{
+	WindowTicks      += (uint16_t)(SleepEnd - LastSleepEnd);
+	WindowSleepTicks += (uint16_t)(SleepEnd - SleepStart);
+	LastSleepEnd      = SleepEnd;
+
+	if (WindowTicks >= STATS_DUTY_WINDOW_TICKS) {
+		ActivePermille   = (1000 - ((WindowSleepTicks * 1000) / WindowTicks));
+		WindowTicks      = 0;
+		WindowSleepTicks = 0;
+	}
+}
+
+/** Fills in the statistics feature report. */
+void Stats_GetReport(Stats_Report_t* const Report)
+{
+	Report->ReportsSent       = ReportsSent;
+	Report->ReportsSuppressed = ReportsSuppressed;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Report->FramesMissed = Input_FramesMissed;
+	}
+
+	Report->QueueOverflows   = Input_Overflows;
+	Report->DebounceTicksMax = Input_DebounceTicksMax;
+	Report->ActivePermille   = ActivePermille;
+
+	memcpy(Report->Latency, Latency, sizeof(Latency));
+
+#if defined(ANALOG_AXES)
+	uint16_t BusyTicks;
+	uint16_t WindowTicks;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		BusyTicks   = Analog_BusyTicks;
+		WindowTicks = Analog_WindowTicks;
+	}
+
+	Report->AnalogLoadPermille = (WindowTicks ? (((uint32_t)BusyTicks * 1000) / WindowTicks) : 0);
+	Report->AnalogTicksMax     = Analog_TicksMax;
+#else
+	Report->AnalogLoadPermille = 0;
+	Report->AnalogTicksMax     = 0;
+#endif
+
+	Report->DialReportsEmitted  = Dial_ReportsEmitted;
+	Report->DialReportsFiltered = Dial_ReportsFiltered;
+}
@@ -0,0 +1,49 @@
+/** \file
+ *
+ *  Header file for Stats.c.
+ */
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+/* Includes: */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Macros: */
+/** Number of latency histogram buckets, bucket n counts the latencies of 2^n to 2^(n+1)-1 microseconds
+ *  (bucket 0 also counts zero), the last bucket covers the whole Timer1 range of 32.768ms.
+ */
+#define STATS_LATENCY_BUCKETS    16
+
+/** Length of the CPU duty cycle measurement window, in Timer1 ticks (one second). */
+#define STATS_DUTY_WINDOW_TICKS  (1000000UL * INPUT_TICKS_PER_US)
+
+/* Type Defines: */
+/** Statistics feature report, all fields little endian. The counters wrap around, readers are
+ *  expected to compare two reads.
+ */
+typedef struct {
+	uint16_t ReportsSent;       /**< IN reports committed to an endpoint */
+	uint16_t ReportsSuppressed; /**< IN reports built but not sent, as nothing changed */
+	uint16_t FramesMissed;      /**< Frames whose input snapshot was replaced before the reports were built */
+	uint8_t  QueueOverflows;    /**< Transitions merged because an input queue was full, see \ref Input_Overflows */
+	uint8_t  DebounceTicksMax;  /**< Longest debouncer run in Timer1 ticks, see \ref Input_DebounceTicksMax */
+	uint16_t ActivePermille;    /**< Share of the time the CPU was awake over the last second, in 1/1000 */
+	uint16_t Latency[STATS_LATENCY_BUCKETS]; /**< Edge to endpoint commit latency histogram, saturating */
+	uint16_t AnalogLoadPermille; /**< Share of the time spent in the ADC interrupt, in 1/1000, zero without ANALOG_AXES */
+	uint8_t  AnalogTicksMax;     /**< Longest ADC interrupt run in Timer1 ticks, see \ref Analog_TicksMax */
+	uint16_t DialReportsEmitted; /**< Reports built with dial motion, see \ref Dial_ReportsEmitted */
+	uint16_t DialReportsFiltered; /**< Reports with dial motion the jitter filter held back, see \ref Dial_ReportsFiltered */
+} Stats_Report_t;
+
+/* Function Prototypes: */
+void Stats_Init(void);
+void Stats_RecordReport(const bool Sent);
+void Stats_RecordLatency(const uint16_t EdgeTimestamp);
+void Stats_RecordSleep(const uint16_t SleepStart,
+                       const uint16_t SleepEnd);
+void Stats_GetReport(Stats_Report_t* const Report);
+
+#endif
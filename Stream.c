@@ -0,0 +1,185 @@
+/** \file
+ *
+ *  Raw port sampling for the RAW_STREAM build. The Timer1 compare C interrupt reads PIND, PINB and
+ *  PINF at \ref STREAM_SAMPLE_HZ into a ring buffer, which the report builder of the stream
+ *  interface drains into a delta encoded \ref Stream_Report_t once per USB frame, when its endpoint
+ *  has a free bank. The samples share the time base of the input timestamps: like Timer1, the stream stands
+ *  still while the device is powered down in USB suspend.
+ *
+ *  A host that does not read the stream lets the buffer fill up. The interrupt then stops storing
+ *  samples until the next report discards the buffered ones, so that the samples are lost in a
+ *  single piece, which the sample index of that report shows.
+ */
+
+#if defined(RAW_STREAM)
+
+#include "Stream.h"
+#include "Profile.h"
+
+/** Ports read by one run of the sampling interrupt. */
+typedef struct {
+	uint8_t PinD;
+	uint8_t PinB;
+	uint8_t PinF;
+} StreamSample_t;
+
+/** Samples not sent yet, from Tail up to Head. Head is only written by the interrupt, Tail by the
+ *  report builder.
+ */
+static StreamSample_t   Samples[STREAM_BUFFER_SAMPLES];
+static volatile uint8_t Head;
+static volatile uint8_t Tail;
+
+/** Index of the next sample, counted whether or not it is stored. */
+static volatile uint16_t NextIndex;
+
+/** Set by the interrupt when it found the buffer full, until the report builder empties it. */
+static volatile bool Overrun;
+
+/** Starts sampling from an empty buffer, after the Timer1 time base has been started. The sample
+ *  index carries on from where \ref Stream_Stop() left it.
+ */
+void Stream_Init(void)
+{
+	Tail    = Head;
+	Overrun = false;
+
+	OCR1C   = (TCNT1 + STREAM_SAMPLE_TICKS);
+	TIFR1   = (1 << OCF1C);
+	TIMSK1 |= (1 << OCIE1C);
+}
+
+/** Stops sampling, the buffered samples are discarded by the next \ref Stream_Init(). */
+void Stream_Stop(void)
+{
+	TIMSK1 &= ~(1 << OCIE1C);
+}
+
+/** Encodes the buffered samples into the given report, as many as it holds.
+ *
+ *  \param[out] Report  Report to fill, its unused Data bytes are left as they are
+ *
+ *  \return Size of the report, or zero if there is no sample to send
+ */
+uint16_t Stream_CreateReport(Stream_Report_t* const Report)
+{
+	StreamSample_t Previous;
+	uint8_t        Last;
+	uint8_t        Next;
+	uint8_t        Run    = 0;
+	uint8_t        Length = 0;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (Overrun) {
+			Tail    = Head;
+			Overrun = false;
+		}
+
+		/* Since the buffer was last emptied no sample was dropped, the buffered ones end right
+		 * before the next index */
+		Last          = Head;
+		Report->Index = (NextIndex - (uint8_t)(Last - Tail));
+	}
+
+	if (Tail == Last)
+		return 0;
+
+	Previous     = Samples[Tail % STREAM_BUFFER_SAMPLES];
+	Report->PinD = Previous.PinD;
+	Report->PinB = Previous.PinB;
+	Report->PinF = Previous.PinF;
+
+	for (Next = (Tail + 1); Next != Last; Next++) {
+		StreamSample_t* Sample = &Samples[Next % STREAM_BUFFER_SAMPLES];
+		uint8_t         Token  = 0;
+		uint8_t         Size   = 1;
+
+		if (Sample->PinD != Previous.PinD) {
+			Token |= STREAM_TOKEN_PIND;
+			Size++;
+		}
+		if (Sample->PinB != Previous.PinB) {
+			Token |= STREAM_TOKEN_PINB;
+			Size++;
+		}
+		if (Sample->PinF != Previous.PinF) {
+			Token |= STREAM_TOKEN_PINF;
+			Size++;
+		}
+
+		if (!Token) {
+			/* The run and this sample fill a token */
+			if (Run == STREAM_TOKEN_RUN_MASK) {
+				Report->Data[Length++] = STREAM_TOKEN_RUN_MASK;
+				Run = 0;
+				continue;
+			}
+
+			/* A run holds the room of its token from its first sample on */
+			if (!Run && (Length == sizeof(Report->Data)))
+				break;
+
+			Run++;
+			continue;
+		}
+
+		if ((Length + Size) > sizeof(Report->Data))
+			break;
+
+		Report->Data[Length++] = (Token | Run);
+		if (Token & STREAM_TOKEN_PIND)
+			Report->Data[Length++] = (Sample->PinD ^ Previous.PinD);
+		if (Token & STREAM_TOKEN_PINB)
+			Report->Data[Length++] = (Sample->PinB ^ Previous.PinB);
+		if (Token & STREAM_TOKEN_PINF)
+			Report->Data[Length++] = (Sample->PinF ^ Previous.PinF);
+
+		Previous = *Sample;
+		Run      = 0;
+	}
+
+	/* A token without changed ports counts its last sample as unchanged too */
+	if (Run)
+		Report->Data[Length++] = (Run - 1);
+
+	Report->Length = Length;
+	Tail           = Next;
+
+	return sizeof(Stream_Report_t);
+}
+
+ISR(TIMER1_COMPC_vect)
+{
+	uint8_t SampleD;
+	uint8_t SampleB;
+	uint8_t SampleF;
+	uint8_t Position;
+
+	PROFILE_ENTER(PROFILE_StreamSample);
+
+	SampleD  = PIND;
+	SampleB  = PINB;
+	SampleF  = PINF;
+	Position = Head;
+
+	OCR1C += STREAM_SAMPLE_TICKS;
+
+	if ((uint8_t)(Position - Tail) == STREAM_BUFFER_SAMPLES)
+		Overrun = true;
+
+	if (!Overrun) {
+		StreamSample_t* Sample = &Samples[Position % STREAM_BUFFER_SAMPLES];
+
+		Sample->PinD = SampleD;
+		Sample->PinB = SampleB;
+		Sample->PinF = SampleF;
+		Head         = (Position + 1);
+	}
+
+	NextIndex++;
+
+	PROFILE_LEAVE(PROFILE_StreamSample);
+}
+
+#endif
@@ -0,0 +1,77 @@
+/** \file
+ *
+ *  Header file for Stream.c.
+ */
+
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+/* Includes: */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <util/atomic.h>
+
+#include <LUFA/Common/Common.h>
+
+/* Macros: */
+/** Rate at which the RAW_STREAM build samples the input ports, in Hz. Timer1 must count a whole
+ *  number of ticks per sample.
+ */
+#if !defined(STREAM_SAMPLE_HZ)
+#define STREAM_SAMPLE_HZ         8000
+#endif
+
+#if (STREAM_SAMPLE_HZ < 1000) || (STREAM_SAMPLE_HZ > 16000) || (((F_CPU / 8) % STREAM_SAMPLE_HZ) != 0)
+	#error STREAM_SAMPLE_HZ must divide the Timer1 clock and be between 1000 and 16000.
+#endif
+
+/** Interval between two samples in Timer1 ticks. */
+#define STREAM_SAMPLE_TICKS      ((F_CPU / 8) / STREAM_SAMPLE_HZ)
+
+/** Number of samples the buffer holds between two reports, a power of two up to 128. At the default
+ *  rate the host may fall 8ms behind before samples are lost.
+ */
+#define STREAM_BUFFER_SAMPLES    64
+
+/** Size of the raw stream report, a full 64 byte endpoint bank. */
+#define STREAM_REPORT_SIZE       64
+
+/** Size of the report header, up to the first sample's ports. */
+#define STREAM_HEADER_SIZE       6
+
+/** Token layout of \ref Stream_Report_t::Data: the ports that changed in the token's last sample,
+ *  and the number of unchanged samples before it.
+ */
+#define STREAM_TOKEN_PIND        (1 << 5)
+#define STREAM_TOKEN_PINB        (1 << 6)
+#define STREAM_TOKEN_PINF        (1 << 7)
+#define STREAM_TOKEN_RUN_MASK    0x1F
+
+/* Type Defines: */
+/** Raw stream report, a batch of consecutive port samples. The first sample is sent as is, the
+ *  following ones as tokens in Data. Each token is a byte holding the STREAM_TOKEN_* bits of the
+ *  ports that changed and, in its low five bits, a run of 0 to 31 samples equal to the previous
+ *  one, followed by one XOR mask byte per changed port in the order PIND, PINB, PINF. A token thus
+ *  stands for the run and one more sample, the previous one with the masks applied; without a
+ *  changed port that sample is unchanged too, so a token alone covers up to 32 idle samples.
+ *
+ *  A gap in the sample indices of consecutive reports is the number of samples lost because the
+ *  host did not read the stream.
+ */
+typedef struct {
+	uint16_t Index;  /**< Index of the first sample, counting every sample period since power-up */
+	uint8_t  Length; /**< Bytes of Data used */
+	uint8_t  PinD;   /**< Ports of the first sample */
+	uint8_t  PinB;
+	uint8_t  PinF;
+	uint8_t  Data[STREAM_REPORT_SIZE - STREAM_HEADER_SIZE];
+} Stream_Report_t;
+
+/* Function Prototypes: */
+void     Stream_Init(void);
+void     Stream_Stop(void);
+uint16_t Stream_CreateReport(Stream_Report_t* const Report);
+
+#endif
@@ -0,0 +1,351 @@
+/** \file
+ *
+ *  Tests of tron-hidd without a controller. SOCK_SEQPACKET Unix sockets stand in for the hidraw
+ *  nodes, see tron-hidd.c: the test starts the daemon on them, sends it reports of each layout,
+ *  repeats and malformed ones, and checks the states it publishes in its ring, the ring wrapping
+ *  and the daemon's exit. It exits non-zero if any check fails.
+ *
+ *  \code
+ *  tron-hidd-check ./tron-hidd
+ *  \endcode
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "tron-ring.h"
+
+/** Time the daemon gets to publish a state or to exit, in milliseconds. */
+#define CHECK_TIMEOUT_MS         2000
+
+/** Largest number of sockets standing in for device nodes, MAX_DEVICES in tron-hidd. */
+#define CHECK_DEVICES            2
+
+#define CHECK(Condition)         Check((Condition), #Condition, __LINE__)
+
+/** Daemon under test, its ring and the sockets standing in for its device nodes. */
+typedef struct {
+	pid_t       Process;
+	char        Name[32];
+	TronRing_t* Ring;
+	int         Devices;
+	int         Device[CHECK_DEVICES];
+	uint64_t    Head;
+} Daemon_t;
+
+static const char* DaemonPath;
+static char        Directory[] = "/tmp/tron-hidd-check.XXXXXX";
+
+static uint32_t Checks;
+static uint32_t Failures;
+
+static void Check(const bool Passed,
+                  const char* const Condition,
+                  const int Line)
+{
+	Checks++;
+
+	if (!Passed) {
+		fprintf(stderr, "tron-hidd-check.c:%d: check failed: %s\n", Line, Condition);
+		Failures++;
+	}
+}
+
+static void Pause(void)
+{
+	struct timespec Interval = {.tv_nsec = 1000000};
+
+	nanosleep(&Interval, NULL);
+}
+
+/** Creates a listening socket at the given path in the test directory. */
+static int Listen(const char* const Path)
+{
+	struct sockaddr_un Address = {.sun_family = AF_UNIX};
+	int                Socket;
+
+	snprintf(Address.sun_path, sizeof(Address.sun_path), "%s/%s", Directory, Path);
+
+	if (((Socket = socket(AF_UNIX, SOCK_SEQPACKET, 0)) < 0) ||
+	    (bind(Socket, (struct sockaddr*)&Address, sizeof(Address)) < 0) ||
+	    (listen(Socket, 1) < 0))
+	{
+		perror(Address.sun_path);
+		exit(EXIT_FAILURE);
+	}
+
+	return Socket;
+}
+
+/** Starts the daemon with the given options on the given number of sockets, accepts its
+ *  connections and maps its ring.
+ */
+static void Start(Daemon_t* const Daemon,
+                  const int Devices,
+                  char* const Options[])
+{
+	int   Listening[CHECK_DEVICES];
+	char  Paths[CHECK_DEVICES][sizeof(((struct sockaddr_un*)0)->sun_path)];
+	char* Arguments[16];
+	int   Count = 0;
+
+	memset(Daemon, 0, sizeof(*Daemon));
+	snprintf(Daemon->Name, sizeof(Daemon->Name), "/tron-check-%d", (int)getpid());
+	shm_unlink(Daemon->Name);
+
+	Arguments[Count++] = (char*)DaemonPath;
+	Arguments[Count++] = "-n";
+	Arguments[Count++] = Daemon->Name;
+
+	while (*Options)
+		Arguments[Count++] = *Options++;
+
+	for (int i = 0; i < Devices; i++) {
+		char Path[16];
+
+		snprintf(Path, sizeof(Path), "device%d", i);
+		snprintf(Paths[i], sizeof(Paths[i]), "%s/%s", Directory, Path);
+
+		Listening[i]       = Listen(Path);
+		Arguments[Count++] = Paths[i];
+	}
+
+	Arguments[Count] = NULL;
+
+	if (!(Daemon->Process = fork())) {
+		execv(DaemonPath, Arguments);
+		perror(DaemonPath);
+		_exit(127);
+	}
+
+	for (int i = 0; i < Devices; i++) {
+		Daemon->Device[i] = accept(Listening[i], NULL, NULL);
+		close(Listening[i]);
+		unlink(Paths[i]);
+	}
+
+	Daemon->Devices = Devices;
+
+	/* The daemon creates the ring once its devices are open */
+	for (int Waited = 0; !(Daemon->Ring = TronRing_Open(Daemon->Name)) && (Waited < CHECK_TIMEOUT_MS); Waited++)
+		Pause();
+
+	if (!Daemon->Ring) {
+		fprintf(stderr, "%s: ring %s not created\n", DaemonPath, Daemon->Name);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/** Waits for the daemon to exit, returning its exit status, or -1 if it was killed or did not exit. */
+static int Stop(Daemon_t* const Daemon)
+{
+	int Status;
+
+	for (int Waited = 0; Waited < CHECK_TIMEOUT_MS; Waited++) {
+		if (waitpid(Daemon->Process, &Status, WNOHANG) == Daemon->Process) {
+			for (int i = 0; i < Daemon->Devices; i++)
+				close(Daemon->Device[i]);
+
+			TronRing_Close(Daemon->Ring);
+
+			return (WIFEXITED(Status) ? WEXITSTATUS(Status) : -1);
+		}
+
+		Pause();
+	}
+
+	kill(Daemon->Process, SIGKILL);
+	waitpid(Daemon->Process, &Status, 0);
+
+	return -1;
+}
+
+/** Sends a report on the socket standing in for the given device node. */
+static void Send(Daemon_t* const Daemon,
+                 const int Device,
+                 const void* const Report,
+                 const size_t Length)
+{
+	if (send(Daemon->Device[Device], Report, Length, 0) != (ssize_t)Length) {
+		perror("send");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/** Sends a report expected to publish a state, and reads that state. The states of the reports
+ *  sent before it that must not publish one are checked by the sequence number.
+ */
+static bool SendState(Daemon_t* const Daemon,
+                      const int Device,
+                      const void* const Report,
+                      const size_t Length,
+                      TronState_t* const State)
+{
+	Send(Daemon, Device, Report, Length);
+	Daemon->Head++;
+
+	for (int Waited = 0; (TronRing_Head(Daemon->Ring) < Daemon->Head) && (Waited < CHECK_TIMEOUT_MS); Waited++)
+		Pause();
+
+	CHECK(TronRing_Head(Daemon->Ring) == Daemon->Head);
+
+	if (!TronRing_Latest(Daemon->Ring, State))
+		return false;
+
+	CHECK(State->Sequence == Daemon->Head);
+
+	return (State->Sequence == Daemon->Head);
+}
+
+static void CheckPlayer(const TronState_t* const State,
+                        const int Player,
+                        const int16_t X,
+                        const int16_t Y,
+                        const uint8_t Buttons)
+{
+	CHECK(State->Player[Player].X == X);
+	CHECK(State->Player[Player].Y == Y);
+	CHECK(State->Player[Player].Buttons == Buttons);
+}
+
+/** Checks the mouse and joystick interfaces of the default build, the reports repeating the state
+ *  or not from the controller, and the ring wrapping around.
+ */
+static void CheckInterfaces(void)
+{
+	static const uint8_t Joystick[]      = {0x01, 0xFF, 0x00, 0x01};
+	static const uint8_t JoystickOther[] = {0x02, 0x01, 0x01, 0x00};
+	static const uint8_t Mouse[]         = {0x00, 0x00, 0x05};
+	static const uint8_t MouseBack[]     = {0x00, 0x00, 0xFD};
+	static const uint8_t MouseRest[]     = {0x00, 0x00, 0x00};
+	static const uint8_t Analog[]        = {0x01, 0x00, 0x02, 0x00, 0xFE, 0x04};
+	static const uint8_t Unknown[]       = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+	Daemon_t             Daemon;
+	TronState_t          State;
+	TronState_t          Oldest;
+	uint64_t             Timestamp;
+
+	Start(&Daemon, 2, (char*[]){NULL});
+
+	if (SendState(&Daemon, 1, Joystick, sizeof(Joystick), &State)) {
+		CHECK(State.Source == TRON_SOURCE_JOYSTICK);
+		CHECK(State.Players == 1);
+		CheckPlayer(&State, 0, -1, 0, 0x01);
+		CHECK(State.Dial == 0);
+		CHECK(State.EdgeUS == 0);
+	}
+
+	Timestamp = State.Timestamp;
+
+	/* An idle repeat, then the dial on the mouse interface */
+	Send(&Daemon, 1, Joystick, sizeof(Joystick));
+	if (SendState(&Daemon, 0, Mouse, sizeof(Mouse), &State)) {
+		CHECK(State.Source == TRON_SOURCE_MOUSE);
+		CheckPlayer(&State, 0, -1, 0, 0x01);
+		CHECK(State.Dial == 5);
+		CHECK(State.Timestamp >= Timestamp);
+	}
+
+	/* A report of another ID, one of no known length and a mouse report without motion */
+	Send(&Daemon, 1, JoystickOther, sizeof(JoystickOther));
+	Send(&Daemon, 1, Unknown, sizeof(Unknown));
+	Send(&Daemon, 0, MouseRest, sizeof(MouseRest));
+	if (SendState(&Daemon, 0, MouseBack, sizeof(MouseBack), &State)) {
+		CheckPlayer(&State, 0, -1, 0, 0x01);
+		CHECK(State.Dial == 2);
+	}
+
+	if (SendState(&Daemon, 1, Analog, sizeof(Analog), &State)) {
+		CHECK(State.Source == TRON_SOURCE_JOYSTICK);
+		CheckPlayer(&State, 0, 512, -512, 0x04);
+		CHECK(State.Dial == 2);
+	}
+
+	/* More states than the ring holds, the oldest are overwritten */
+	for (int i = 0; i < (TRON_RING_SLOTS + 8); i++) {
+		uint8_t Report[] = {0x01, 0x00, 0x00, (uint8_t)(i & 0x01)};
+
+		SendState(&Daemon, 1, Report, sizeof(Report), &State);
+	}
+
+	CheckPlayer(&State, 0, 0, 0, ((TRON_RING_SLOTS + 7) & 0x01));
+	CHECK(!TronRing_Read(Daemon.Ring, 1, &Oldest));
+	CHECK(!TronRing_Read(Daemon.Ring, (Daemon.Head - TRON_RING_SLOTS), &Oldest));
+	CHECK(TronRing_Read(Daemon.Ring, (Daemon.Head - TRON_RING_SLOTS + 1), &Oldest));
+	CHECK(Oldest.Timestamp <= State.Timestamp);
+
+	/* A stopped daemon removes its ring, the mapping stays readable */
+	kill(Daemon.Process, SIGTERM);
+	CHECK(TronRing_Latest(Daemon.Ring, &State));
+	CHECK(Stop(&Daemon) == EXIT_SUCCESS);
+	CHECK((shm_open(Daemon.Name, O_RDONLY, 0) < 0) && (errno == ENOENT));
+}
+
+/** Checks the single interface of a two player COMBINED_REPORT build with the edge time, and the
+ *  daemon failing when the device goes away.
+ */
+static void CheckController(void)
+{
+	static const uint8_t Controller[] = {0x01, 0x01, 0xFF, 0x02, 0x00, 0x01, 0x05, 0xFE, 0x34, 0x12};
+	static const uint8_t Rest[]       = {0x01, 0x01, 0xFF, 0x02, 0x00, 0x01, 0x05, 0x00, 0x00, 0x00};
+	Daemon_t             Daemon;
+	TronState_t          State;
+
+	Start(&Daemon, 1, (char*[]){"-p", "2", "-e", NULL});
+
+	if (SendState(&Daemon, 0, Controller, sizeof(Controller), &State)) {
+		CHECK(State.Source == TRON_SOURCE_CONTROLLER);
+		CHECK(State.Players == 2);
+		CheckPlayer(&State, 0, 1, -1, 0x02);
+		CheckPlayer(&State, 1, 0, 1, 0x05);
+		CHECK(State.Dial == -2);
+		CHECK(State.EdgeUS == 0x1234);
+	}
+
+	/* The joystick part of a report repeated for the dial only, then the dial going back */
+	Send(&Daemon, 0, Rest, sizeof(Rest));
+	if (SendState(&Daemon, 0, Controller, sizeof(Controller), &State))
+		CHECK(State.Dial == -4);
+
+	/* The controller is unplugged */
+	close(Daemon.Device[0]);
+	Daemon.Devices = 0;
+	CHECK(Stop(&Daemon) == EXIT_FAILURE);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s path/to/tron-hidd\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	DaemonPath = argv[1];
+
+	if (!mkdtemp(Directory)) {
+		perror(Directory);
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	CheckInterfaces();
+	CheckController();
+
+	rmdir(Directory);
+
+	fprintf(stderr, "%" PRIu32 " checks, %" PRIu32 " failed\n", Checks, Failures);
+
+	return (Failures ? EXIT_FAILURE : EXIT_SUCCESS);
+}
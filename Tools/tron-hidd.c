@@ -0,0 +1,303 @@
+/** \file
+ *
+ *  Reads the controller's input reports through Linux hidraw and publishes the merged state in
+ *  a shared memory ring for game processes, see tron-ring.h for the client side.
+ *
+ *  \code
+ *  tron-hidd [-p players] [-e] /dev/hidraw2 /dev/hidraw3
+ *  \endcode
+ *
+ *  The device paths are the hidraw nodes of the mouse and joystick interfaces, in any order, or
+ *  the single node of a COMBINED_REPORT build; -p gives the INPUT_PLAYERS of the build, 1 by
+ *  default. The reports are told apart by their length, which differs for each layout in
+ *  Joystick.h:
+ *
+ *  - 3 bytes: mouse report, the dial in the Y axis;
+ *  - 1 + 3 bytes per player: joystick report ID, then 8-bit X and Y and the buttons of each player;
+ *  - 1 + 5 bytes per player: joystick report of an ANALOG_AXES build, with 16-bit X and Y;
+ *  - one byte more: controller report of a COMBINED_REPORT build, the joystick report and the dial.
+ *
+ *  With -e, for an EDGE_TIMESTAMP build, the joystick and controller reports end with two more
+ *  bytes: the time from the report's earliest input edge to the start of the frame it was built
+ *  for, which is published with the state so that clients can place the input within the frame.
+ *
+ *  A device is read until it fails, e.g. when the controller is unplugged; the daemon then exits
+ *  with an error so that its supervisor restarts it once the nodes are back.
+ *
+ *  A device path may also name a listening Unix socket of type SOCK_SEQPACKET, which keeps the
+ *  report boundaries like hidraw does: the daemon connects to it and reads one report per packet.
+ *  This stands in for the controller when testing the daemon and its clients without hardware.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "tron-ring.h"
+
+/** Report ID of the joystick and controller input reports, HID_REPORTID_Joystick in the firmware. */
+#define JOYSTICK_REPORT_ID       0x01
+
+/** Largest number of device nodes, the mouse and joystick interfaces. */
+#define MAX_DEVICES              2
+
+/** Largest report read, anything longer is not one of the controller's input reports. */
+#define MAX_REPORT_SIZE          64
+
+static volatile sig_atomic_t Stopping;
+
+/** Number of players in the joystick reports. */
+static uint8_t Players = 1;
+
+/** Set when the joystick and controller reports end with the edge time. */
+static bool EdgeTime;
+
+static void Stop(int Signal)
+{
+	Stopping = 1;
+}
+
+static int16_t GetLE16(const uint8_t* const Data)
+{
+	return (int16_t)(Data[0] | (Data[1] << 8));
+}
+
+static uint64_t Now(void)
+{
+	struct timespec Time;
+
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+
+	return (((uint64_t)Time.tv_sec * 1000000000) + Time.tv_nsec);
+}
+
+/** Opens a hidraw node, or connects to the Unix socket standing in for one. */
+static int OpenDevice(const char* const Path)
+{
+	struct sockaddr_un Address = {.sun_family = AF_UNIX};
+	struct stat        Status;
+	int                Device;
+
+	if ((stat(Path, &Status) < 0) || !S_ISSOCK(Status.st_mode))
+		return open(Path, O_RDONLY);
+
+	if (strlen(Path) >= sizeof(Address.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	strcpy(Address.sun_path, Path);
+
+	if ((Device = socket(AF_UNIX, SOCK_SEQPACKET, 0)) < 0)
+		return -1;
+
+	if (connect(Device, (struct sockaddr*)&Address, sizeof(Address)) < 0) {
+		close(Device);
+		return -1;
+	}
+
+	return Device;
+}
+
+/** Creates the shared memory object of the given name and maps the ring in it. */
+static TronRing_t* CreateRing(const char* const Name)
+{
+	TronRing_t* Ring;
+	int         Object = shm_open(Name, (O_RDWR | O_CREAT | O_TRUNC), 0644);
+
+	if (Object < 0) {
+		fprintf(stderr, "%s: %s\n", Name, strerror(errno));
+		return NULL;
+	}
+
+	if (ftruncate(Object, sizeof(TronRing_t)) < 0) {
+		fprintf(stderr, "%s: %s\n", Name, strerror(errno));
+		close(Object);
+		return NULL;
+	}
+
+	Ring = mmap(NULL, sizeof(TronRing_t), (PROT_READ | PROT_WRITE), MAP_SHARED, Object, 0);
+	close(Object);
+
+	if (Ring == MAP_FAILED) {
+		fprintf(stderr, "%s: %s\n", Name, strerror(errno));
+		return NULL;
+	}
+
+	Ring->Slots   = TRON_RING_SLOTS;
+	Ring->Version = TRON_RING_VERSION;
+
+	/* Clients check the magic number last */
+	__atomic_store_n(&Ring->Magic, TRON_RING_MAGIC, __ATOMIC_RELEASE);
+
+	return Ring;
+}
+
+/** Appends a state to the ring, overwriting the oldest. */
+static void Publish(TronRing_t* const Ring,
+                    const TronState_t* const State)
+{
+	TronSlot_t* Slot = &Ring->Slot[(State->Sequence - 1) & (TRON_RING_SLOTS - 1)];
+
+	__atomic_store_n(&Slot->Lock, (Slot->Lock + 1), __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	Slot->State = *State;
+
+	__atomic_store_n(&Slot->Lock, (Slot->Lock + 1), __ATOMIC_RELEASE);
+	__atomic_store_n(&Ring->Head, State->Sequence, __ATOMIC_RELEASE);
+}
+
+/** Merges a report into the state, returns false if the report is not an input report of the
+ *  controller or changes nothing.
+ */
+static bool DecodeReport(TronState_t* const State,
+                         const uint8_t* const Report,
+                         const int ReportLength)
+{
+	TronState_t Previous = *State;
+	int         Digital  = (1 + (3 * Players));
+	int         Analog   = (1 + (5 * Players));
+	int8_t      Dial     = 0;
+	int         Length   = ReportLength;
+
+	State->EdgeUS = 0;
+
+	if (EdgeTime && (Length > 3)) {
+		State->EdgeUS = (uint16_t)GetLE16(&Report[Length - 2]);
+		Length       -= 2;
+	}
+
+	if (Length == 3) {
+		Dial          = (int8_t)Report[2];
+		State->Source = TRON_SOURCE_MOUSE;
+	} else if ((Length == Digital) || (Length == (Digital + 1))) {
+		if (Report[0] != JOYSTICK_REPORT_ID)
+			return false;
+
+		for (int i = 0; i < Players; i++) {
+			State->Player[i].X       = (int8_t)Report[1 + (3 * i)];
+			State->Player[i].Y       = (int8_t)Report[2 + (3 * i)];
+			State->Player[i].Buttons = Report[3 + (3 * i)];
+		}
+
+		State->Source = ((Length != Digital) ? TRON_SOURCE_CONTROLLER : TRON_SOURCE_JOYSTICK);
+	} else if ((Length == Analog) || (Length == (Analog + 1))) {
+		if (Report[0] != JOYSTICK_REPORT_ID)
+			return false;
+
+		for (int i = 0; i < Players; i++) {
+			State->Player[i].X       = GetLE16(&Report[1 + (5 * i)]);
+			State->Player[i].Y       = GetLE16(&Report[3 + (5 * i)]);
+			State->Player[i].Buttons = Report[5 + (5 * i)];
+		}
+
+		State->Source = ((Length != Analog) ? TRON_SOURCE_CONTROLLER : TRON_SOURCE_JOYSTICK);
+	} else {
+		return false;
+	}
+
+	if (State->Source == TRON_SOURCE_CONTROLLER)
+		Dial = (int8_t)Report[Length - 1];
+
+	State->Dial += Dial;
+
+	/* Idle repeats and the joystick part of a report sent for the dial only */
+	return (Dial || memcmp(State->Player, Previous.Player, sizeof(State->Player)));
+}
+
+int main(int argc, char* argv[])
+{
+	const char*    Name = TRON_RING_NAME;
+	int            Option;
+	int            Devices = 0;
+	struct pollfd  Poll[MAX_DEVICES];
+	TronRing_t*    Ring;
+	TronState_t    State = {0};
+	bool           Failed = false;
+
+	while ((Option = getopt(argc, argv, "n:p:e")) != -1) {
+		switch (Option) {
+		case 'e':
+			EdgeTime = true;
+			break;
+		case 'n':
+			Name = optarg;
+			break;
+		case 'p':
+			Players = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n /name] [-p players] [-e] /dev/hidrawN [/dev/hidrawM]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ((optind == argc) || ((argc - optind) > MAX_DEVICES) || (Players < 1) || (Players > TRON_MAX_PLAYERS)) {
+		fprintf(stderr, "usage: %s [-n /name] [-p players] [-e] /dev/hidrawN [/dev/hidrawM]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	State.Players = Players;
+
+	for (; optind < argc; optind++, Devices++) {
+		if ((Poll[Devices].fd = OpenDevice(argv[optind])) < 0) {
+			fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+			return EXIT_FAILURE;
+		}
+
+		Poll[Devices].events = POLLIN;
+	}
+
+	if (!(Ring = CreateRing(Name)))
+		return EXIT_FAILURE;
+
+	signal(SIGINT, Stop);
+	signal(SIGTERM, Stop);
+
+	while (!Stopping && !Failed) {
+		if (poll(Poll, Devices, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+
+			perror("poll");
+			break;
+		}
+
+		for (int i = 0; i < Devices; i++) {
+			uint8_t Report[MAX_REPORT_SIZE];
+			int     Length;
+
+			if (!Poll[i].revents)
+				continue;
+
+			if ((Length = read(Poll[i].fd, Report, sizeof(Report))) <= 0) {
+				fprintf(stderr, "device %d: %s\n", (i + 1), (Length ? strerror(errno) : "closed"));
+				Failed = true;
+				break;
+			}
+
+			if (!DecodeReport(&State, Report, Length))
+				continue;
+
+			State.Timestamp = Now();
+			State.Sequence++;
+
+			Publish(Ring, &State);
+		}
+	}
+
+	shm_unlink(Name);
+
+	return (Stopping ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,168 @@
+/** \file
+ *
+ *  Shared memory ring published by tron-hidd, for game processes to include. The daemon merges the
+ *  reports of the controller's interfaces into one state and appends each change to a ring of
+ *  \ref TRON_RING_SLOTS states in a POSIX shared memory object. Clients map the object read-only
+ *  and read the states in place: there is no socket, no system call per state and no copy beyond
+ *  the state itself.
+ *
+ *  Each slot is guarded by a sequence lock. The daemon makes the slot's counter odd, writes the
+ *  state and makes it even again, then advances the ring head; a reader that sees an odd counter,
+ *  or a counter that changed while it read the state, retries or reports the state as overwritten.
+ *  The daemon never waits for a reader, so a client that falls more than a ring behind loses the
+ *  oldest states, which it can tell from the state sequence numbers.
+ *
+ *  \code
+ *  TronRing_t* Ring = TronRing_Open(TRON_RING_NAME);
+ *  TronState_t State;
+ *
+ *  if (Ring && TronRing_Latest(Ring, &State))
+ *  	printf("%d %d %02x %d\n", State.Player[0].X, State.Player[0].Y, State.Player[0].Buttons, State.Dial);
+ *  \endcode
+ */
+
+#ifndef _TRON_RING_H_
+#define _TRON_RING_H_
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/** Default name of the shared memory object, tron-hidd -n picks another. */
+#define TRON_RING_NAME           "/tron"
+
+/** Identifies the object and its layout, a client must not read a ring of another version. */
+#define TRON_RING_MAGIC          0x4E525454
+#define TRON_RING_VERSION        2
+
+/** Largest number of players in a state, INPUT_PLAYERS in the firmware. */
+#define TRON_MAX_PLAYERS         2
+
+/** Number of states kept in the ring, a power of two. */
+#define TRON_RING_SLOTS          64
+
+/** Report that last changed a state, \ref TronState_t::Source. */
+#define TRON_SOURCE_MOUSE        0x01 /**< Dial of the mouse interface */
+#define TRON_SOURCE_JOYSTICK     0x02 /**< Axes and buttons of the joystick interface */
+#define TRON_SOURCE_CONTROLLER   0x03 /**< Single report of a COMBINED_REPORT build */
+
+/** Joystick and buttons of one player. */
+typedef struct {
+	int16_t X;          /**< Joystick axes, -1 to 1 or the analog range of an ANALOG_AXES build */
+	int16_t Y;
+	uint8_t Buttons;    /**< Button 1 to 3 in bits 0 to 2 */
+	uint8_t Reserved;
+} TronPlayer_t;
+
+/** Merged controller state. */
+typedef struct {
+	uint64_t     Timestamp; /**< CLOCK_MONOTONIC time the report was read, in nanoseconds */
+	uint64_t     Sequence;  /**< Number of the state, counting from 1 at the daemon's start */
+	int32_t      Dial;      /**< Dial position in report steps since the daemon's start */
+	uint8_t      Source;    /**< TRON_SOURCE_* of the report */
+	uint8_t      Players;   /**< Number of players of the controller, the others stay zero */
+	uint16_t     EdgeUS;    /**< Time from the report's earliest input edge to the start of the USB frame
+	                             the report was built for, in microseconds, 0 if unknown (EDGE_TIMESTAMP) */
+	uint8_t      Reserved[4];
+	TronPlayer_t Player[TRON_MAX_PLAYERS];
+} TronState_t;
+
+/** Ring slot, Lock is odd while the daemon writes the state. */
+typedef struct {
+	uint32_t    Lock;
+	uint32_t    Reserved;
+	TronState_t State;
+} TronSlot_t;
+
+/** Layout of the shared memory object. */
+typedef struct {
+	uint32_t   Magic;
+	uint16_t   Version;
+	uint16_t   Slots;
+	uint64_t   Head;    /**< Number of states published, the last is in slot (Head - 1) % Slots */
+	TronSlot_t Slot[TRON_RING_SLOTS];
+} TronRing_t;
+
+/** Maps the ring of the given name read-only, returns NULL if it does not exist or has another
+ *  layout. The mapping stays valid when the daemon exits, it then stops changing.
+ */
+static inline TronRing_t* TronRing_Open(const char* const Name)
+{
+	TronRing_t* Ring;
+	int         Object = shm_open(Name, O_RDONLY, 0);
+
+	if (Object < 0)
+		return NULL;
+
+	Ring = mmap(NULL, sizeof(TronRing_t), PROT_READ, MAP_SHARED, Object, 0);
+	close(Object);
+
+	if (Ring == MAP_FAILED)
+		return NULL;
+
+	if ((Ring->Magic != TRON_RING_MAGIC) || (Ring->Version != TRON_RING_VERSION) ||
+	    (Ring->Slots != TRON_RING_SLOTS)) {
+		munmap(Ring, sizeof(TronRing_t));
+		return NULL;
+	}
+
+	return Ring;
+}
+
+static inline void TronRing_Close(TronRing_t* const Ring)
+{
+	munmap(Ring, sizeof(TronRing_t));
+}
+
+/** Returns the number of states published so far. */
+static inline uint64_t TronRing_Head(const TronRing_t* const Ring)
+{
+	return __atomic_load_n(&Ring->Head, __ATOMIC_ACQUIRE);
+}
+
+/** Reads the state with the given sequence number, 1 to TronRing_Head(). Returns false if the
+ *  state is not published yet or was overwritten.
+ */
+static inline bool TronRing_Read(const TronRing_t* const Ring,
+                                 const uint64_t Sequence,
+                                 TronState_t* const State)
+{
+	const TronSlot_t* Slot = &Ring->Slot[(Sequence - 1) & (TRON_RING_SLOTS - 1)];
+	uint32_t          Lock;
+
+	if (!Sequence || (Sequence > TronRing_Head(Ring)))
+		return false;
+
+	do {
+		while ((Lock = __atomic_load_n(&Slot->Lock, __ATOMIC_ACQUIRE)) & 1)
+			;
+
+		*State = Slot->State;
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(&Slot->Lock, __ATOMIC_RELAXED) != Lock);
+
+	return (State->Sequence == Sequence);
+}
+
+/** Reads the last state published, returns false if there is none yet. */
+static inline bool TronRing_Latest(const TronRing_t* const Ring,
+                                   TronState_t* const State)
+{
+	uint64_t Head;
+
+	/* The daemon may overwrite the slot between reading the head and the state */
+	do {
+		Head = TronRing_Head(Ring);
+
+		if (!Head)
+			return false;
+	} while (!TronRing_Read(Ring, Head, State));
+
+	return true;
+}
+
+#endif
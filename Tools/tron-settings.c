@@ -0,0 +1,170 @@
+/** \file
+ *
+ *  Reads and writes the settings feature report of the controller through Linux hidraw, see
+ *  Settings.h in the firmware for the layout and the valid ranges. Without options the current
+ *  settings are printed, each option changes one setting and writes them all back:
+ *
+ *  \code
+ *  tron-settings /dev/hidraw3
+ *  tron-settings -d 3000 -g -2 -c 1 -b 1=0x20 /dev/hidraw3
+ *  tron-settings -k 5=0x2C -k 12=0 /dev/hidraw3
+ *  tron-settings -y 2 -w 12000 /dev/hidraw3
+ *  \endcode
+ *
+ *  The device keeps the new settings in EEPROM.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+
+/** Report ID of the settings feature report, HID_REPORTID_Settings in the firmware. */
+#define SETTINGS_REPORT_ID       0x03
+
+/** Number of mappable buttons, SETTINGS_BUTTONS in the firmware. */
+#define SETTINGS_BUTTONS         3
+
+/** Number of inputs mappable to keys per player and in all, SETTINGS_PLAYER_KEYS and SETTINGS_KEYS
+ *  in the firmware.
+ */
+#define SETTINGS_PLAYER_KEYS     7
+#define SETTINGS_KEYS            (2 * SETTINGS_PLAYER_KEYS)
+
+/** Size of the feature report including its report ID. */
+#define SETTINGS_REPORT_SIZE     (1 + 4 + SETTINGS_BUTTONS + SETTINGS_KEYS + 3)
+
+/** Offset of the key map in the feature report. */
+#define SETTINGS_KEYS_OFFSET     (1 + 4 + SETTINGS_BUTTONS)
+
+/** Offset of the dial jitter filter settings in the feature report. */
+#define SETTINGS_FILTER_OFFSET   (SETTINGS_KEYS_OFFSET + SETTINGS_KEYS)
+
+/** Names of the inputs of each player, in key map order. */
+static const char* const KeyInputNames[SETTINGS_PLAYER_KEYS] = {
+	"up", "down", "left", "right", "button 1", "button 2", "button 3",
+};
+
+static void Usage(const char* const Name)
+{
+	fprintf(stderr, "usage: %s [-d debounce_us] [-g dial_gain] [-c coalesce_frames] [-b button=mask]... [-k input=usage]... [-y dial_hysteresis] [-w dial_dwell_us] /dev/hidrawN\n", Name);
+	exit(EXIT_FAILURE);
+}
+
+static void PrintSettings(const uint8_t* const Report)
+{
+	printf("debounce         %u us\n", Report[1] | (Report[2] << 8));
+	printf("dial gain        %d\n", (int8_t)Report[3]);
+	printf("coalesce frames  %u\n", Report[4]);
+
+	for (int i = 0; i < SETTINGS_BUTTONS; i++)
+		printf("button %d         0x%02X\n", i + 1, Report[5 + i]);
+
+	/* The keys are used by a KEYBOARD_REPORT build only */
+	for (int i = 0; i < SETTINGS_KEYS; i++) {
+		printf("key %-2d P%d %-9s 0x%02X\n", i + 1, (i / SETTINGS_PLAYER_KEYS) + 1,
+		       KeyInputNames[i % SETTINGS_PLAYER_KEYS], Report[SETTINGS_KEYS_OFFSET + i]);
+	}
+
+	printf("dial hysteresis  %u steps\n", Report[SETTINGS_FILTER_OFFSET]);
+	printf("dial dwell       %u us\n", Report[SETTINGS_FILTER_OFFSET + 1] | (Report[SETTINGS_FILTER_OFFSET + 2] << 8));
+}
+
+static bool GetSettings(const int Device,
+                        uint8_t* const Report)
+{
+	Report[0] = SETTINGS_REPORT_ID;
+
+	if (ioctl(Device, HIDIOCGFEATURE(SETTINGS_REPORT_SIZE), Report) != SETTINGS_REPORT_SIZE) {
+		perror("HIDIOCGFEATURE");
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	uint8_t Report[SETTINGS_REPORT_SIZE];
+	bool    Write = false;
+	int     Option;
+	int     Device;
+
+	if ((argc < 2) || (argv[argc - 1][0] == '-'))
+		Usage(argv[0]);
+
+	if ((Device = open(argv[argc - 1], O_RDWR)) < 0) {
+		fprintf(stderr, "%s: %s\n", argv[argc - 1], strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	/* Options are applied on top of the settings read from the device */
+	if (!(GetSettings(Device, Report)))
+		return EXIT_FAILURE;
+
+	while ((Option = getopt(argc, argv, "d:g:c:b:k:y:w:")) != -1) {
+		long Value;
+		int  Button;
+
+		switch (Option) {
+		case 'd':
+			Value     = strtol(optarg, NULL, 0);
+			Report[1] = Value;
+			Report[2] = (Value >> 8);
+			break;
+		case 'g':
+			Report[3] = strtol(optarg, NULL, 0);
+			break;
+		case 'c':
+			Report[4] = strtol(optarg, NULL, 0);
+			break;
+		case 'b':
+			if ((sscanf(optarg, "%d=%li", &Button, &Value) != 2) || (Button < 1) || (Button > SETTINGS_BUTTONS))
+				Usage(argv[0]);
+			Report[4 + Button] = Value;
+			break;
+		case 'k':
+			if ((sscanf(optarg, "%d=%li", &Button, &Value) != 2) || (Button < 1) || (Button > SETTINGS_KEYS))
+				Usage(argv[0]);
+			Report[SETTINGS_KEYS_OFFSET + Button - 1] = Value;
+			break;
+		case 'y':
+			Report[SETTINGS_FILTER_OFFSET] = strtol(optarg, NULL, 0);
+			break;
+		case 'w':
+			Value                              = strtol(optarg, NULL, 0);
+			Report[SETTINGS_FILTER_OFFSET + 1] = Value;
+			Report[SETTINGS_FILTER_OFFSET + 2] = (Value >> 8);
+			break;
+		default:
+			Usage(argv[0]);
+		}
+
+		Write = true;
+	}
+
+	if (optind != (argc - 1))
+		Usage(argv[0]);
+
+	if (Write) {
+		if (ioctl(Device, HIDIOCSFEATURE(sizeof(Report)), Report) != sizeof(Report)) {
+			perror("HIDIOCSFEATURE");
+			return EXIT_FAILURE;
+		}
+
+		/* Read back, the device ignores settings out of range */
+		if (!(GetSettings(Device, Report)))
+			return EXIT_FAILURE;
+	}
+
+	PrintSettings(Report);
+	close(Device);
+
+	return EXIT_SUCCESS;
+}
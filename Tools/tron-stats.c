@@ -0,0 +1,294 @@
+/** \file
+ *
+ *  Reads the statistics feature report of the controller through Linux hidraw and prints the
+ *  report counters and the input latency histogram, see Stats.h in the firmware for the layout.
+ *
+ *  \code
+ *  tron-stats /dev/hidraw3
+ *  \endcode
+ *
+ *  The device path is the hidraw node of the joystick interface, or of the single interface of a
+ *  COMBINED_REPORT build. With -w the report is read again every second and the histogram shows
+ *  the reports of the last second only. With -b the boot timing feature report is printed instead:
+ *  the reset cause and the time each startup stage was reached, see Boot.h in the firmware. With -t
+ *  the task load feature report is printed: the runs, CPU share, longest run and deadline misses
+ *  of each main loop task, see Scheduler.h in the firmware.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+
+/** Report ID of the statistics feature report, HID_REPORTID_Stats in the firmware. */
+#define STATS_REPORT_ID          0x02
+
+/** Number of latency histogram buckets, STATS_LATENCY_BUCKETS in the firmware. */
+#define STATS_LATENCY_BUCKETS    16
+
+/** Size of the feature report including its report ID. */
+#define STATS_REPORT_SIZE        (1 + 10 + (2 * STATS_LATENCY_BUCKETS) + 3 + 4)
+
+/** Report ID of the boot timing feature report, HID_REPORTID_Boot in the firmware. */
+#define BOOT_REPORT_ID           0x04
+
+/** Number of startup stages, BOOT_STAGES in the firmware. */
+#define BOOT_STAGES              7
+
+/** Size of the boot timing feature report including its report ID. */
+#define BOOT_REPORT_SIZE         (1 + 2 + (4 * BOOT_STAGES))
+
+/** Report ID of the task load feature report, HID_REPORTID_Tasks in the firmware. */
+#define TASKS_REPORT_ID          0x05
+
+/** Number of main loop tasks, SCHEDULER_TASKS in the firmware. */
+#define TASKS                    4
+
+/** Size of the task load feature report including its report ID. */
+#define TASKS_REPORT_SIZE        (1 + (8 * TASKS))
+
+typedef struct {
+	uint16_t ReportsSent;
+	uint16_t ReportsSuppressed;
+	uint16_t FramesMissed;
+	uint8_t  QueueOverflows;
+	uint8_t  DebounceTicksMax;
+	uint16_t ActivePermille;
+	uint16_t Latency[STATS_LATENCY_BUCKETS];
+	uint16_t AnalogLoadPermille;
+	uint8_t  AnalogTicksMax;
+	uint16_t DialReportsEmitted;
+	uint16_t DialReportsFiltered;
+} Stats_t;
+
+static uint16_t GetLE16(const uint8_t* const Data)
+{
+	return (Data[0] | (Data[1] << 8));
+}
+
+static bool ReadStats(const int Device,
+                      Stats_t* const Stats)
+{
+	uint8_t Report[STATS_REPORT_SIZE] = {STATS_REPORT_ID};
+	int     Length = ioctl(Device, HIDIOCGFEATURE(sizeof(Report)), Report);
+
+	if (Length < 0) {
+		perror("HIDIOCGFEATURE");
+		return false;
+	}
+
+	if ((Length != sizeof(Report)) || (Report[0] != STATS_REPORT_ID)) {
+		fprintf(stderr, "unexpected statistics report (%d bytes)\n", Length);
+		return false;
+	}
+
+	Stats->ReportsSent       = GetLE16(&Report[1]);
+	Stats->ReportsSuppressed = GetLE16(&Report[3]);
+	Stats->FramesMissed      = GetLE16(&Report[5]);
+	Stats->QueueOverflows    = Report[7];
+	Stats->DebounceTicksMax  = Report[8];
+	Stats->ActivePermille    = GetLE16(&Report[9]);
+
+	for (int i = 0; i < STATS_LATENCY_BUCKETS; i++)
+		Stats->Latency[i] = GetLE16(&Report[11 + (2 * i)]);
+
+	Stats->AnalogLoadPermille = GetLE16(&Report[11 + (2 * STATS_LATENCY_BUCKETS)]);
+	Stats->AnalogTicksMax     = Report[13 + (2 * STATS_LATENCY_BUCKETS)];
+
+	Stats->DialReportsEmitted  = GetLE16(&Report[14 + (2 * STATS_LATENCY_BUCKETS)]);
+	Stats->DialReportsFiltered = GetLE16(&Report[16 + (2 * STATS_LATENCY_BUCKETS)]);
+
+	return true;
+}
+
+static uint32_t GetLE32(const uint8_t* const Data)
+{
+	return (GetLE16(&Data[0]) | ((uint32_t)GetLE16(&Data[2]) << 16));
+}
+
+/** Reads and prints the boot timing feature report. */
+static bool PrintBoot(const int Device)
+{
+	static const char* const Stages[BOOT_STAGES] = {
+		"clock setup", "USB_Init", "input init", "VBUS connect", "bus reset", "configured", "first report"
+	};
+	static const char* const Causes[] = {"power-on", "external", "brown-out", "watchdog", "JTAG"};
+
+	uint8_t  Report[BOOT_REPORT_SIZE] = {BOOT_REPORT_ID};
+	int      Length = ioctl(Device, HIDIOCGFEATURE(sizeof(Report)), Report);
+	uint32_t Previous = 0;
+
+	if (Length < 0) {
+		perror("HIDIOCGFEATURE");
+		return false;
+	}
+
+	if ((Length != sizeof(Report)) || (Report[0] != BOOT_REPORT_ID)) {
+		fprintf(stderr, "unexpected boot timing report (%d bytes)\n", Length);
+		return false;
+	}
+
+	printf("reset cause        ");
+	for (int i = 0; i < (int)(sizeof(Causes) / sizeof(Causes[0])); i++) {
+		if (Report[1] & (1 << i))
+			printf(" %s", Causes[i]);
+	}
+	printf("%s\n", ((Report[1] & 0x1F) ? "" : " unknown"));
+
+	for (int i = 0; i < BOOT_STAGES; i++) {
+		uint32_t Time = GetLE32(&Report[3 + (4 * i)]);
+
+		if (!(Report[2] & (1 << i))) {
+			printf("%-18s  not reached\n", Stages[i]);
+			continue;
+		}
+
+		printf("%-18s %8.3f ms  (+%.3f ms)\n", Stages[i], (Time / 1000.0), ((int32_t)(Time - Previous) / 1000.0));
+		Previous = Time;
+	}
+
+	return true;
+}
+
+/** Reads and prints the task load feature report. */
+static bool PrintTasks(const int Device)
+{
+	static const char* const Tasks[TASKS] = {"reports", "USB", "settings", "housekeeping"};
+
+	uint8_t Report[TASKS_REPORT_SIZE] = {TASKS_REPORT_ID};
+	int     Length = ioctl(Device, HIDIOCGFEATURE(sizeof(Report)), Report);
+
+	if (Length < 0) {
+		perror("HIDIOCGFEATURE");
+		return false;
+	}
+
+	if ((Length != sizeof(Report)) || (Report[0] != TASKS_REPORT_ID)) {
+		fprintf(stderr, "unexpected task load report (%d bytes)\n", Length);
+		return false;
+	}
+
+	printf("task              runs    load     max  deadline misses\n");
+
+	for (int i = 0; i < TASKS; i++) {
+		const uint8_t* Load = &Report[1 + (8 * i)];
+
+		printf("%-14s  %6u  %5.1f%%  %4u us  %u\n", Tasks[i], GetLE16(&Load[0]), (GetLE16(&Load[2]) / 10.0),
+		       GetLE16(&Load[4]), GetLE16(&Load[6]));
+	}
+
+	return true;
+}
+
+/** Prints the change from Previous to Current, the device counters wrap at 16 bits. */
+static void PrintStats(const Stats_t* const Current,
+                       const Stats_t* const Previous)
+{
+	uint32_t Total = 0;
+	uint16_t Latency[STATS_LATENCY_BUCKETS];
+
+	printf("reports sent        %u\n", (uint16_t)(Current->ReportsSent - Previous->ReportsSent));
+	printf("reports suppressed  %u\n", (uint16_t)(Current->ReportsSuppressed - Previous->ReportsSuppressed));
+	printf("frames missed       %u\n", (uint16_t)(Current->FramesMissed - Previous->FramesMissed));
+	printf("queue overflows     %u\n", (uint8_t)(Current->QueueOverflows - Previous->QueueOverflows));
+	printf("debounce max        %u ticks\n", Current->DebounceTicksMax);
+	printf("CPU active          %.1f%%\n", Current->ActivePermille / 10.0);
+	printf("dial reports        %u\n", (uint16_t)(Current->DialReportsEmitted - Previous->DialReportsEmitted));
+	printf("dial filtered       %u\n", (uint16_t)(Current->DialReportsFiltered - Previous->DialReportsFiltered));
+
+	if (Current->AnalogTicksMax) {
+		printf("ADC interrupt load  %.1f%%\n", Current->AnalogLoadPermille / 10.0);
+		printf("ADC interrupt max   %u ticks\n", Current->AnalogTicksMax);
+	}
+
+	for (int i = 0; i < STATS_LATENCY_BUCKETS; i++) {
+		Latency[i] = (Current->Latency[i] - Previous->Latency[i]);
+		Total     += Latency[i];
+	}
+
+	printf("latency (edge to endpoint commit):\n");
+
+	for (int i = 0; i < STATS_LATENCY_BUCKETS; i++) {
+		if (!Latency[i])
+			continue;
+
+		printf("  %6u - %6u us  %6u  %5.1f%%  ", (i ? (1u << i) : 0), ((2u << i) - 1), Latency[i],
+		       (100.0 * Latency[i]) / Total);
+
+		for (uint32_t Bar = 0; Bar < ((50 * Latency[i]) / Total); Bar++)
+			putchar('#');
+		putchar('\n');
+	}
+
+	if (Current->Latency[STATS_LATENCY_BUCKETS - 1] == UINT16_MAX)
+		printf("  (last bucket saturated)\n");
+}
+
+int main(int argc, char* argv[])
+{
+	bool    Watch = false;
+	bool    Boot  = false;
+	bool    Tasks = false;
+	int     Option;
+	int     Device;
+	Stats_t Previous = {0};
+	Stats_t Current;
+
+	while ((Option = getopt(argc, argv, "btw")) != -1) {
+		switch (Option) {
+		case 'b':
+			Boot = true;
+			break;
+		case 't':
+			Tasks = true;
+			break;
+		case 'w':
+			Watch = true;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-b | -t | -w] /dev/hidrawN\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ((optind != (argc - 1)) || ((Boot + Tasks + Watch) > 1)) {
+		fprintf(stderr, "usage: %s [-b | -t | -w] /dev/hidrawN\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if ((Device = open(argv[optind], O_RDWR)) < 0) {
+		fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	if (Boot || Tasks) {
+		bool Printed = (Boot ? PrintBoot(Device) : PrintTasks(Device));
+
+		close(Device);
+		return (Printed ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	do {
+		if (!ReadStats(Device, &Current))
+			return EXIT_FAILURE;
+
+		PrintStats(&Current, &Previous);
+
+		if (Watch) {
+			Previous = Current;
+			printf("\n");
+			fflush(stdout);
+			sleep(1);
+		}
+	} while (Watch);
+
+	close(Device);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+/** \file
+ *
+ *  Reads the raw stream of a RAW_STREAM build through Linux hidraw and decodes its port samples
+ *  into a trace in the format of the Host harness, see Stream.h in the firmware for the report
+ *  layout and Host/HostTrace.c for the trace format.
+ *
+ *  \code
+ *  tron-stream [-r rate] /dev/hidraw4 > capture.trace
+ *  \endcode
+ *
+ *  The device path is the hidraw node of the stream interface, the last interface of the build;
+ *  -r gives the STREAM_SAMPLE_HZ of the build, 8000 by default. A trace line is written for the
+ *  first sample and for each sample whose ports differ from the previous one, its time counted in
+ *  microseconds from the first sample. Samples lost because the host fell behind are written as a
+ *  comment at the time of the gap and counted on stderr. The capture runs until interrupted, or
+ *  until the device fails, e.g. when the controller is unplugged.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Size of the raw stream report, STREAM_REPORT_SIZE in the firmware. */
+#define STREAM_REPORT_SIZE       64
+
+/** Size of the report header, STREAM_HEADER_SIZE in the firmware. */
+#define STREAM_HEADER_SIZE       6
+
+/** Token bits of the changed ports and mask of the run, STREAM_TOKEN_* in the firmware. */
+#define STREAM_TOKEN_PIND        (1 << 5)
+#define STREAM_TOKEN_PINB        (1 << 6)
+#define STREAM_TOKEN_PINF        (1 << 7)
+#define STREAM_TOKEN_RUN_MASK    0x1F
+
+static volatile sig_atomic_t Stopping;
+
+/** Sample rate of the build in Hz. */
+static unsigned Rate = 8000;
+
+/** Index of the next expected sample and of the first one, both without wrapping. */
+static uint64_t Next;
+static uint64_t First;
+
+/** Ports of the last written sample, valid once a sample was written. */
+static uint8_t Ports[3];
+static bool    Started;
+
+static uint64_t Samples;
+static uint64_t Lost;
+static uint64_t Malformed;
+
+static void Stop(int Signal)
+{
+	Stopping = 1;
+}
+
+/** Writes the sample of the given index if its ports differ from the last one. */
+static void Sample(const uint64_t Index,
+                   const uint8_t* const Pins)
+{
+	Samples++;
+
+	if (Started && !memcmp(Pins, Ports, sizeof(Ports)))
+		return;
+
+	memcpy(Ports, Pins, sizeof(Ports));
+	Started = true;
+
+	printf("%llu %02x %02x %02x\n", (unsigned long long)(((Index - First) * 1000000) / Rate),
+	       Pins[0], Pins[1], Pins[2]);
+}
+
+/** Decodes one report, returning false if it is malformed. */
+static bool Decode(const uint8_t* const Report,
+                   const int Length)
+{
+	uint16_t       Index = (Report[0] | (Report[1] << 8));
+	const uint8_t* Data  = &Report[STREAM_HEADER_SIZE];
+	const uint8_t* End;
+	uint8_t        Pins[3];
+
+	if ((Length != STREAM_REPORT_SIZE) || (Report[2] > (STREAM_REPORT_SIZE - STREAM_HEADER_SIZE)))
+		return false;
+
+	End = &Data[Report[2]];
+
+	/* The firmware index wraps at 16 bits, a report never starts before the expected sample */
+	if (Started) {
+		uint16_t Gap = (uint16_t)(Index - (uint16_t)Next);
+
+		if (Gap) {
+			printf("# %u samples lost\n", Gap);
+			Lost += Gap;
+			Next += Gap;
+		}
+	} else {
+		Next  = Index;
+		First = Index;
+	}
+
+	memcpy(Pins, &Report[3], sizeof(Pins));
+	Sample(Next++, Pins);
+
+	while (Data < End) {
+		uint8_t Token = *Data++;
+
+		for (uint8_t Run = (Token & STREAM_TOKEN_RUN_MASK); Run; Run--)
+			Sample(Next++, Pins);
+
+		for (int Port = 0; Port < 3; Port++) {
+			if (!(Token & (STREAM_TOKEN_PIND << Port)))
+				continue;
+
+			if (Data == End)
+				return false;
+
+			Pins[Port] ^= *Data++;
+		}
+
+		Sample(Next++, Pins);
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	struct sigaction Action = {.sa_handler = Stop};
+	int              Option;
+	int              Device;
+
+	while ((Option = getopt(argc, argv, "r:")) != -1) {
+		switch (Option) {
+		case 'r':
+			Rate = atoi(optarg);
+			if (Rate)
+				break;
+			/* Fall through */
+		default:
+			fprintf(stderr, "usage: %s [-r rate] /dev/hidrawN\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind != (argc - 1)) {
+		fprintf(stderr, "usage: %s [-r rate] /dev/hidrawN\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if ((Device = open(argv[optind], O_RDONLY)) < 0) {
+		fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	/* Without SA_RESTART the signal interrupts the blocking read */
+	sigaction(SIGINT, &Action, NULL);
+	sigaction(SIGTERM, &Action, NULL);
+
+	printf("# raw stream of %s at %u Hz\n", argv[optind], Rate);
+	printf("# time_us  PIND PINB PINF\n");
+
+	while (!Stopping) {
+		uint8_t Report[STREAM_REPORT_SIZE];
+		int     Length = read(Device, Report, sizeof(Report));
+
+		if (Length <= 0) {
+			if (Length && (errno != EINTR))
+				fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+			break;
+		}
+
+		if (!Decode(Report, Length))
+			Malformed++;
+	}
+
+	close(Device);
+	fflush(stdout);
+
+	fprintf(stderr, "%llu samples, %llu lost, %llu malformed reports\n", (unsigned long long)Samples,
+	        (unsigned long long)Lost, (unsigned long long)Malformed);
+
+	return EXIT_SUCCESS;
+}
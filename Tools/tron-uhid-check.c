@@ -0,0 +1,479 @@
+/** \file
+ *
+ *  Tests of tron-uhid without uhid. SOCK_SEQPACKET Unix sockets stand in for /dev/uhid and for
+ *  the hidraw nodes under a test root given with -R, see tron-uhid.c: the test answers the devices'
+ *  creation like the kernel, checks that each controller replays the reports of its interfaces in
+ *  order from its place in the replay, echoes them through the hidraw sockets but for one, and
+ *  checks the matching counted by the tool. It exits non-zero if any check fails.
+ *
+ *  \code
+ *  tron-uhid-check ./tron-uhid
+ *  \endcode
+ *
+ *  The tool must be built with the descriptors of the default configuration, a mouse interface on
+ *  endpoint 1 and a joystick interface on endpoint 3.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <linux/uhid.h>
+
+/** Time the tool gets to create its devices, send a report or exit, in milliseconds. */
+#define CHECK_TIMEOUT_MS         3000
+
+/** Controllers emulated, each with the mouse and joystick interfaces of the default build. */
+#define CHECK_CONTROLLERS        2
+#define CHECK_INTERFACES         2
+#define CHECK_DEVICES            (CHECK_CONTROLLERS * CHECK_INTERFACES)
+
+/** Reports replayed by each device before the check is satisfied, about a second of replay. */
+#define CHECK_MIN_REPORTS        50
+
+/** Report of the first controller's joystick not echoed through its hidraw socket, as if the
+ *  kernel lost it. The next report differs from it, so that only the lost one is unmatched.
+ */
+#define CHECK_LOST_REPORT        3
+
+/** ID of the feature report requested from the first device, which the tool must fail. */
+#define CHECK_REQUEST_ID         0x2A
+
+#define CHECK(Condition)         Check((Condition), #Condition, __LINE__)
+
+/** Report of the replay file. */
+typedef struct {
+	unsigned Time;
+	uint8_t  Interface;
+	uint8_t  Length;
+	uint8_t  Data[4];
+} Replay_t;
+
+/** One device created by the tool, and the hidraw socket standing in for its node. */
+typedef struct {
+	int      Device;
+	int      Reader;
+	uint32_t Reports;
+	uint32_t Next;     /**< Position in the replay of the next report expected */
+	bool     Ordered;
+} Device_t;
+
+/** Replay of 8ms: the joystick on endpoint 3, the dial on endpoint 1. The second controller
+ *  starts half way, at the report of 5000us.
+ */
+static const Replay_t Replay[] = {
+	{1000, 1, 4, {0x01, 0x00, 0x00, 0x00}},
+	{3000, 0, 3, {0x00, 0x00, 0x05}},
+	{5000, 1, 4, {0x01, 0xFF, 0x00, 0x01}},
+	{7000, 1, 4, {0x01, 0x00, 0x01, 0x02}},
+};
+
+static const uint8_t Endpoints[CHECK_INTERFACES] = {1, 3};
+
+static const uint32_t Starts[CHECK_CONTROLLERS] = {0, 2};
+
+static char     Directory[] = "/tmp/tron-uhid-check.XXXXXX";
+static Device_t Devices[CHECK_DEVICES];
+
+static uint32_t Checks;
+static uint32_t Failures;
+
+static void Check(const bool Passed,
+                  const char* const Condition,
+                  const int Line)
+{
+	Checks++;
+
+	if (!Passed) {
+		fprintf(stderr, "tron-uhid-check.c:%d: check failed: %s\n", Line, Condition);
+		Failures++;
+	}
+}
+
+/** Makes a path in the test root. */
+static void MakePath(char* const Path,
+                     const size_t Size,
+                     const char* const Name)
+{
+	snprintf(Path, Size, "%s/%s", Directory, Name);
+}
+
+/** Creates a listening socket at the given path in the test root. */
+static int Listen(const char* const Name)
+{
+	struct sockaddr_un Address = {.sun_family = AF_UNIX};
+	int                Socket;
+
+	MakePath(Address.sun_path, sizeof(Address.sun_path), Name);
+
+	if (((Socket = socket(AF_UNIX, SOCK_SEQPACKET, 0)) < 0) ||
+	    (bind(Socket, (struct sockaddr*)&Address, sizeof(Address)) < 0) ||
+	    (listen(Socket, CHECK_DEVICES) < 0))
+	{
+		perror(Address.sun_path);
+		exit(EXIT_FAILURE);
+	}
+
+	return Socket;
+}
+
+/** Waits for the given descriptor to be readable, returning false on timeout. */
+static bool Wait(const int Descriptor)
+{
+	struct pollfd Ready = {.fd = Descriptor, .events = POLLIN};
+
+	return (poll(&Ready, 1, CHECK_TIMEOUT_MS) == 1);
+}
+
+/** Writes a file in the test root. */
+static void WriteFile(const char* const Name,
+                      const char* const Contents)
+{
+	char  Path[256];
+	FILE* File;
+
+	MakePath(Path, sizeof(Path), Name);
+
+	if (!(File = fopen(Path, "w")) || (fputs(Contents, File) < 0) || fclose(File)) {
+		perror(Path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void MakeDirectory(const char* const Name)
+{
+	char Path[256];
+
+	MakePath(Path, sizeof(Path), Name);
+
+	if (mkdir(Path, 0755) < 0) {
+		perror(Path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/** Writes the replay in the format of the host build's output. */
+static void WriteReplay(void)
+{
+	char   Contents[512] = "# time_us EP bytes\n";
+	size_t Length        = strlen(Contents);
+
+	for (size_t i = 0; i < (sizeof(Replay) / sizeof(Replay[0])); i++) {
+		Length += snprintf(&Contents[Length], (sizeof(Contents) - Length), "%u EP%u", Replay[i].Time,
+		                   Endpoints[Replay[i].Interface]);
+
+		for (uint8_t Byte = 0; Byte < Replay[i].Length; Byte++)
+			Length += snprintf(&Contents[Length], (sizeof(Contents) - Length), " %02x", Replay[i].Data[Byte]);
+
+		Length += snprintf(&Contents[Length], (sizeof(Contents) - Length), "\n");
+	}
+
+	WriteFile("reports", Contents);
+}
+
+/** Accepts the devices of the tool and checks their creation. The hidraw nodes are published
+ *  with the phys of each device, as the kernel does in sysfs, and the devices started.
+ */
+static void CreateDevices(const int Listening,
+                          const pid_t Process)
+{
+	for (int i = 0; i < CHECK_DEVICES; i++) {
+		struct uhid_event Event;
+		unsigned          Controller;
+		unsigned          Interface;
+		int               Owner;
+		int               Device;
+
+		if (!Wait(Listening) || ((Device = accept(Listening, NULL, NULL)) < 0) || !Wait(Device)) {
+			fprintf(stderr, "tron-uhid did not create its devices\n");
+			exit(EXIT_FAILURE);
+		}
+
+		CHECK(read(Device, &Event, sizeof(Event)) == sizeof(Event));
+		CHECK(Event.type == UHID_CREATE2);
+		CHECK(Event.u.create2.bus == BUS_USB);
+		CHECK(Event.u.create2.vendor == 0x03EB);
+		CHECK(Event.u.create2.rd_size > 0);
+		CHECK(Event.u.create2.name[0] != '\0');
+
+		if ((sscanf((char*)Event.u.create2.phys, "tron-uhid-%d/%u/input%u", &Owner, &Controller, &Interface) != 3) ||
+		    (Owner != Process) || (Controller >= CHECK_CONTROLLERS) || (Interface >= CHECK_INTERFACES))
+		{
+			fprintf(stderr, "unexpected phys \"%s\"\n", Event.u.create2.phys);
+			exit(EXIT_FAILURE);
+		}
+
+		Devices[(Controller * CHECK_INTERFACES) + Interface].Device = Device;
+	}
+
+	for (int i = 0; i < CHECK_DEVICES; i++) {
+		Device_t*         Device = &Devices[i];
+		struct uhid_event Start  = {.type = UHID_START};
+		char              Name[64];
+		char              Uevent[128];
+
+		snprintf(Name, sizeof(Name), "dev/hidraw%d", i);
+		Device->Reader  = Listen(Name);
+		Device->Next    = Starts[i / CHECK_INTERFACES];
+		Device->Ordered = true;
+
+		snprintf(Name, sizeof(Name), "sys/class/hidraw/hidraw%d", i);
+		MakeDirectory(Name);
+		snprintf(Name, sizeof(Name), "sys/class/hidraw/hidraw%d/device", i);
+		MakeDirectory(Name);
+		snprintf(Name, sizeof(Name), "sys/class/hidraw/hidraw%d/device/uevent", i);
+		snprintf(Uevent, sizeof(Uevent), "HID_NAME=test\nHID_PHYS=tron-uhid-%d/%d/input%d\n", (int)Process,
+		         (i / CHECK_INTERFACES), (i % CHECK_INTERFACES));
+		WriteFile(Name, Uevent);
+
+		CHECK(write(Device->Device, &Start, sizeof(Start)) == sizeof(Start));
+	}
+}
+
+/** Checks a report written by a device against the next one of its interface in the replay, and
+ *  echoes it through the device's hidraw socket. The tool closes the sockets when it stops, with
+ *  the reports of its last frame possibly still to be echoed.
+ */
+static void Received(const int Index,
+                     const struct uhid_event* const Event)
+{
+	Device_t*       Device    = &Devices[Index];
+	uint8_t         Interface = (Index % CHECK_INTERFACES);
+	const Replay_t* Expected;
+	bool            Lost      = ((Index == 1) && (Device->Reports == CHECK_LOST_REPORT));
+
+	while (Replay[Device->Next].Interface != Interface)
+		Device->Next = ((Device->Next + 1) % (sizeof(Replay) / sizeof(Replay[0])));
+
+	Expected     = &Replay[Device->Next];
+	Device->Next = ((Device->Next + 1) % (sizeof(Replay) / sizeof(Replay[0])));
+
+	if ((Event->u.input2.size != Expected->Length) || memcmp(Event->u.input2.data, Expected->Data, Expected->Length))
+		Device->Ordered = false;
+
+	Device->Reports++;
+
+	if (Lost)
+		return;
+
+	if ((send(Device->Reader, Event->u.input2.data, Event->u.input2.size, 0) != Event->u.input2.size) &&
+	    (errno != EPIPE))
+	{
+		perror("send");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/** Accepts the hidraw connections of the tool, then reads the events of its devices until it
+ *  closes them on exit.
+ */
+static void RunReplay(void)
+{
+	bool Requested = false;
+	bool Replied   = false;
+	int  Open      = CHECK_DEVICES;
+
+	for (int i = 0; i < CHECK_DEVICES; i++) {
+		int Reader;
+
+		if (!Wait(Devices[i].Reader) || ((Reader = accept(Devices[i].Reader, NULL, NULL)) < 0)) {
+			fprintf(stderr, "tron-uhid did not open hidraw%d\n", i);
+			exit(EXIT_FAILURE);
+		}
+
+		close(Devices[i].Reader);
+		Devices[i].Reader = Reader;
+	}
+
+	while (Open) {
+		struct pollfd Ready[CHECK_DEVICES];
+
+		for (int i = 0; i < CHECK_DEVICES; i++)
+			Ready[i] = (struct pollfd){.fd = Devices[i].Device, .events = POLLIN};
+
+		if (poll(Ready, CHECK_DEVICES, CHECK_TIMEOUT_MS) <= 0) {
+			fprintf(stderr, "tron-uhid stopped sending\n");
+			break;
+		}
+
+		for (int i = 0; i < CHECK_DEVICES; i++) {
+			struct uhid_event Event;
+			ssize_t           Length;
+
+			if (!Ready[i].revents || (Ready[i].fd < 0))
+				continue;
+
+			if ((Length = read(Devices[i].Device, &Event, sizeof(Event))) <= 0) {
+				close(Devices[i].Device);
+				Devices[i].Device = -1;
+				Open--;
+				continue;
+			}
+
+			if (Event.type == UHID_INPUT2)
+				Received(i, &Event);
+			else if (Event.type == UHID_GET_REPORT_REPLY)
+				Replied = ((i == 0) && (Event.u.get_report_reply.id == CHECK_REQUEST_ID) &&
+				           (Event.u.get_report_reply.err == EIO));
+
+			/* A feature report request once the replay runs, the tool does not emulate them */
+			if ((i == 0) && !Requested) {
+				struct uhid_event Request = {.type = UHID_GET_REPORT};
+
+				Request.u.get_report.id    = CHECK_REQUEST_ID;
+				Request.u.get_report.rnum  = 2;
+				Request.u.get_report.rtype = UHID_FEATURE_REPORT;
+
+				CHECK(write(Devices[0].Device, &Request, sizeof(Request)) == sizeof(Request));
+				Requested = true;
+			}
+		}
+	}
+
+	CHECK(Replied);
+
+	for (int i = 0; i < CHECK_DEVICES; i++) {
+		CHECK(Devices[i].Reports >= CHECK_MIN_REPORTS);
+		CHECK(Devices[i].Ordered);
+		close(Devices[i].Reader);
+	}
+}
+
+/** Removes the test root. */
+static void RemoveRoot(void)
+{
+	char Path[256];
+
+	for (int i = 0; i < CHECK_DEVICES; i++) {
+		snprintf(Path, sizeof(Path), "%s/dev/hidraw%d", Directory, i);
+		unlink(Path);
+		snprintf(Path, sizeof(Path), "%s/sys/class/hidraw/hidraw%d/device/uevent", Directory, i);
+		unlink(Path);
+		snprintf(Path, sizeof(Path), "%s/sys/class/hidraw/hidraw%d/device", Directory, i);
+		rmdir(Path);
+		snprintf(Path, sizeof(Path), "%s/sys/class/hidraw/hidraw%d", Directory, i);
+		rmdir(Path);
+	}
+
+	for (const char* const* Name = (const char*[]){"dev/uhid", "reports", NULL}; *Name; Name++) {
+		MakePath(Path, sizeof(Path), *Name);
+		unlink(Path);
+	}
+
+	for (const char* const* Name = (const char*[]){"sys/class/hidraw", "sys/class", "sys", "dev", NULL};
+	     *Name; Name++)
+	{
+		MakePath(Path, sizeof(Path), *Name);
+		rmdir(Path);
+	}
+
+	rmdir(Directory);
+}
+
+int main(int argc, char* argv[])
+{
+	char               Output[4096];
+	char               Reports[256];
+	char               Count[16];
+	unsigned long long Unmatched;
+	unsigned long long WriteErrors = 0;
+	unsigned           Controllers;
+	double             Sent;
+	double             Received;
+	const char*        Total;
+	const char*        Errors;
+	int                Listening;
+	int                Pipe[2];
+	int                Status;
+	ssize_t            Length = 0;
+	ssize_t            Read;
+	pid_t              Process;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s path/to/tron-uhid\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (!mkdtemp(Directory)) {
+		perror(Directory);
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	MakeDirectory("dev");
+	MakeDirectory("sys");
+	MakeDirectory("sys/class");
+	MakeDirectory("sys/class/hidraw");
+	WriteReplay();
+	Listening = Listen("dev/uhid");
+
+	MakePath(Reports, sizeof(Reports), "reports");
+	snprintf(Count, sizeof(Count), "%d", CHECK_CONTROLLERS);
+
+	if (pipe(Pipe) < 0) {
+		perror("pipe");
+		return EXIT_FAILURE;
+	}
+
+	/* The tool stops after a second of replay, its output goes to the pipe and is shown if a check
+	 * fails */
+	if (!(Process = fork())) {
+		dup2(Pipe[1], STDOUT_FILENO);
+		dup2(Pipe[1], STDERR_FILENO);
+		close(Pipe[0]);
+		close(Pipe[1]);
+		execl(argv[1], argv[1], "-n", Count, "-l", "-s", "1", "-R", Directory, Reports, (char*)NULL);
+		perror(argv[1]);
+		_exit(127);
+	}
+
+	close(Pipe[1]);
+
+	CreateDevices(Listening, Process);
+	close(Listening);
+	RunReplay();
+
+	while ((Length < (ssize_t)(sizeof(Output) - 1)) &&
+	       ((Read = read(Pipe[0], &Output[Length], (sizeof(Output) - 1 - Length))) > 0))
+		Length += Read;
+
+	Output[Length] = '\0';
+	close(Pipe[0]);
+
+	CHECK((waitpid(Process, &Status, 0) == Process) && WIFEXITED(Status) && (WEXITSTATUS(Status) == EXIT_SUCCESS));
+
+	/* The reports echoed were read back and matched, the lost one is not; the reports of the last
+	 * frame may still be in flight when the tool stops */
+	CHECK((Total = strstr(Output, "total: ")) != NULL);
+	if (Total) {
+		CHECK(sscanf(Total, "total: %u controllers sent %lf/s received %lf/s unmatched %llu", &Controllers,
+		             &Sent, &Received, &Unmatched) == 4);
+		CHECK(Controllers == CHECK_CONTROLLERS);
+		CHECK((Received > 0) && (Received <= Sent));
+		CHECK(Unmatched == 1);
+		CHECK(strstr(Total, "latency mean") != NULL);
+		CHECK(!(Errors = strstr(Total, "write errors")) || (sscanf(Errors, "write errors %llu", &WriteErrors) == 1));
+		CHECK(WriteErrors == 0);
+	}
+
+	RemoveRoot();
+
+	if (Failures)
+		fputs(Output, stderr);
+
+	fprintf(stderr, "%" PRIu32 " checks, %" PRIu32 " failed\n", Checks, Failures);
+
+	return (Failures ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,913 @@
+/** \file
+ *
+ *  Emulates any number of controllers through Linux uhid, for load testing the host input stack
+ *  without boards. Each controller gets one HID device per interface of the firmware, with the
+ *  device, string and report descriptors served by the firmware's own Descriptors.c, which the
+ *  makefile compiles into this tool with the firmware's TRON_OPTS.
+ *
+ *  \code
+ *  Host/Joystick-host < Host/Traces/button-mash.trace > mash.reports
+ *  tron-uhid [-n controllers] [-f] [-l] [-s seconds] [-R root] mash.reports
+ *  \endcode
+ *
+ *  The reports are those printed by the host build of the same configuration: one line per report
+ *  with the receive time in microseconds, the endpoint and the payload bytes. Every controller
+ *  replays them from its interfaces in a loop, the controllers spread evenly over the replay so
+ *  that they do not all change at once. With -f the times are ignored and every interface sends
+ *  its next report on every frame instead, the most a full-speed interrupt endpoint polled each
+ *  millisecond carries. The reports are sent from a single 1ms timer, like the host controller
+ *  polls the endpoints once per frame.
+ *
+ *  With -l each device's hidraw node is read back and every report received is matched with the
+ *  one sent, which measures the latency of the kernel's path from uhid to the readers. The
+ *  throughput and latency are printed every second and in a summary when the tool exits after -s
+ *  seconds or when interrupted. The feature reports of the firmware (statistics, settings) are
+ *  not emulated, requests for them fail.
+ *
+ *  Creating uhid devices needs write access to /dev/uhid, usually root.
+ *
+ *  With -R the uhid node, the hidraw class directory of sysfs and the hidraw nodes are looked up
+ *  under the given directory instead of the root, and a node may be a listening Unix socket of type
+ *  SOCK_SEQPACKET, which the tool connects to and then uses like the node, one packet per uhid
+ *  event or report. This stands in for the kernel when testing the tool, see tron-uhid-check.c.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <linux/uhid.h>
+
+/** Standard and HID class descriptor types, DTYPE_* and HID_DTYPE_* in LUFA. */
+#define DTYPE_Device             0x01
+#define DTYPE_Configuration      0x02
+#define DTYPE_String             0x03
+#define DTYPE_Interface          0x04
+#define DTYPE_Endpoint           0x05
+#define HID_DTYPE_Report         0x22
+
+/** Largest number of interfaces of a build, the mouse, joystick and stream interfaces. */
+#define MAX_INTERFACES           3
+
+/** Largest report, the size of the largest endpoint bank. */
+#define MAX_REPORT_SIZE          64
+
+/** Reports sent to an interface and not yet read back from its hidraw node, a power of two. */
+#define PENDING_REPORTS          64
+
+/** Number of latency histogram buckets, 1us to 32ms in powers of two. */
+#define LATENCY_BUCKETS          16
+
+/** Frame period of the timer, in microseconds. */
+#define FRAME_US                 1000
+
+/** Most frames caught up at once with -f after the timer was late. */
+#define MAX_LATE_FRAMES          8
+
+/** Tags of the epoll events: the timer, or the uhid or hidraw descriptor of an interface. */
+#define EVENT_TIMER              UINT64_MAX
+#define EVENT_TAG(Controller, Interface, Reader) (((uint64_t)(Controller) << 8) | ((Interface) << 1) | (Reader))
+
+/** Looks up a descriptor like the LUFA core does for a GET_DESCRIPTOR request, see Descriptors.c. */
+uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
+                                    const uint8_t wIndex,
+                                    const void** const DescriptorAddress);
+
+/** One line of the report file. */
+typedef struct {
+	uint64_t Time;
+	uint8_t  Interface;
+	uint8_t  Length;
+	uint8_t  Data[MAX_REPORT_SIZE];
+} Report_t;
+
+/** Report sent to an interface, kept until it is read back. */
+typedef struct {
+	uint64_t Sent;
+	uint8_t  Length;
+	uint8_t  Data[MAX_REPORT_SIZE];
+} Pending_t;
+
+/** One HID device of an emulated controller. */
+typedef struct {
+	int       Device;  /**< uhid file descriptor */
+	int       Reader;  /**< hidraw file descriptor with -l, -1 until found */
+	bool      Started;
+	uint32_t  Next;    /**< Position in the reports of the interface with -f */
+	Pending_t Pending[PENDING_REPORTS];
+	uint8_t   PendingHead;
+	uint8_t   PendingTail;
+} Interface_t;
+
+/** One emulated controller. */
+typedef struct {
+	Interface_t Interfaces[MAX_INTERFACES];
+	uint64_t    Offset;    /**< Start of the controller within the replay, in microseconds */
+	uint32_t    Next;      /**< Next report of the replay */
+	uint64_t    Loop;      /**< Start of the current pass of the replay, in microseconds */
+} Controller_t;
+
+/** Counters of the last second and of the whole run. */
+typedef struct {
+	uint64_t Sent;
+	uint64_t Received;
+	uint64_t Unmatched;
+	uint64_t WriteErrors;
+	uint64_t LateFrames;
+	uint64_t Latency[LATENCY_BUCKETS];
+	uint64_t LatencySum;
+	uint64_t LatencyMax;
+} Counters_t;
+
+static volatile sig_atomic_t Stopping;
+
+/** Interfaces of the configuration, in interface number order. */
+static uint8_t  InterfaceCount;
+static uint8_t  Endpoints[MAX_INTERFACES];
+static uint8_t  ReportDescriptors[MAX_INTERFACES][4096];
+static uint16_t ReportDescriptorSizes[MAX_INTERFACES];
+static uint16_t VendorID;
+static uint16_t ProductID;
+static uint16_t Release;
+static char     Name[128];
+
+/** Reports of the file, in time order, and of each interface for -f. */
+static Report_t* Reports;
+static uint32_t  ReportCount;
+static uint32_t* InterfaceReports[MAX_INTERFACES];
+static uint32_t  InterfaceReportCounts[MAX_INTERFACES];
+
+/** Length of one pass of the replay, the last report's time rounded up to a whole frame. */
+static uint64_t Period;
+
+static Controller_t* Controllers;
+static uint32_t      ControllerCount = 1;
+
+static bool FullRate;
+static bool Measure;
+
+/** Directory the device nodes and sysfs are looked up in, empty for the root. */
+static const char* Root = "";
+
+/** Number of hidraw nodes opened with -l. */
+static uint32_t ReadersFound;
+
+static Counters_t Second;
+static Counters_t Total;
+
+static void Stop(int Signal)
+{
+	Stopping = 1;
+}
+
+static uint64_t Now(void)
+{
+	struct timespec Time;
+
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+
+	return ((uint64_t)Time.tv_sec * 1000000) + (Time.tv_nsec / 1000);
+}
+
+/** Opens a device node non-blocking, or connects to the Unix socket standing in for one. */
+static int OpenDevice(const char* const Path,
+                      const int Flags)
+{
+	struct sockaddr_un Address = {.sun_family = AF_UNIX};
+	struct stat        Status;
+	int                Device;
+
+	if ((stat(Path, &Status) < 0) || !S_ISSOCK(Status.st_mode))
+		return open(Path, (Flags | O_CLOEXEC | O_NONBLOCK));
+
+	if (strlen(Path) >= sizeof(Address.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	strcpy(Address.sun_path, Path);
+
+	if ((Device = socket(AF_UNIX, (SOCK_SEQPACKET | SOCK_CLOEXEC), 0)) < 0)
+		return -1;
+
+	if ((connect(Device, (struct sockaddr*)&Address, sizeof(Address)) < 0) ||
+	    (fcntl(Device, F_SETFL, O_NONBLOCK) < 0))
+	{
+		close(Device);
+		return -1;
+	}
+
+	return Device;
+}
+
+static uint16_t GetLE16(const uint8_t* const Data)
+{
+	return (Data[0] | (Data[1] << 8));
+}
+
+/** Copies a descriptor from the firmware, returning its size or zero if it has none. */
+static uint16_t GetDescriptor(const uint8_t Type,
+                              const uint8_t Index,
+                              const uint8_t wIndex,
+                              void* const Buffer,
+                              const uint16_t Length)
+{
+	const void* Address;
+	uint16_t    Size = CALLBACK_USB_GetDescriptor(((Type << 8) | Index), wIndex, &Address);
+
+	if (!Address || (Size > Length))
+		return 0;
+
+	memcpy(Buffer, Address, Size);
+
+	return Size;
+}
+
+/** Appends a string descriptor to Name, keeping the ASCII characters. */
+static void AppendString(const uint8_t Index)
+{
+	uint8_t  String[256];
+	uint16_t Length = (Index ? GetDescriptor(DTYPE_String, Index, 0, String, sizeof(String)) : 0);
+	size_t   End    = strlen(Name);
+
+	if (End && Length && (End < (sizeof(Name) - 1)))
+		Name[End++] = ' ';
+
+	for (uint16_t i = 2; ((i + 1) < Length) && (End < (sizeof(Name) - 1)); i += 2)
+		Name[End++] = (String[i + 1] ? '?' : String[i]);
+
+	Name[End] = '\0';
+}
+
+/** Reads the identity and the interfaces of the device from its descriptors. */
+static bool ReadDescriptors(void)
+{
+	uint8_t  Device[32];
+	uint8_t  Config[512];
+	uint16_t Length;
+
+	if (GetDescriptor(DTYPE_Device, 0, 0, Device, sizeof(Device)) < 18)
+		return false;
+
+	VendorID  = GetLE16(&Device[8]);
+	ProductID = GetLE16(&Device[10]);
+	Release   = GetLE16(&Device[12]);
+
+	AppendString(Device[14]);
+	AppendString(Device[15]);
+
+	if (!(Length = GetDescriptor(DTYPE_Configuration, 0, 0, Config, sizeof(Config))))
+		return false;
+
+	for (uint16_t Offset = 0; (Offset + 2) <= Length; Offset += Config[Offset]) {
+		const uint8_t* Descriptor = &Config[Offset];
+
+		if ((Descriptor[0] < 2) || ((Offset + Descriptor[0]) > Length))
+			return false;
+
+		if ((Descriptor[1] == DTYPE_Interface) && (InterfaceCount < MAX_INTERFACES)) {
+			uint8_t Interface = InterfaceCount++;
+
+			ReportDescriptorSizes[Interface] = GetDescriptor(HID_DTYPE_Report, 0, Descriptor[2],
+			                                                 ReportDescriptors[Interface],
+			                                                 sizeof(ReportDescriptors[Interface]));
+			if (!ReportDescriptorSizes[Interface])
+				return false;
+		} else if ((Descriptor[1] == DTYPE_Endpoint) && InterfaceCount && (Descriptor[2] & 0x80)) {
+			Endpoints[InterfaceCount - 1] = (Descriptor[2] & 0x7F);
+		}
+	}
+
+	return (InterfaceCount != 0);
+}
+
+/** Reads the reports printed by the host build. */
+static bool ReadReports(FILE* const File)
+{
+	char     Line[512];
+	uint32_t Allocated = 0;
+	uint32_t LineNumber = 0;
+
+	while (fgets(Line, sizeof(Line), File)) {
+		unsigned long long Time;
+		unsigned           Endpoint;
+		int                Consumed;
+		char*              Bytes;
+		Report_t*          Report;
+
+		LineNumber++;
+
+		if ((Line[0] == '#') || (Line[0] == '\n'))
+			continue;
+
+		if (sscanf(Line, "%llu EP%u%n", &Time, &Endpoint, &Consumed) != 2) {
+			fprintf(stderr, "line %u: expected \"time EPn bytes\"\n", LineNumber);
+			return false;
+		}
+
+		if (ReportCount == Allocated) {
+			Allocated = (Allocated ? (2 * Allocated) : 1024);
+			if (!(Reports = realloc(Reports, Allocated * sizeof(Report_t)))) {
+				perror("realloc");
+				return false;
+			}
+		}
+
+		Report       = &Reports[ReportCount];
+		Report->Time = Time;
+
+		for (Report->Interface = 0; Report->Interface < InterfaceCount; Report->Interface++) {
+			if (Endpoints[Report->Interface] == Endpoint)
+				break;
+		}
+
+		if (Report->Interface == InterfaceCount) {
+			fprintf(stderr, "line %u: no interface has endpoint %u, was the host build configured alike?\n",
+			        LineNumber, Endpoint);
+			return false;
+		}
+
+		Bytes          = &Line[Consumed];
+		Report->Length = 0;
+
+		while (Report->Length < MAX_REPORT_SIZE) {
+			char*         End;
+			unsigned long Byte = strtoul(Bytes, &End, 16);
+
+			if (End == Bytes)
+				break;
+
+			Report->Data[Report->Length++] = Byte;
+			Bytes = End;
+		}
+
+		if (!Report->Length)
+			continue;
+
+		if (ReportCount && (Time < Reports[ReportCount - 1].Time)) {
+			fprintf(stderr, "line %u: time goes backwards\n", LineNumber);
+			return false;
+		}
+
+		ReportCount++;
+	}
+
+	if (!ReportCount) {
+		fprintf(stderr, "no reports to send\n");
+		return false;
+	}
+
+	Period = (((Reports[ReportCount - 1].Time / FRAME_US) + 1) * FRAME_US);
+
+	for (uint8_t Interface = 0; Interface < InterfaceCount; Interface++) {
+		if (!(InterfaceReports[Interface] = malloc(ReportCount * sizeof(uint32_t)))) {
+			perror("malloc");
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < ReportCount; i++) {
+		uint8_t Interface = Reports[i].Interface;
+
+		InterfaceReports[Interface][InterfaceReportCounts[Interface]++] = i;
+	}
+
+	return true;
+}
+
+static bool WriteEvent(const int Device,
+                       const struct uhid_event* const Event,
+                       const size_t Length)
+{
+	if (write(Device, Event, Length) != (ssize_t)Length) {
+		Second.WriteErrors++;
+		return false;
+	}
+
+	return true;
+}
+
+/** Creates the HID device of an interface of a controller. */
+static bool CreateInterface(const uint32_t Controller,
+                            const uint8_t Interface,
+                            const int Epoll)
+{
+	Interface_t*       Device = &Controllers[Controller].Interfaces[Interface];
+	struct uhid_event  Event  = {.type = UHID_CREATE2};
+	struct epoll_event Ready  = {.events = EPOLLIN, .data.u64 = EVENT_TAG(Controller, Interface, 0)};
+	char               Path[512];
+
+	Device->Reader = -1;
+
+	snprintf(Path, sizeof(Path), "%s/dev/uhid", Root);
+	if ((Device->Device = OpenDevice(Path, O_RDWR)) < 0) {
+		perror(Path);
+		return false;
+	}
+
+	/* The phys names the controller and interface, FindReaders() looks the hidraw nodes up by it */
+	snprintf((char*)Event.u.create2.name, sizeof(Event.u.create2.name), "%s", Name);
+	snprintf((char*)Event.u.create2.phys, sizeof(Event.u.create2.phys), "tron-uhid-%d/%u/input%u", getpid(),
+	         Controller, Interface);
+	snprintf((char*)Event.u.create2.uniq, sizeof(Event.u.create2.uniq), "%u", Controller);
+	Event.u.create2.rd_size = ReportDescriptorSizes[Interface];
+	Event.u.create2.bus     = BUS_USB;
+	Event.u.create2.vendor  = VendorID;
+	Event.u.create2.product = ProductID;
+	Event.u.create2.version = Release;
+	memcpy(Event.u.create2.rd_data, ReportDescriptors[Interface], ReportDescriptorSizes[Interface]);
+
+	if (!WriteEvent(Device->Device, &Event, sizeof(Event))) {
+		perror("UHID_CREATE2");
+		return false;
+	}
+
+	return (epoll_ctl(Epoll, EPOLL_CTL_ADD, Device->Device, &Ready) == 0);
+}
+
+/** Answers the events of a uhid device, the report requests fail like an unknown report would. */
+static void ReadEvents(Interface_t* const Device)
+{
+	struct uhid_event Event;
+
+	while (read(Device->Device, &Event, sizeof(Event)) > 0) {
+		struct uhid_event Reply = {0};
+
+		switch (Event.type) {
+		case UHID_START:
+			Device->Started = true;
+			break;
+
+		case UHID_STOP:
+			Device->Started = false;
+			break;
+
+		case UHID_GET_REPORT:
+			Reply.type                   = UHID_GET_REPORT_REPLY;
+			Reply.u.get_report_reply.id  = Event.u.get_report.id;
+			Reply.u.get_report_reply.err = EIO;
+			WriteEvent(Device->Device, &Reply, sizeof(Reply));
+			break;
+
+		case UHID_SET_REPORT:
+			Reply.type                   = UHID_SET_REPORT_REPLY;
+			Reply.u.set_report_reply.id  = Event.u.set_report.id;
+			Reply.u.set_report_reply.err = EIO;
+			WriteEvent(Device->Device, &Reply, sizeof(Reply));
+			break;
+		}
+	}
+}
+
+/** Opens the hidraw nodes of the started devices that have none yet, found by their phys. */
+static void FindReaders(const int Epoll)
+{
+	DIR*           Directory;
+	struct dirent* Entry;
+	char           Path[512];
+
+	snprintf(Path, sizeof(Path), "%s/sys/class/hidraw", Root);
+	if (!(Directory = opendir(Path)))
+		return;
+
+	while ((Entry = readdir(Directory))) {
+		char  Line[256];
+		FILE* Uevent;
+
+		if (Entry->d_name[0] == '.')
+			continue;
+
+		snprintf(Path, sizeof(Path), "%s/sys/class/hidraw/%s/device/uevent", Root, Entry->d_name);
+		if (!(Uevent = fopen(Path, "r")))
+			continue;
+
+		while (fgets(Line, sizeof(Line), Uevent)) {
+			unsigned           Controller;
+			unsigned           Interface;
+			int                Process;
+			Interface_t*       Device;
+			struct epoll_event Ready = {.events = EPOLLIN};
+
+			if (sscanf(Line, "HID_PHYS=tron-uhid-%d/%u/input%u", &Process, &Controller, &Interface) != 3 ||
+			    (Process != getpid()) || (Controller >= ControllerCount) || (Interface >= InterfaceCount))
+				continue;
+
+			Device         = &Controllers[Controller].Interfaces[Interface];
+			Ready.data.u64    = EVENT_TAG(Controller, Interface, 1);
+
+			if (Device->Reader >= 0)
+				break;
+
+			snprintf(Path, sizeof(Path), "%s/dev/%s", Root, Entry->d_name);
+			if ((Device->Reader = OpenDevice(Path, O_RDONLY)) >= 0) {
+				epoll_ctl(Epoll, EPOLL_CTL_ADD, Device->Reader, &Ready);
+				ReadersFound++;
+			}
+			break;
+		}
+
+		fclose(Uevent);
+	}
+
+	closedir(Directory);
+}
+
+/** Sends a report from an interface, remembering it to match it when read back. */
+static void Send(Interface_t* const Device,
+                 const Report_t* const Report)
+{
+	struct uhid_event Event = {.type = UHID_INPUT2};
+
+	if (!Device->Started)
+		return;
+
+	Event.u.input2.size = Report->Length;
+	memcpy(Event.u.input2.data, Report->Data, Report->Length);
+
+	if (!WriteEvent(Device->Device, &Event, (sizeof(Event.type) + sizeof(Event.u.input2.size) + Report->Length)))
+		return;
+
+	Second.Sent++;
+
+	if (Device->Reader >= 0) {
+		Pending_t* Pending = &Device->Pending[Device->PendingHead++ % PENDING_REPORTS];
+
+		/* A full queue drops its oldest report, which then counts as unmatched */
+		if ((uint8_t)(Device->PendingHead - Device->PendingTail) > PENDING_REPORTS)
+			Device->PendingTail++;
+
+		Pending->Sent   = Now();
+		Pending->Length = Report->Length;
+		memcpy(Pending->Data, Report->Data, Report->Length);
+	}
+}
+
+/** Reads the reports of a hidraw node and matches them with those sent, oldest first. */
+static void ReadBack(Interface_t* const Device)
+{
+	uint8_t Data[MAX_REPORT_SIZE];
+	ssize_t Length;
+
+	while ((Length = read(Device->Reader, Data, sizeof(Data))) > 0) {
+		uint64_t Received = Now();
+
+		Second.Received++;
+
+		while (Device->PendingTail != Device->PendingHead) {
+			Pending_t* Pending = &Device->Pending[Device->PendingTail++ % PENDING_REPORTS];
+			uint64_t   Latency = (Received - Pending->Sent);
+			uint8_t    Bucket  = 0;
+
+			if ((Pending->Length != Length) || memcmp(Pending->Data, Data, Length)) {
+				Second.Unmatched++;
+				continue;
+			}
+
+			while ((Bucket < (LATENCY_BUCKETS - 1)) && (Latency >= (2u << Bucket)))
+				Bucket++;
+
+			Second.Latency[Bucket]++;
+			Second.LatencySum += Latency;
+			if (Latency > Second.LatencyMax)
+				Second.LatencyMax = Latency;
+			break;
+		}
+	}
+}
+
+/** Sends the reports due at the given time since the start. */
+static void SendFrame(const uint64_t Elapsed)
+{
+	for (uint32_t i = 0; i < ControllerCount; i++) {
+		Controller_t* Controller = &Controllers[i];
+
+		if (FullRate) {
+			for (uint8_t Interface = 0; Interface < InterfaceCount; Interface++) {
+				Interface_t* Device = &Controller->Interfaces[Interface];
+
+				if (!InterfaceReportCounts[Interface])
+					continue;
+
+				Send(Device, &Reports[InterfaceReports[Interface][Device->Next]]);
+				Device->Next = ((Device->Next + 1) % InterfaceReportCounts[Interface]);
+			}
+
+			continue;
+		}
+
+		while ((Controller->Loop + Reports[Controller->Next].Time) <= (Elapsed + Controller->Offset)) {
+			const Report_t* Report = &Reports[Controller->Next];
+
+			Send(&Controller->Interfaces[Report->Interface], Report);
+
+			if (++Controller->Next == ReportCount) {
+				Controller->Next  = 0;
+				Controller->Loop += Period;
+			}
+		}
+	}
+}
+
+static void AddCounters(Counters_t* const Sum,
+                        const Counters_t* const Counters)
+{
+	Sum->Sent        += Counters->Sent;
+	Sum->Received    += Counters->Received;
+	Sum->Unmatched   += Counters->Unmatched;
+	Sum->WriteErrors += Counters->WriteErrors;
+	Sum->LateFrames  += Counters->LateFrames;
+	Sum->LatencySum  += Counters->LatencySum;
+
+	for (int i = 0; i < LATENCY_BUCKETS; i++)
+		Sum->Latency[i] += Counters->Latency[i];
+
+	if (Counters->LatencyMax > Sum->LatencyMax)
+		Sum->LatencyMax = Counters->LatencyMax;
+}
+
+/** Returns the upper bound of the bucket holding the given share of the latencies. */
+static unsigned LatencyPercentile(const Counters_t* const Counters,
+                                  const uint64_t Matched,
+                                  const unsigned Percent)
+{
+	uint64_t Count = 0;
+
+	for (int i = 0; i < LATENCY_BUCKETS; i++) {
+		Count += Counters->Latency[i];
+		if ((100 * Count) >= (Percent * Matched))
+			return ((2u << i) - 1);
+	}
+
+	return 0;
+}
+
+static void PrintCounters(const Counters_t* const Counters,
+                          const double Seconds)
+{
+	uint64_t Matched = 0;
+
+	for (int i = 0; i < LATENCY_BUCKETS; i++)
+		Matched += Counters->Latency[i];
+
+	printf("%u controllers  sent %.0f/s", ControllerCount, Counters->Sent / Seconds);
+
+	if (Measure) {
+		printf("  received %.0f/s  unmatched %llu", Counters->Received / Seconds,
+		       (unsigned long long)Counters->Unmatched);
+
+		if (Matched)
+			printf("  latency mean %.1f us, p50 < %u us, p99 < %u us, max %llu us",
+			       ((double)Counters->LatencySum / Matched), LatencyPercentile(Counters, Matched, 50),
+			       LatencyPercentile(Counters, Matched, 99), (unsigned long long)Counters->LatencyMax);
+	}
+
+	if (Counters->WriteErrors || Counters->LateFrames)
+		printf("  write errors %llu  late frames %llu", (unsigned long long)Counters->WriteErrors,
+		       (unsigned long long)Counters->LateFrames);
+
+	printf("\n");
+	fflush(stdout);
+}
+
+/** Prints the latency histogram of the whole run, like tron-stats. */
+static void PrintHistogram(void)
+{
+	uint64_t Matched = 0;
+
+	for (int i = 0; i < LATENCY_BUCKETS; i++)
+		Matched += Total.Latency[i];
+
+	if (!Matched)
+		return;
+
+	printf("latency (uhid write to hidraw read):\n");
+
+	for (int i = 0; i < LATENCY_BUCKETS; i++) {
+		if (!Total.Latency[i])
+			continue;
+
+		printf("  %6u - %6u us  %8llu  %5.1f%%  ", (i ? (1u << i) : 0), ((2u << i) - 1),
+		       (unsigned long long)Total.Latency[i], (100.0 * Total.Latency[i]) / Matched);
+
+		for (uint64_t Bar = 0; Bar < ((50 * Total.Latency[i]) / Matched); Bar++)
+			putchar('#');
+		putchar('\n');
+	}
+}
+
+/** Raises the limit of open files to what the devices and their readers need, if allowed. */
+static void RaiseFileLimit(void)
+{
+	struct rlimit Limit;
+	rlim_t        Needed = ((ControllerCount * InterfaceCount * (Measure ? 2 : 1)) + 16);
+
+	if (getrlimit(RLIMIT_NOFILE, &Limit) || (Limit.rlim_cur >= Needed))
+		return;
+
+	Limit.rlim_cur = ((Limit.rlim_max < Needed) ? Limit.rlim_max : Needed);
+	setrlimit(RLIMIT_NOFILE, &Limit);
+}
+
+static void Usage(const char* const Program)
+{
+	fprintf(stderr, "usage: %s [-n controllers] [-f] [-l] [-s seconds] [-R root] reports\n", Program);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char* argv[])
+{
+	struct sigaction   Action   = {.sa_handler = Stop};
+	struct itimerspec  Interval = {.it_interval = {0, (FRAME_US * 1000)}, .it_value = {0, (FRAME_US * 1000)}};
+	struct epoll_event Ready    = {.events = EPOLLIN, .data.u64 = EVENT_TIMER};
+	unsigned           Seconds  = 0;
+	int                Option;
+	int                Epoll;
+	int                Timer;
+	FILE*              File;
+	uint64_t           Start    = 0;
+	uint64_t           Frames   = 0;
+	uint64_t           Printed  = 0;
+	uint64_t           Begin    = Now();
+
+	while ((Option = getopt(argc, argv, "n:fls:R:")) != -1) {
+		switch (Option) {
+		case 'n':
+			if (!(ControllerCount = atoi(optarg)))
+				Usage(argv[0]);
+			break;
+		case 'f':
+			FullRate = true;
+			break;
+		case 'l':
+			Measure = true;
+			break;
+		case 's':
+			Seconds = atoi(optarg);
+			break;
+		case 'R':
+			Root = optarg;
+			break;
+		default:
+			Usage(argv[0]);
+		}
+	}
+
+	if (optind != (argc - 1))
+		Usage(argv[0]);
+
+	if (!ReadDescriptors()) {
+		fprintf(stderr, "bad descriptors\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!(File = (strcmp(argv[optind], "-") ? fopen(argv[optind], "r") : stdin))) {
+		fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	if (!ReadReports(File))
+		return EXIT_FAILURE;
+
+	if (File != stdin)
+		fclose(File);
+
+	if (!(Controllers = calloc(ControllerCount, sizeof(Controller_t)))) {
+		perror("calloc");
+		return EXIT_FAILURE;
+	}
+
+	RaiseFileLimit();
+
+	Epoll = epoll_create1(EPOLL_CLOEXEC);
+	Timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+	if ((Epoll < 0) || (Timer < 0) || timerfd_settime(Timer, 0, &Interval, NULL) ||
+	    epoll_ctl(Epoll, EPOLL_CTL_ADD, Timer, &Ready)) {
+		perror("timer");
+		return EXIT_FAILURE;
+	}
+
+	/* The controllers start spread over one pass of the replay, or over the reports with -f */
+	for (uint32_t i = 0; i < ControllerCount; i++) {
+		for (uint8_t Interface = 0; Interface < InterfaceCount; Interface++) {
+			if (!CreateInterface(i, Interface, Epoll))
+				return EXIT_FAILURE;
+
+			if (InterfaceReportCounts[Interface])
+				Controllers[i].Interfaces[Interface].Next = (i % InterfaceReportCounts[Interface]);
+		}
+
+		Controllers[i].Offset = ((((uint64_t)i * Period) / ControllerCount) / FRAME_US * FRAME_US);
+
+		while (Reports[Controllers[i].Next].Time < Controllers[i].Offset)
+			Controllers[i].Next++;
+	}
+
+	fprintf(stderr, "%u controllers \"%s\" %04X:%04X, %u interfaces, %u reports over %llu ms%s\n",
+	        ControllerCount, Name, VendorID, ProductID, InterfaceCount, ReportCount,
+	        (unsigned long long)(Period / 1000), (FullRate ? ", sent at full rate" : ""));
+
+	/* Without SA_RESTART the signal interrupts the wait */
+	sigaction(SIGINT, &Action, NULL);
+	sigaction(SIGTERM, &Action, NULL);
+
+	while (!Stopping) {
+		struct epoll_event Events[64];
+		int                Count = epoll_wait(Epoll, Events, (sizeof(Events) / sizeof(Events[0])), -1);
+
+		for (int i = 0; i < Count; i++) {
+			uint64_t     Tag = Events[i].data.u64;
+			uint64_t     Expirations;
+			Interface_t* Device;
+
+			if (Tag != EVENT_TIMER) {
+				Device = &Controllers[Tag >> 8].Interfaces[(Tag & 0xFF) >> 1];
+
+				if (Tag & 1)
+					ReadBack(Device);
+				else
+					ReadEvents(Device);
+
+				continue;
+			}
+
+			if (read(Timer, &Expirations, sizeof(Expirations)) != sizeof(Expirations))
+				continue;
+
+			/* The replay starts once every device has been started by the kernel */
+			if (!Start) {
+				bool Started = true;
+
+				for (uint32_t j = 0; j < ControllerCount; j++) {
+					for (uint8_t Interface = 0; Interface < InterfaceCount; Interface++)
+						Started &= Controllers[j].Interfaces[Interface].Started;
+				}
+
+				if (!Started)
+					continue;
+
+				Start   = Now();
+				Printed = Start;
+				fprintf(stderr, "devices started after %llu ms\n", (unsigned long long)((Start - Begin) / 1000));
+			}
+
+			/* The hidraw nodes appear shortly after the devices start */
+			if (Measure && (ReadersFound < (ControllerCount * InterfaceCount)) && !(Frames % 100))
+				FindReaders(Epoll);
+
+			Frames++;
+			Second.LateFrames += (Expirations - 1);
+
+			/* With -f the frames the timer was late for are sent too, the replay catches up by itself */
+			if (!FullRate || (Expirations > MAX_LATE_FRAMES))
+				Expirations = (FullRate ? MAX_LATE_FRAMES : 1);
+
+			while (Expirations--)
+				SendFrame(Now() - Start);
+
+			if ((Now() - Printed) >= 1000000) {
+				uint64_t Time = Now();
+
+				PrintCounters(&Second, ((Time - Printed) / 1e6));
+				AddCounters(&Total, &Second);
+				memset(&Second, 0, sizeof(Second));
+				Printed = Time;
+
+				if (Seconds && ((Time - Start) >= (Seconds * 1000000ULL)))
+					Stopping = 1;
+			}
+		}
+	}
+
+	AddCounters(&Total, &Second);
+
+	if (Start) {
+		printf("total: ");
+		PrintCounters(&Total, ((Now() - Start) / 1e6));
+		PrintHistogram();
+	}
+
+	/* Closing a uhid descriptor destroys its device */
+	for (uint32_t i = 0; i < ControllerCount; i++) {
+		for (uint8_t Interface = 0; Interface < InterfaceCount; Interface++) {
+			if (Controllers[i].Interfaces[Interface].Reader >= 0)
+				close(Controllers[i].Interfaces[Interface].Reader);
+			close(Controllers[i].Interfaces[Interface].Device);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+/** \file
+ *
+ *  Prints the controller states tron-hidd publishes, the way a game process reads them: the ring
+ *  is mapped read-only and polled, see tron-ring.h.
+ *
+ *  \code
+ *  tron-watch
+ *  \endcode
+ *
+ *  Each line holds the state's sequence number, its age when read in microseconds, the axes and
+ *  buttons of each player and the dial position. States overwritten before they were read are
+ *  counted as lost.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tron-ring.h"
+
+/** Interval the ring is polled at, in microseconds. */
+#define POLL_INTERVAL_US         200
+
+static uint64_t Now(void)
+{
+	struct timespec Time;
+
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+
+	return (((uint64_t)Time.tv_sec * 1000000000) + Time.tv_nsec);
+}
+
+int main(int argc, char* argv[])
+{
+	const char* Name = TRON_RING_NAME;
+	int         Option;
+	TronRing_t* Ring;
+	uint64_t    Next;
+	uint64_t    Lost = 0;
+
+	while ((Option = getopt(argc, argv, "n:")) != -1) {
+		switch (Option) {
+		case 'n':
+			Name = optarg;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n /name]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!(Ring = TronRing_Open(Name))) {
+		fprintf(stderr, "%s: no tron-hidd ring\n", Name);
+		return EXIT_FAILURE;
+	}
+
+	Next = (TronRing_Head(Ring) + 1);
+
+	for (;;) {
+		TronState_t State;
+
+		if (Next > TronRing_Head(Ring)) {
+			usleep(POLL_INTERVAL_US);
+			continue;
+		}
+
+		if (!TronRing_Read(Ring, Next, &State)) {
+			/* Overwritten, resume at the oldest state still in the ring */
+			uint64_t Oldest = (TronRing_Head(Ring) - TRON_RING_SLOTS + 1);
+
+			Lost += (Oldest - Next);
+			Next  = Oldest;
+			continue;
+		}
+
+		printf("%8llu %6llu us", (unsigned long long)State.Sequence,
+		       (unsigned long long)((Now() - State.Timestamp) / 1000));
+
+		for (int i = 0; (i < State.Players) && (i < TRON_MAX_PLAYERS); i++) {
+			TronPlayer_t* Player = &State.Player[i];
+
+			printf("  %6d %6d  %c%c%c", Player->X, Player->Y, ((Player->Buttons & 0x01) ? '1' : '-'),
+			       ((Player->Buttons & 0x02) ? '2' : '-'), ((Player->Buttons & 0x04) ? '3' : '-'));
+		}
+
+		printf("  %8d%s\n", State.Dial, (Lost ? "  (states lost)" : ""));
+		fflush(stdout);
+
+		Lost = 0;
+		Next++;
+	}
+}